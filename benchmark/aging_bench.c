@@ -0,0 +1,150 @@
+
+/*
+ * Priority aging, aging_prio_queue against a prio_queue rebuilt with recomputed priorities.
+ *
+ * Both run a hold model over n queued items, every tick removes and re-inserts ops items. The prio_queue orders by the
+ * effective priority at insert and is drained and refilled every period ticks to apply the aging, which is what
+ * aging_prio_queue avoids.
+ *
+ * Usage: aging_bench [items] [ops per tick] [ticks] [rebuild period]
+ */
+
+#include "../include/aging_prio_queue.h"
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define AGING_CLASSES 4
+
+struct job{
+    double base;
+    size_t age_class;
+    uint64_t inserted;
+    double priority;    // Effective priority at the last (re)insert, only used by the prio_queue.
+};
+
+static const double rates[AGING_CLASSES] = {0, 0.01, 0.1, 1.0};
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int job_compare(void* c1, void* c2){
+    double p1 = ((struct job*)c1)->priority;
+    double p2 = ((struct job*)c2)->priority;
+    return (p1 > p2) - (p1 < p2);
+}
+
+static double effective(struct job* job, uint64_t now){
+    return job->base - rates[job->age_class] * (double)(now - job->inserted);
+}
+
+static void job_reset(struct job* job, uint64_t now){
+    job->base = (double)(rng_next() % 100000);
+    job->age_class = rng_next() % AGING_CLASSES;
+    job->inserted = now;
+}
+
+int main(int argc, char** argv){
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    size_t ops = argc > 2 ? strtoull(argv[2], NULL, 10) : 1000;
+    uint64_t ticks = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000;
+    uint64_t period = argc > 4 ? strtoull(argv[4], NULL, 10) : 100;
+
+    struct job* jobs = malloc(sizeof(struct job) * n);
+    void** drained = malloc(sizeof(void*) * n);
+    if(jobs == NULL || drained == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+
+    // prio_queue, rebuilt every period ticks.
+    rng_state = 88172645463325252ULL;
+    struct prio_queue_handle* pq = NULL;
+    prio_queue_init(&pq, n, &job_compare);
+    for(size_t i = 0; i < n; i++){
+        job_reset(&jobs[i], 0);
+        jobs[i].priority = jobs[i].base;
+        prio_queue_insert(pq, &jobs[i]);
+    }
+    double rebuild_time = 0;
+    double start = now_sec();
+    for(uint64_t now = 1; now <= ticks; now++){
+        if(now % period == 0){
+            double rebuild_start = now_sec();
+            size_t count = 0;
+            while(prio_queue_remove(pq, &drained[count]) == CST_OK){
+                count++;
+            }
+            for(size_t i = 0; i < count; i++){
+                struct job* job = drained[i];
+                job->priority = effective(job, now);
+                prio_queue_insert(pq, job);
+            }
+            rebuild_time += now_sec() - rebuild_start;
+        }
+        for(size_t i = 0; i < ops; i++){
+            void* data = NULL;
+            prio_queue_remove(pq, &data);
+            struct job* job = data;
+            job_reset(job, now);
+            job->priority = job->base;
+            prio_queue_insert(pq, job);
+        }
+    }
+    double pq_time = now_sec() - start;
+    prio_queue_free(pq);
+
+    // aging_prio_queue, same jobs and random sequence.
+    rng_state = 88172645463325252ULL;
+    struct aging_prio_queue_handle* aq = NULL;
+    aging_prio_queue_init(&aq, n, rates, AGING_CLASSES, 0);
+    for(size_t i = 0; i < n; i++){
+        job_reset(&jobs[i], 0);
+        aging_prio_queue_insert(aq, &jobs[i], jobs[i].base, jobs[i].age_class, 0);
+    }
+    double max_error = 0;
+    start = now_sec();
+    for(uint64_t now = 1; now <= ticks; now++){
+        for(size_t i = 0; i < ops; i++){
+            void* data = NULL;
+            double priority = 0;
+            aging_prio_queue_peek(aq, &data, &priority, now);
+            aging_prio_queue_remove(aq, &data, now);
+            struct job* job = data;
+            double error = priority - effective(job, now);
+            max_error = error > max_error ? error : (-error > max_error ? -error : max_error);
+            job_reset(job, now);
+            aging_prio_queue_insert(aq, job, job->base, job->age_class, now);
+        }
+    }
+    double aq_time = now_sec() - start;
+    aging_prio_queue_free(aq);
+
+    double total = (double)ticks * (double)ops;
+    printf("items: %zu, ops: %.0f, rebuild every %llu ticks\n", n, total, (unsigned long long)period);
+    printf("prio_queue + rebuild: %.3f s, %.1f ns/op, of which rebuilds %.3f s\n", pq_time, pq_time * 1e9 / total,
+           rebuild_time);
+    printf("aging_prio_queue: %.3f s, %.1f ns/op (peek + remove + insert)\n", aq_time, aq_time * 1e9 / total);
+    if(max_error > 1e-6){
+        printf("Priority fail, off by %g\n", max_error);
+        return 1;
+    }
+
+    free(drained);
+    free(jobs);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Builds the library in several configurations and compares prio_queue_bench between them.
+#
+# Every configuration is built in its own directory below the work directory (default build-compare), the PGO
+# configuration is trained with the pgo_train target first. The table printed at the end holds ns/op per workload and
+# phase for each configuration.
+#
+# Usage: benchmark/compare_builds.sh [work directory] [prio_queue_bench arguments]
+
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+WORK_DIR=${1:-build-compare}
+shift 2>/dev/null || true
+BENCH_ARGS=${*:-"--workloads=random,sorted,hold --sizes=10000,1000000 --payloads=8 --hold-ops=2000000"}
+
+CONFIGS="baseline inline lto inline_lto inline_lto_pgo"
+
+configure(){
+    name=$1
+    shift
+    cmake -S "$SOURCE_DIR" -B "$WORK_DIR/$name" -DCSTRUCTURES_BUILD_TESTS=OFF -DCSTRUCTURES_BUILD_SHARED=OFF "$@" \
+        > /dev/null
+    cmake --build "$WORK_DIR/$name" --target prio_queue_bench timer_wheel_bench > /dev/null
+}
+
+for name in $CONFIGS; do
+    echo "Building $name" >&2
+    case $name in
+        baseline) configure $name ;;
+        inline) configure $name -DCSTRUCTURES_INLINE_CBT=ON ;;
+        lto) configure $name -DCSTRUCTURES_LTO=ON ;;
+        inline_lto) configure $name -DCSTRUCTURES_INLINE_CBT=ON -DCSTRUCTURES_LTO=ON ;;
+        inline_lto_pgo)
+            configure $name -DCSTRUCTURES_INLINE_CBT=ON -DCSTRUCTURES_LTO=ON -DCSTRUCTURES_PGO=GENERATE
+            cmake --build "$WORK_DIR/$name" --target pgo_train > /dev/null
+            configure $name -DCSTRUCTURES_PGO=USE
+            ;;
+    esac
+    # shellcheck disable=SC2086
+    "$WORK_DIR/$name/prio_queue_bench" $BENCH_ARGS --out="$WORK_DIR/$name.json"
+done
+
+# One row per workload, phase and size, one column per configuration.
+printf "%-24s" "workload/phase/size"
+for name in $CONFIGS; do
+    printf "%16s" "$name"
+done
+printf "\n"
+for row in $(sed -n 's/.*"workload": "\([a-z]*\)", "phase": "\([a-z]*\)", "size": \([0-9]*\).*/\1\/\2\/\3/p' \
+             "$WORK_DIR/baseline.json"); do
+    printf "%-24s" "$row"
+    workload=${row%%/*}
+    rest=${row#*/}
+    phase=${rest%%/*}
+    size=${rest#*/}
+    for name in $CONFIGS; do
+        ns=$(sed -n "s/.*\"workload\": \"$workload\", \"phase\": \"$phase\", \"size\": $size,.*\"ns_per_op\": \([0-9.]*\).*/\1/p" \
+             "$WORK_DIR/$name.json" | head -n 1)
+        printf "%16s" "$ns"
+    done
+    printf "\n"
+done
@@ -0,0 +1,111 @@
+
+/*
+ * Throughput of ext_prio_queue with ten times more items than it buffers in memory.
+ *
+ * Usage: ext_prio_queue_bench [buffer_items] [multiple] [dir]
+ */
+
+#include "../include/ext_prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PAYLOAD_BYTES 24
+
+struct item{
+    uint64_t key;
+    unsigned char payload[PAYLOAD_BYTES];
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int item_compare(void* c1, void* c2){
+    uint64_t k1 = ((struct item*)c1)->key;
+    uint64_t k2 = ((struct item*)c2)->key;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static size_t item_serialize(void* data, void* buf, size_t cap){
+    if(cap >= sizeof(struct item)){
+        memcpy(buf, data, sizeof(struct item));
+    }
+    return sizeof(struct item);
+}
+
+static void* item_deserialize(const void* buf, size_t len){
+    struct item* data = malloc(sizeof(struct item));
+    if(data != NULL && len == sizeof(struct item)){
+        memcpy(data, buf, sizeof(struct item));
+    }
+    return data;
+}
+
+static void item_release(void* data){
+    free(data);
+}
+
+int main(int argc, char** argv){
+    size_t buffer_items = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    size_t multiple = argc > 2 ? strtoull(argv[2], NULL, 10) : 10;
+    const char* dir = argc > 3 ? argv[3] : NULL;
+    size_t total = buffer_items * multiple;
+
+    struct ext_prio_queue_serializer serializer = { &item_serialize, &item_deserialize, &item_release };
+    struct ext_prio_queue_handle* hnd = NULL;
+    if(ext_prio_queue_init(&hnd, dir, buffer_items, &item_compare, &serializer) != CST_OK){
+        printf("Init Fail\n");
+        return 1;
+    }
+
+    double start = now_sec();
+    for(size_t i = 0; i < total; i++){
+        struct item* data = malloc(sizeof(struct item));
+        data->key = rng_next();
+        memset(data->payload, (int)i, PAYLOAD_BYTES);
+        if(ext_prio_queue_insert(hnd, data) != CST_OK){
+            printf("Insert Failed\n");
+            return 1;
+        }
+    }
+    double insert = now_sec() - start;
+    size_t runs = ext_prio_queue_runs(hnd);
+
+    start = now_sec();
+    uint64_t last = 0;
+    size_t bad = 0;
+    void* data = NULL;
+    while(ext_prio_queue_remove(hnd, &data) == CST_OK){
+        if(((struct item*)data)->key < last){
+            bad++;
+        }
+        last = ((struct item*)data)->key;
+        free(data);
+    }
+    double drain = now_sec() - start;
+
+    // Every record carries a four byte length prefix on disk.
+    double mb = (double)total * (sizeof(struct item) + 4) / (1024.0 * 1024.0);
+    printf("items: %zu, buffered: %zu items, runs: %zu\n", total, buffer_items, runs);
+    printf("insert: %.3f s, %.1f ns/item, %.1f MB/s\n", insert, insert * 1e9 / total, mb / insert);
+    printf("drain:  %.3f s, %.1f ns/item, %.1f MB/s\n", drain, drain * 1e9 / total, mb / drain);
+    printf("out of order: %zu\n", bad);
+
+    ext_prio_queue_free(hnd);
+    return bad != 0;
+}
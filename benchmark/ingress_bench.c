@@ -0,0 +1,163 @@
+
+/*
+ * Handing items from producer threads to the thread owning a queue, ingress ring against a mutex.
+ *
+ * Producers each push a share of n random keys while the owner removes until it has seen all of them. The baseline
+ * guards prio_queue_insert and prio_queue_remove with one mutex, the ring variant pushes with prio_queue_push_ingress
+ * and the owner removes without a lock. Reports total time and the mean producer time per push, which includes waiting
+ * for the lock or for room in the ring.
+ *
+ * Usage: ingress_bench [n] [producers] [ring capacity]
+ */
+
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if PRIO_QUEUE_INGRESS_ENABLED && PRIO_QUEUE_PARALLEL_ENABLED
+
+#include <pthread.h>
+#include <sched.h>
+
+struct producer{
+    struct prio_queue_handle* hnd;
+    pthread_mutex_t* lock;  // NULL for the ring.
+    uint64_t* keys;
+    size_t count;
+    double elapsed;
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int key_compare(void* c1, void* c2){
+    uint64_t k1 = *(uint64_t*)c1;
+    uint64_t k2 = *(uint64_t*)c2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static void* produce(void* arg){
+    struct producer* producer = arg;
+    double start = now_sec();
+    for(size_t i = 0; i < producer->count; i++){
+        if(producer->lock != NULL){
+            pthread_mutex_lock(producer->lock);
+            prio_queue_insert(producer->hnd, &producer->keys[i]);
+            pthread_mutex_unlock(producer->lock);
+        } else {
+            while(prio_queue_push_ingress(producer->hnd, &producer->keys[i]) == CST_OVERFLOW){
+                sched_yield();
+            }
+        }
+    }
+    producer->elapsed = now_sec() - start;
+    return NULL;
+}
+
+static void run(const char* name, uint64_t* keys, size_t n, unsigned int threads, size_t capacity, int locked){
+    struct prio_queue_handle* hnd = NULL;
+    pthread_mutex_t lock;
+    pthread_mutex_init(&lock, NULL);
+    if(prio_queue_init(&hnd, n, &key_compare) != CST_OK ||
+       (!locked && prio_queue_attach_ingress(hnd, capacity) != CST_OK)){
+        printf("Init Fail\n");
+        return;
+    }
+
+    struct producer* producers = malloc(sizeof(struct producer) * threads);
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    double start = now_sec();
+    for(unsigned int t = 0; t < threads; t++){
+        producers[t].hnd = hnd;
+        producers[t].lock = locked ? &lock : NULL;
+        producers[t].keys = keys + n * t / threads;
+        producers[t].count = n * (t + 1) / threads - n * t / threads;
+        pthread_create(&ids[t], NULL, &produce, &producers[t]);
+    }
+
+    size_t removed = 0;
+    uint64_t checksum = 0;
+    void* data = NULL;
+    while(removed < n){
+        cst_err e;
+        if(locked){
+            pthread_mutex_lock(&lock);
+            e = prio_queue_remove(hnd, &data);
+            pthread_mutex_unlock(&lock);
+        } else {
+            e = prio_queue_remove(hnd, &data);
+        }
+        if(e == CST_OK){
+            checksum += *(uint64_t*)data;
+            removed++;
+        } else {
+            sched_yield();
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    double push = 0;
+    for(unsigned int t = 0; t < threads; t++){
+        pthread_join(ids[t], NULL);
+        push += producers[t].elapsed;
+    }
+    uint64_t expected = 0;
+    for(size_t i = 0; i < n; i++){
+        expected += keys[i];
+    }
+    printf("%-8s %2u producers: %.3f s, %.1f ns/item, producers %.1f ns/push%s\n", name, threads, elapsed,
+           elapsed * 1e9 / (double)n, push * 1e9 / (double)n, checksum == expected ? "" : " checksum fail");
+
+    free(producers);
+    free(ids);
+    prio_queue_free(hnd);
+    pthread_mutex_destroy(&lock);
+}
+
+#endif
+
+int main(int argc, char** argv){
+#if PRIO_QUEUE_INGRESS_ENABLED && PRIO_QUEUE_PARALLEL_ENABLED
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 2000000;
+    unsigned int threads = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 10) : 4;
+    size_t capacity = argc > 3 ? strtoull(argv[3], NULL, 10) : 4096;
+    if(threads == 0){
+        threads = 1;
+    }
+
+    uint64_t* keys = malloc(sizeof(uint64_t) * n);
+    if(keys == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+    for(size_t i = 0; i < n; i++){
+        keys[i] = rng_next();
+    }
+
+    run("mutex", keys, n, threads, capacity, 1);
+    run("ingress", keys, n, threads, capacity, 0);
+
+    free(keys);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    printf("Ingress disabled\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,194 @@
+
+/*
+ * K-way merge of sorted sources, kway_merge against the prio_queue loop it replaces.
+ *
+ * Every source is a sorted array of random keys. The heap loop keeps one entry per source in a prio_queue and does a
+ * remove and an insert per output item, kway_merge pulls the same sources in batches and outputs blocks.
+ *
+ * Usage: kway_merge_bench [sources] [items per source]
+ */
+
+#include "../include/kway_merge.h"
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OUTPUT_BLOCK 4096
+
+struct source{
+    uint64_t* keys;
+    size_t count;
+    size_t next;
+};
+
+// The heap loop's entry, the key is copied in so the comparator does not chase the source.
+struct heap_entry{
+    uint64_t key;
+    struct source* source;
+};
+
+static uint64_t comparisons = 0;
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int key_compare(void* c1, void* c2){
+    comparisons++;
+    uint64_t k1 = *(uint64_t*)c1;
+    uint64_t k2 = *(uint64_t*)c2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static int u64_sort(const void* a, const void* b){
+    uint64_t k1 = *(const uint64_t*)a;
+    uint64_t k2 = *(const uint64_t*)b;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static size_t source_pull(void* ctx, void** items, size_t cap){
+    struct source* source = ctx;
+    size_t count = 0;
+    while(count < cap && source->next < source->count){
+        items[count++] = &source->keys[source->next++];
+    }
+    return count;
+}
+
+static double bench_heap(struct source* sources, size_t k, uint64_t* checksum){
+    struct prio_queue_handle* hnd = NULL;
+    struct heap_entry* entries = malloc(sizeof(struct heap_entry) * k);
+    if(entries == NULL || prio_queue_init(&hnd, k, &key_compare) != CST_OK){
+        free(entries);
+        return -1;
+    }
+
+    double start = now_sec();
+    for(size_t i = 0; i < k; i++){
+        if(sources[i].next < sources[i].count){
+            entries[i].key = sources[i].keys[sources[i].next++];
+            entries[i].source = &sources[i];
+            prio_queue_insert(hnd, &entries[i]);
+        }
+    }
+    uint64_t sum = 0;
+    uint64_t last = 0;
+    void* data = NULL;
+    while(prio_queue_remove(hnd, &data) == CST_OK){
+        struct heap_entry* entry = data;
+        sum += entry->key > last;
+        last = entry->key;
+        if(entry->source->next < entry->source->count){
+            entry->key = entry->source->keys[entry->source->next++];
+            prio_queue_insert(hnd, entry);
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    *checksum = sum;
+    prio_queue_free(hnd);
+    free(entries);
+    return elapsed;
+}
+
+static double bench_kway(struct source* sources, size_t k, uint64_t* checksum){
+    struct kway_merge_handle* hnd = NULL;
+    void** contexts = malloc(sizeof(void*) * k);
+    void** out = malloc(sizeof(void*) * OUTPUT_BLOCK);
+    if(contexts == NULL || out == NULL){
+        free(contexts);
+        free(out);
+        return -1;
+    }
+    for(size_t i = 0; i < k; i++){
+        contexts[i] = &sources[i];
+    }
+
+    double start = now_sec();
+    if(kway_merge_init(&hnd, k, contexts, &source_pull, &key_compare) != CST_OK){
+        free(contexts);
+        free(out);
+        return -1;
+    }
+    uint64_t sum = 0;
+    uint64_t last = 0;
+    size_t count = 0;
+    while((count = kway_merge_next(hnd, out, OUTPUT_BLOCK)) > 0){
+        for(size_t i = 0; i < count; i++){
+            uint64_t key = *(uint64_t*)out[i];
+            sum += key > last;
+            last = key;
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    *checksum = sum;
+    kway_merge_free(hnd);
+    free(contexts);
+    free(out);
+    return elapsed;
+}
+
+int main(int argc, char** argv){
+    size_t k = argc > 1 ? strtoull(argv[1], NULL, 10) : 256;
+    size_t per_source = argc > 2 ? strtoull(argv[2], NULL, 10) : 40000;
+
+    struct source* sources = malloc(sizeof(struct source) * k);
+    uint64_t* keys = malloc(sizeof(uint64_t) * k * per_source);
+    if(sources == NULL || keys == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+    for(size_t i = 0; i < k; i++){
+        sources[i].keys = keys + i * per_source;
+        sources[i].count = per_source;
+        for(size_t j = 0; j < per_source; j++){
+            sources[i].keys[j] = rng_next();
+        }
+        qsort(sources[i].keys, per_source, sizeof(uint64_t), &u64_sort);
+    }
+    double total = (double)k * (double)per_source;
+
+    for(size_t i = 0; i < k; i++){
+        sources[i].next = 0;
+    }
+    uint64_t heap_sum = 0;
+    comparisons = 0;
+    double heap = bench_heap(sources, k, &heap_sum);
+    uint64_t heap_comparisons = comparisons;
+
+    for(size_t i = 0; i < k; i++){
+        sources[i].next = 0;
+    }
+    uint64_t kway_sum = 0;
+    comparisons = 0;
+    double kway = bench_kway(sources, k, &kway_sum);
+    uint64_t kway_comparisons = comparisons;
+
+    printf("sources: %zu, items: %.0f\n", k, total);
+    printf("prio_queue: %.3f s, %.1f ns/item, %.2f comparisons/item\n", heap, heap * 1e9 / total,
+           (double)heap_comparisons / total);
+    printf("kway_merge: %.3f s, %.1f ns/item, %.2f comparisons/item\n", kway, kway * 1e9 / total,
+           (double)kway_comparisons / total);
+    if(heap_sum != kway_sum){
+        printf("Outputs differ\n");
+        return 1;
+    }
+
+    free(keys);
+    free(sources);
+    return 0;
+}
@@ -0,0 +1,120 @@
+
+/*
+ * Parallel heapify and sorted drain against n inserts and n removes.
+ *
+ * Builds a queue of n random keys with prio_queue_build_parallel and drains it with prio_queue_drain_sorted_parallel
+ * for every thread count given, the single threaded baseline is n prio_queue_insert and n prio_queue_remove calls.
+ *
+ * Usage: parallel_bench [n] [threads,threads,...]
+ */
+
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int key_compare(void* c1, void* c2){
+    uint64_t k1 = *(uint64_t*)c1;
+    uint64_t k2 = *(uint64_t*)c2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static int check_sorted(void** out, size_t n){
+    for(size_t i = 1; i < n; i++){
+        if(*(uint64_t*)out[i] < *(uint64_t*)out[i - 1]){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char** argv){
+#if PRIO_QUEUE_PARALLEL_ENABLED
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    const char* thread_list = argc > 2 ? argv[2] : "1,2,4,8,16,32";
+
+    uint64_t* keys = malloc(sizeof(uint64_t) * n);
+    void** items = malloc(sizeof(void*) * n);
+    void** out = malloc(sizeof(void*) * n);
+    if(keys == NULL || items == NULL || out == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+    for(size_t i = 0; i < n; i++){
+        keys[i] = rng_next();
+    }
+
+    // Baseline, n inserts and n removes.
+    struct prio_queue_handle* hnd = NULL;
+    prio_queue_init(&hnd, n, &key_compare);
+    double start = now_sec();
+    for(size_t i = 0; i < n; i++){
+        prio_queue_insert(hnd, &keys[i]);
+    }
+    double build = now_sec() - start;
+    start = now_sec();
+    for(size_t i = 0; i < n; i++){
+        prio_queue_remove(hnd, &out[i]);
+    }
+    double drain = now_sec() - start;
+    prio_queue_free(hnd);
+    printf("n: %zu\n%-16s %10s %10s\n", n, "", "build s", "drain s");
+    printf("%-16s %10.3f %10.3f%s\n", "insert/remove", build, drain, check_sorted(out, n) ? "" : "  out of order");
+
+    const char* arg = thread_list;
+    while(*arg != '\0'){
+        char* end = NULL;
+        unsigned int threads = (unsigned int)strtoul(arg, &end, 10);
+        for(size_t i = 0; i < n; i++){
+            items[i] = &keys[i];
+        }
+
+        start = now_sec();
+        if(prio_queue_build_parallel(&hnd, items, n, n, &key_compare, threads) != CST_OK){
+            printf("Build Failed\n");
+            return 1;
+        }
+        build = now_sec() - start;
+        start = now_sec();
+        prio_queue_drain_sorted_parallel(hnd, out, threads);
+        drain = now_sec() - start;
+        prio_queue_free(hnd);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%u threads", threads);
+        printf("%-16s %10.3f %10.3f%s\n", name, build, drain, check_sorted(out, n) ? "" : "  out of order");
+        if(*end != ','){
+            break;
+        }
+        arg = end + 1;
+    }
+
+    free(keys);
+    free(items);
+    free(out);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    printf("Parallel disabled\n");
+    return 0;
+#endif
+}
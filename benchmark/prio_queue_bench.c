@@ -0,0 +1,346 @@
+
+/*
+ * Reproducible prio_queue workloads with machine readable results.
+ *
+ * Every combination of workload, size and payload size is run on a fresh queue. Fill and drain workloads insert n
+ * keys and then remove them all, the hold workload keeps n items queued and times remove + insert pairs where the new
+ * key is the removed key plus a random increment. Results are printed as a JSON array, one object per run.
+ *
+ * Usage: prio_queue_bench [--workloads=random,sorted,reverse,duplicates,hold] [--sizes=1000,10000,...]
+ *                         [--payloads=8,64,...] [--hold-ops=N] [--seed=N] [--out=file] [--trace-sample=N]
+ *
+ * --trace-sample turns on the queue's own latency sampling to measure its overhead, it needs CSTRUCTURES_TRACE.
+ */
+
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_LIST 16
+#define BENCH_HIST_SUB_BITS 4    /** Latency histogram precision, 16 buckets per power of two. */
+#define BENCH_HIST_BUCKETS (64 << BENCH_HIST_SUB_BITS)
+
+enum bench_workload{
+    WORKLOAD_RANDOM,
+    WORKLOAD_SORTED,
+    WORKLOAD_REVERSE,
+    WORKLOAD_DUPLICATES,
+    WORKLOAD_HOLD,
+    WORKLOAD_COUNT
+};
+
+static const char* workload_names[WORKLOAD_COUNT] = { "random", "sorted", "reverse", "duplicates", "hold" };
+
+struct bench_config{
+    int workloads[WORKLOAD_COUNT];
+    size_t sizes[BENCH_MAX_LIST];
+    int size_count;
+    size_t payloads[BENCH_MAX_LIST];
+    int payload_count;
+    size_t hold_ops;
+    uint64_t seed;
+    const char* out;
+    uint32_t trace_sample;
+};
+
+// Log linear latency histogram, exact below 2^BENCH_HIST_SUB_BITS ns.
+struct bench_hist{
+    uint64_t counts[BENCH_HIST_BUCKETS];
+    uint64_t total;
+};
+
+static uint64_t comparisons = 0;
+static uint64_t rng_state = 1;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Items start with their key, the payload only adds to the memory footprint.
+static int key_compare(void* c1, void* c2){
+    comparisons++;
+    uint64_t k1 = *(uint64_t*)c1;
+    uint64_t k2 = *(uint64_t*)c2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static int hist_bucket(uint64_t value){
+    if(value < (1ULL << BENCH_HIST_SUB_BITS)){
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (msb - BENCH_HIST_SUB_BITS)) & ((1 << BENCH_HIST_SUB_BITS) - 1));
+    return ((msb - BENCH_HIST_SUB_BITS + 1) << BENCH_HIST_SUB_BITS) + sub;
+}
+
+// The upper bound of the values counted in a bucket.
+static uint64_t hist_value(int bucket){
+    if(bucket < (1 << BENCH_HIST_SUB_BITS)){
+        return (uint64_t)bucket;
+    }
+    int msb = (bucket >> BENCH_HIST_SUB_BITS) + BENCH_HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket & ((1 << BENCH_HIST_SUB_BITS) - 1));
+    return ((1ULL << BENCH_HIST_SUB_BITS) + sub + 1) << (msb - BENCH_HIST_SUB_BITS);
+}
+
+static void hist_record(struct bench_hist* hist, uint64_t value){
+    hist->counts[hist_bucket(value)]++;
+    hist->total++;
+}
+
+static uint64_t hist_percentile(struct bench_hist* hist, double percentile){
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hist->total);
+    uint64_t seen = 0;
+    for(int i = 0; i < BENCH_HIST_BUCKETS; i++){
+        seen += hist->counts[i];
+        if(seen > rank){
+            return hist_value(i);
+        }
+    }
+    return 0;
+}
+
+struct bench_result{
+    const char* phase;
+    uint64_t ops;
+    uint64_t elapsed_ns;
+    uint64_t comparisons;
+    struct bench_hist hist;
+};
+
+static void print_result(FILE* out, int* first, const char* workload, size_t size, size_t payload,
+                         struct bench_result* result, uint64_t timer_ns){
+    fprintf(out, "%s  {\"workload\": \"%s\", \"phase\": \"%s\", \"size\": %zu, \"payload\": %zu, \"ops\": %llu, "
+                 "\"ns_per_op\": %.2f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, "
+                 "\"comparisons_per_op\": %.3f, \"timer_overhead_ns\": %llu}",
+            *first ? "" : ",\n", workload, result->phase, size, payload, (unsigned long long)result->ops,
+            (double)result->elapsed_ns / (double)result->ops,
+            (unsigned long long)hist_percentile(&result->hist, 50.0),
+            (unsigned long long)hist_percentile(&result->hist, 99.0),
+            (unsigned long long)hist_percentile(&result->hist, 99.9),
+            (double)result->comparisons / (double)result->ops, (unsigned long long)timer_ns);
+    *first = 0;
+    fflush(out);
+}
+
+static uint64_t workload_key(int workload, size_t i, size_t n){
+    switch(workload){
+        case WORKLOAD_SORTED:
+            return i;
+        case WORKLOAD_REVERSE:
+            return n - i;
+        case WORKLOAD_DUPLICATES:
+            return rng_next() % 16;
+        default:
+            return rng_next();
+    }
+}
+
+static int run_one(FILE* out, int* first, int workload, size_t n, size_t payload, size_t hold_ops,
+                   uint32_t trace_sample, uint64_t timer_ns){
+    size_t stride = (sizeof(uint64_t) + payload + 7) & ~(size_t)7;
+    unsigned char* pool = calloc(n + 1, stride);
+    struct prio_queue_handle* hnd = NULL;
+    if(pool == NULL || prio_queue_init(&hnd, n + 1, &key_compare) != CST_OK){
+        fprintf(stderr, "Init Fail for size %zu\n", n);
+        free(pool);
+        return 1;
+    }
+#if PRIO_QUEUE_TRACE_ENABLED
+    prio_queue_set_trace(hnd, NULL, NULL, trace_sample);
+#else
+    (void)trace_sample;
+#endif
+
+    struct bench_result* result = calloc(1, sizeof(struct bench_result));
+    if(result == NULL){
+        prio_queue_free(hnd);
+        free(pool);
+        return 1;
+    }
+
+    const char* name = workload_names[workload];
+    int fill_workload = workload == WORKLOAD_HOLD ? WORKLOAD_RANDOM : workload;
+
+    // Fill, timed for every workload except hold where it is only the setup.
+    memset(result, 0, sizeof(struct bench_result));
+    result->phase = "insert";
+    comparisons = 0;
+    uint64_t start = now_ns();
+    for(size_t i = 0; i < n; i++){
+        unsigned char* item = pool + i * stride;
+        *(uint64_t*)item = workload_key(fill_workload, i, n);
+        uint64_t t0 = now_ns();
+        prio_queue_insert(hnd, item);
+        hist_record(&result->hist, now_ns() - t0);
+    }
+    result->elapsed_ns = now_ns() - start;
+    result->ops = n;
+    result->comparisons = comparisons;
+    if(workload != WORKLOAD_HOLD){
+        print_result(out, first, name, n, payload, result, timer_ns);
+    }
+
+    if(workload == WORKLOAD_HOLD){
+        memset(result, 0, sizeof(struct bench_result));
+        result->phase = "hold";
+        comparisons = 0;
+        start = now_ns();
+        for(size_t i = 0; i < hold_ops; i++){
+            void* item = NULL;
+            uint64_t t0 = now_ns();
+            prio_queue_remove(hnd, &item);
+            *(uint64_t*)item += rng_next() % (n * 2 + 1);
+            prio_queue_insert(hnd, item);
+            hist_record(&result->hist, now_ns() - t0);
+        }
+        result->elapsed_ns = now_ns() - start;
+        result->ops = hold_ops;
+        result->comparisons = comparisons;
+        print_result(out, first, name, n, payload, result, timer_ns);
+    }
+
+    memset(result, 0, sizeof(struct bench_result));
+    result->phase = "remove";
+    comparisons = 0;
+    start = now_ns();
+    uint64_t last = 0;
+    size_t bad = 0;
+    for(size_t i = 0; i < n; i++){
+        void* item = NULL;
+        uint64_t t0 = now_ns();
+        prio_queue_remove(hnd, &item);
+        hist_record(&result->hist, now_ns() - t0);
+        if(*(uint64_t*)item < last){
+            bad++;
+        }
+        last = *(uint64_t*)item;
+    }
+    result->elapsed_ns = now_ns() - start;
+    result->ops = n;
+    result->comparisons = comparisons;
+    print_result(out, first, name, n, payload, result, timer_ns);
+
+    free(result);
+    prio_queue_free(hnd);
+    free(pool);
+    if(bad != 0){
+        fprintf(stderr, "%s/%zu: %zu items out of order\n", name, n, bad);
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_list(const char* arg, size_t* list, int max){
+    int count = 0;
+    char* end = NULL;
+    while(*arg != '\0' && count < max){
+        list[count++] = strtoull(arg, &end, 10);
+        if(*end != ','){
+            break;
+        }
+        arg = end + 1;
+    }
+    return count;
+}
+
+static int parse_args(struct bench_config* config, int argc, char** argv){
+    for(int w = 0; w < WORKLOAD_COUNT; w++){
+        config->workloads[w] = 1;
+    }
+    size_t sizes[] = {1000, 10000, 100000, 1000000};
+    config->size_count = 4;
+    memcpy(config->sizes, sizes, sizeof(sizes));
+    size_t payloads[] = {8, 64, 256};
+    config->payload_count = 3;
+    memcpy(config->payloads, payloads, sizeof(payloads));
+    config->hold_ops = 1000000;
+    config->seed = 88172645463325252ULL;
+    config->out = NULL;
+    config->trace_sample = 0;
+
+    for(int i = 1; i < argc; i++){
+        if(strncmp(argv[i], "--workloads=", 12) == 0){
+            for(int w = 0; w < WORKLOAD_COUNT; w++){
+                config->workloads[w] = strstr(argv[i] + 12, workload_names[w]) != NULL;
+            }
+        } else if(strncmp(argv[i], "--sizes=", 8) == 0){
+            config->size_count = parse_list(argv[i] + 8, config->sizes, BENCH_MAX_LIST);
+        } else if(strncmp(argv[i], "--payloads=", 11) == 0){
+            config->payload_count = parse_list(argv[i] + 11, config->payloads, BENCH_MAX_LIST);
+        } else if(strncmp(argv[i], "--hold-ops=", 11) == 0){
+            config->hold_ops = strtoull(argv[i] + 11, NULL, 10);
+        } else if(strncmp(argv[i], "--seed=", 7) == 0){
+            config->seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if(strncmp(argv[i], "--out=", 6) == 0){
+            config->out = argv[i] + 6;
+        } else if(strncmp(argv[i], "--trace-sample=", 15) == 0){
+#if PRIO_QUEUE_TRACE_ENABLED
+            config->trace_sample = (uint32_t)strtoul(argv[i] + 15, NULL, 10);
+#else
+            fprintf(stderr, "--trace-sample needs a build with CSTRUCTURES_TRACE\n");
+            return 1;
+#endif
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv){
+    struct bench_config config;
+    if(parse_args(&config, argc, argv) != 0){
+        return 1;
+    }
+
+    FILE* out = config.out ? fopen(config.out, "w") : stdout;
+    if(out == NULL){
+        fprintf(stderr, "Could not open %s\n", config.out);
+        return 1;
+    }
+
+    // Cost of reading the clock, included in every latency.
+    uint64_t start = now_ns();
+    for(int i = 0; i < 1000; i++){
+        now_ns();
+    }
+    uint64_t timer_ns = (now_ns() - start) / 1000;
+
+    int failed = 0;
+    int first = 1;
+    fprintf(out, "[\n");
+    for(int w = 0; w < WORKLOAD_COUNT; w++){
+        if(!config.workloads[w]){
+            continue;
+        }
+        for(int s = 0; s < config.size_count; s++){
+            for(int p = 0; p < config.payload_count; p++){
+                // Same keys for every run of a workload and size.
+                rng_state = config.seed;
+                failed |= run_one(out, &first, w, config.sizes[s], config.payloads[p], config.hold_ops,
+                                  config.trace_sample, timer_ns);
+            }
+        }
+    }
+    fprintf(out, "\n]\n");
+
+    if(out != stdout){
+        fclose(out);
+    }
+    return failed;
+}
@@ -0,0 +1,159 @@
+
+/*
+ * cstructures::priority_queue against std::priority_queue and the C prio_queue.
+ *
+ * Fill and drain inserts n random keys and removes them all, hold keeps n items queued and times remove + insert
+ * pairs. The C queue is used the way a C++ wrapper around it would be, with one allocation per item. Each phase
+ * reports the fastest of BENCH_REPS runs, the results vary a lot between runs on a busy machine.
+ *
+ * Usage: prio_queue_cpp_bench [n] [hold ops]
+ */
+
+#include "../include/prio_queue.hpp"
+#include "../include/prio_queue.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#define BENCH_REPS 3    /** Every phase reports the fastest of this many runs. */
+
+struct record{
+    uint64_t key;
+    uint64_t payload[3];
+
+    bool operator>(const record& other) const { return key > other.key; }
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static uint64_t key_of(uint64_t key){ return key; }
+static uint64_t key_of(const record& item){ return item.key; }
+static void set_key(uint64_t& key, uint64_t value){ key = value; }
+static void set_key(record& item, uint64_t value){ item.key = value; }
+
+static double now_ns(){
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Adapts std::priority_queue to the pop-returns-the-item interface.
+template <class T>
+struct std_queue{
+    std::priority_queue<T, std::vector<T>, std::greater<T>> queue;
+
+    void push(const T& item){ queue.push(item); }
+    T pop(){ T item = queue.top(); queue.pop(); return item; }
+};
+
+template <class T, std::size_t Arity>
+struct cst_queue{
+    cstructures::priority_queue<T, std::greater<T>, Arity> queue;
+
+    void push(const T& item){ queue.push(item); }
+    T pop(){ return queue.pop(); }
+};
+
+template <class T>
+static int c_compare(void* c1, void* c2){
+    uint64_t k1 = key_of(*(T*)c1);
+    uint64_t k2 = key_of(*(T*)c2);
+    return (k1 > k2) - (k1 < k2);
+}
+
+// A C++ wrapper over the type erased C queue, the status quo.
+template <class T>
+struct c_queue{
+    struct prio_queue_handle* hnd = nullptr;
+
+    c_queue(){ prio_queue_init(&hnd, 1024, &c_compare<T>); }
+    ~c_queue(){ prio_queue_free(hnd); }
+
+    void push(const T& item){
+        T* copy = new T(item);
+        if(prio_queue_insert(hnd, copy) == CST_OVERFLOW){
+            prio_queue_resize(hnd, (size_t)prio_queue_size(hnd) * 2);
+            prio_queue_insert(hnd, copy);
+        }
+    }
+    T pop(){
+        void* data = nullptr;
+        prio_queue_remove(hnd, &data);
+        T item = *(T*)data;
+        delete (T*)data;
+        return item;
+    }
+};
+
+template <class Queue, class T>
+static void run(const char* name, size_t n, size_t hold_ops){
+    double fill = 0, hold = 0, drain = 0;
+    size_t bad = 0;
+    for(int rep = 0; rep < BENCH_REPS; rep++){
+        Queue queue;
+        T item{};
+        rng_state = 88172645463325252ULL;
+
+        double start = now_ns();
+        for(size_t i = 0; i < n; i++){
+            set_key(item, rng_next());
+            queue.push(item);
+        }
+        double elapsed = now_ns() - start;
+        fill = rep == 0 || elapsed < fill ? elapsed : fill;
+
+        start = now_ns();
+        for(size_t i = 0; i < hold_ops; i++){
+            T top = queue.pop();
+            set_key(top, key_of(top) + rng_next() % (n * 2 + 1));
+            queue.push(top);
+        }
+        elapsed = now_ns() - start;
+        hold = rep == 0 || elapsed < hold ? elapsed : hold;
+
+        start = now_ns();
+        uint64_t last = 0;
+        for(size_t i = 0; i < n; i++){
+            T top = queue.pop();
+            bad += key_of(top) < last;
+            last = key_of(top);
+        }
+        elapsed = now_ns() - start;
+        drain = rep == 0 || elapsed < drain ? elapsed : drain;
+    }
+
+    printf("%-28s %10.1f %10.1f %10.1f%s\n", name, fill / (double)n, hold / (double)hold_ops, drain / (double)n,
+           bad ? "  out of order" : "");
+}
+
+template <class T>
+static void run_all(const char* type, size_t n, size_t hold_ops){
+    char title[64];
+    snprintf(title, sizeof(title), "%s, n = %zu", type, n);
+    printf("\n%-28s %10s %10s %10s\n", title, "push ns", "hold ns", "pop ns");
+    run<c_queue<T>, T>("prio_queue (new per item)", n, hold_ops);
+    run<std_queue<T>, T>("std::priority_queue", n, hold_ops);
+    run<cst_queue<T, 2>, T>("cstructures arity 2", n, hold_ops);
+    run<cst_queue<T, 4>, T>("cstructures arity 4", n, hold_ops);
+    run<cst_queue<T, 8>, T>("cstructures arity 8", n, hold_ops);
+}
+
+int main(int argc, char** argv){
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    size_t hold_ops = argc > 2 ? strtoull(argv[2], NULL, 10) : 2000000;
+
+    run_all<uint64_t>("uint64_t", n, hold_ops);
+    run_all<record>("32 byte record", n, hold_ops);
+    return 0;
+}
@@ -0,0 +1,218 @@
+
+/*
+ * Sharded queue against one prio_queue behind a mutex, every thread pinned to a CPU.
+ *
+ * Threads run the hold model on a queue prefilled with n keys, every operation removes an item and re-inserts it with
+ * a larger key. Threads are pinned round robin to the CPUs the process may use, so on a NUMA machine they insert
+ * into their own node's shard. Runs with one shard per NUMA node and with one shard per thread, on a single node
+ * machine the first has one shard and shows the cost of the sharding layer itself. Fastest of three runs.
+ *
+ * Usage: sharded_bench [n] [threads] [ops per thread]
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "../include/prio_queue.h"
+#include "../include/sharded_prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if SHARDED_PRIO_QUEUE_ENABLED
+
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_REPS 3 /** Every configuration runs this often, the fastest run is reported. */
+
+struct worker{
+    struct prio_queue_handle* pq;
+    pthread_mutex_t* lock;
+    struct sharded_prio_queue_handle* spq;
+    int cpu;
+    size_t ops;
+    uint64_t seed;
+};
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_next(uint64_t* state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int key_compare(void* c1, void* c2){
+    uint64_t k1 = *(uint64_t*)c1;
+    uint64_t k2 = *(uint64_t*)c2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static void pin(int cpu){
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+static void* hold(void* arg){
+    struct worker* worker = arg;
+    pin(worker->cpu);
+    for(size_t i = 0; i < worker->ops; i++){
+        void* data = NULL;
+        cst_err e;
+        if(worker->spq != NULL){
+            e = sharded_prio_queue_remove(worker->spq, &data);
+        } else {
+            pthread_mutex_lock(worker->lock);
+            e = prio_queue_remove(worker->pq, &data);
+            pthread_mutex_unlock(worker->lock);
+        }
+        if(e != CST_OK){
+            continue;
+        }
+        *(uint64_t*)data += 1 + rng_next(&worker->seed) % 1024;
+        if(worker->spq != NULL){
+            sharded_prio_queue_insert(worker->spq, data);
+        } else {
+            pthread_mutex_lock(worker->lock);
+            prio_queue_insert(worker->pq, data);
+            pthread_mutex_unlock(worker->lock);
+        }
+    }
+    return NULL;
+}
+
+static int* allowed_cpus(int* count){
+    int* cpus = malloc(sizeof(int) * CPU_SETSIZE);
+    *count = 0;
+#if defined(__linux__)
+    cpu_set_t set;
+    if(cpus != NULL && sched_getaffinity(0, sizeof(set), &set) == 0){
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if(CPU_ISSET(cpu, &set)){
+                cpus[(*count)++] = cpu;
+            }
+        }
+    }
+#endif
+    if(cpus != NULL && *count == 0){
+        cpus[(*count)++] = 0;
+    }
+    return cpus;
+}
+
+// shards < 0 runs the mutex baseline. Returns the seconds taken and the number of shards used.
+static double run_once(long shards, uint64_t* keys, size_t n, unsigned int threads, size_t ops, int* cpus,
+                       int cpu_count, int* used){
+    struct prio_queue_handle* pq = NULL;
+    struct sharded_prio_queue_handle* spq = NULL;
+    pthread_mutex_t lock;
+    pthread_mutex_init(&lock, NULL);
+
+    uint64_t seed = 88172645463325252ULL;
+    for(size_t i = 0; i < n; i++){
+        keys[i] = rng_next(&seed) % (n * 16);
+    }
+    if(shards < 0){
+        prio_queue_init(&pq, n, &key_compare);
+        for(size_t i = 0; i < n; i++){
+            prio_queue_insert(pq, &keys[i]);
+        }
+    } else {
+        sharded_prio_queue_init(&spq, (size_t)shards, n / threads + 1, &key_compare);
+        for(size_t i = 0; i < n; i++){
+            sharded_prio_queue_insert_shard(spq, i % sharded_prio_queue_shards(spq), &keys[i]);
+        }
+    }
+
+    struct worker* workers = malloc(sizeof(struct worker) * threads);
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    double start = now_sec();
+    for(unsigned int t = 0; t < threads; t++){
+        workers[t].pq = pq;
+        workers[t].lock = &lock;
+        workers[t].spq = spq;
+        workers[t].cpu = cpus[t % (unsigned int)cpu_count];
+        workers[t].ops = ops;
+        workers[t].seed = 0x9E3779B97F4A7C15ULL * (t + 1);
+        pthread_create(&ids[t], NULL, &hold, &workers[t]);
+    }
+    for(unsigned int t = 0; t < threads; t++){
+        pthread_join(ids[t], NULL);
+    }
+    double elapsed = now_sec() - start;
+    *used = spq ? (int)sharded_prio_queue_shards(spq) : 1;
+
+    free(workers);
+    free(ids);
+    if(pq != NULL){
+        prio_queue_free(pq);
+    }
+    sharded_prio_queue_free(spq);
+    pthread_mutex_destroy(&lock);
+    return elapsed;
+}
+
+static void run(const char* name, long shards, uint64_t* keys, size_t n, unsigned int threads, size_t ops,
+                int* cpus, int cpu_count){
+    double best = 0;
+    int used = 0;
+    for(int rep = 0; rep < BENCH_REPS; rep++){
+        double elapsed = run_once(shards, keys, n, threads, ops, cpus, cpu_count, &used);
+        if(rep == 0 || elapsed < best){
+            best = elapsed;
+        }
+    }
+    double total = (double)threads * (double)ops;
+    printf("%-20s shards %2d: %.3f s, %.1f ns/op\n", name, used, best, best * 1e9 / total);
+}
+
+#endif
+
+int main(int argc, char** argv){
+#if SHARDED_PRIO_QUEUE_ENABLED
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    unsigned int threads = argc > 2 ? (unsigned int)strtoul(argv[2], NULL, 10) : 4;
+    size_t ops = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000000;
+    if(threads == 0){
+        threads = 1;
+    }
+
+    uint64_t* keys = malloc(sizeof(uint64_t) * n);
+    int cpu_count = 0;
+    int* cpus = allowed_cpus(&cpu_count);
+    if(keys == NULL || cpus == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+    printf("threads: %u on %d CPUs, items: %zu, NUMA: %s\n", threads, cpu_count, n,
+           SHARDED_PRIO_QUEUE_NUMA_ENABLED ? "libnuma" : "off");
+
+    run("mutex prio_queue", -1, keys, n, threads, ops, cpus, cpu_count);
+    run("sharded per node", 0, keys, n, threads, ops, cpus, cpu_count);
+    run("sharded per thread", (long)threads, keys, n, threads, ops, cpus, cpu_count);
+
+    free(cpus);
+    free(keys);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    printf("Sharded queue disabled\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,118 @@
+
+/*
+ * Throughput of prio_queue_snapshot and prio_queue_restore.
+ *
+ * Usage: snapshot_bench [items] [path]
+ */
+
+#include "../include/prio_queue.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct item{
+    uint64_t key;
+    uint64_t payload;
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int item_compare(void* c1, void* c2){
+    uint64_t k1 = ((struct item*)c1)->key;
+    uint64_t k2 = ((struct item*)c2)->key;
+    return (k1 > k2) - (k1 < k2);
+}
+
+static size_t item_serialize(void* data, void* buf, size_t cap){
+    if(cap >= sizeof(struct item)){
+        memcpy(buf, data, sizeof(struct item));
+    }
+    return sizeof(struct item);
+}
+
+// Restored items come out of one big pool, the benchmark measures the format and not malloc.
+static struct item* restore_pool = NULL;
+static size_t restore_used = 0;
+
+static void* item_deserialize(const void* buf, size_t len){
+    struct item* data = &restore_pool[restore_used++];
+    if(len == sizeof(struct item)){
+        memcpy(data, buf, sizeof(struct item));
+    }
+    return data;
+}
+
+int main(int argc, char** argv){
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    const char* path = argc > 2 ? argv[2] : "snapshot_bench.bin";
+
+    struct item* items = malloc(sizeof(struct item) * n);
+    restore_pool = malloc(sizeof(struct item) * n);
+    struct prio_queue_handle* hnd = NULL;
+    if(items == NULL || restore_pool == NULL || prio_queue_init(&hnd, n, &item_compare) != CST_OK){
+        printf("Init Fail\n");
+        return 1;
+    }
+    for(size_t i = 0; i < n; i++){
+        items[i].key = rng_next();
+        items[i].payload = i;
+        prio_queue_insert(hnd, &items[i]);
+    }
+
+    FILE* file = fopen(path, "w+b");
+    if(file == NULL){
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+
+    double start = now_sec();
+    if(prio_queue_snapshot(hnd, file, &item_serialize) != CST_OK){
+        printf("Snapshot Failed\n");
+        return 1;
+    }
+    double snapshot = now_sec() - start;
+    double mb = ftell(file) / (1024.0 * 1024.0);
+
+    rewind(file);
+    struct prio_queue_handle* restored = NULL;
+    start = now_sec();
+    if(prio_queue_restore(&restored, file, &item_compare, &item_deserialize, NULL) != CST_OK){
+        printf("Restore Failed\n");
+        return 1;
+    }
+    double restore = now_sec() - start;
+
+    void* first = NULL;
+    void* expected = NULL;
+    prio_queue_peek(restored, &first);
+    prio_queue_peek(hnd, &expected);
+
+    printf("items: %zu, snapshot size: %.1f MB\n", n, mb);
+    printf("snapshot: %.3f s, %.1f ns/item, %.1f MB/s\n", snapshot, snapshot * 1e9 / n, mb / snapshot);
+    printf("restore:  %.3f s, %.1f ns/item, %.1f MB/s\n", restore, restore * 1e9 / n, mb / restore);
+    printf("root matches: %s\n", ((struct item*)first)->key == ((struct item*)expected)->key ? "yes" : "no");
+
+    fclose(file);
+    remove(path);
+    prio_queue_free(restored);
+    prio_queue_free(hnd);
+    free(restore_pool);
+    free(items);
+    return 0;
+}
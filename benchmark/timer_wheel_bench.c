@@ -0,0 +1,180 @@
+
+/*
+ * Timeout churn benchmark, timer_wheel against a plain prio_queue.
+ *
+ * Simulates connections which each hold a timeout and re-arm it on activity, so most timeouts are cancelled before
+ * they fire. The prio_queue cannot cancel, it has to leave stale entries behind and skip them when they surface.
+ *
+ * Usage: timer_wheel_bench [connections] [ticks]
+ */
+
+#include "../include/timer_wheel.h"
+#include "../include/prio_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TIMEOUT_TICKS 30000   /** A 30 second timeout on a millisecond tick. */
+#define EVENTS_PER_TICK 200   /** Connections with activity every tick. */
+
+struct connection{
+    struct timer_wheel_timer* timer;
+    uint64_t deadline;
+};
+
+struct heap_entry{
+    uint64_t deadline;
+    struct connection* conn;
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng_next(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_sec(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int heap_compare(void* c1, void* c2){
+    uint64_t d1 = ((struct heap_entry*)c1)->deadline;
+    uint64_t d2 = ((struct heap_entry*)c2)->deadline;
+    return (d1 > d2) - (d1 < d2);
+}
+
+static void on_expire(void* data, void* ctx){
+    struct connection* conn = data;
+    conn->timer = NULL;
+    (*(size_t*)ctx)++;
+}
+
+static uint64_t timeout_for(void){
+    // Mostly the default timeout with some jitter, a few long lived keep-alives far in the future.
+    if(rng_next() % 1000 == 0){
+        return TIMEOUT_TICKS * 1000ULL + rng_next() % TIMEOUT_TICKS;
+    }
+    return TIMEOUT_TICKS + rng_next() % 1000;
+}
+
+static double bench_wheel(struct connection* conns, size_t n, uint64_t ticks, size_t* expired){
+    struct timer_wheel_handle* hnd = NULL;
+    if(timer_wheel_init(&hnd, 0) != CST_OK){
+        return -1;
+    }
+    rng_state = 88172645463325252ULL;
+    for(size_t i = 0; i < n; i++){
+        timer_wheel_schedule(hnd, timeout_for(), &conns[i], &conns[i].timer);
+    }
+
+    double start = now_sec();
+    for(uint64_t tick = 1; tick <= ticks; tick++){
+        for(int e = 0; e < EVENTS_PER_TICK; e++){
+            struct connection* conn = &conns[rng_next() % n];
+            if(conn->timer != NULL){
+                timer_wheel_cancel(hnd, conn->timer, NULL);
+            }
+            timer_wheel_schedule(hnd, tick + timeout_for(), conn, &conn->timer);
+        }
+        timer_wheel_advance(hnd, tick, &on_expire, expired);
+    }
+    double elapsed = now_sec() - start;
+
+    timer_wheel_free(hnd);
+    return elapsed;
+}
+
+static double bench_heap(struct connection* conns, size_t n, uint64_t ticks, size_t* expired){
+    struct prio_queue_handle* hnd = NULL;
+    if(prio_queue_init(&hnd, n * 2, &heap_compare) != CST_OK){
+        return -1;
+    }
+    // Entries are recycled once they surface, the pool only has to cover what can be in the heap at once.
+    size_t pool_size = n + (size_t)(TIMEOUT_TICKS * 1001ULL + 1) * EVENTS_PER_TICK;
+    if(pool_size > n + (size_t)ticks * EVENTS_PER_TICK){
+        pool_size = n + (size_t)ticks * EVENTS_PER_TICK;
+    }
+    struct heap_entry* pool = malloc(sizeof(struct heap_entry) * pool_size);
+    struct heap_entry** free_entries = malloc(sizeof(struct heap_entry*) * pool_size);
+    if(pool == NULL || free_entries == NULL){
+        free(pool);
+        free(free_entries);
+        prio_queue_free(hnd);
+        return -1;
+    }
+    size_t free_count = 0;
+    for(size_t i = 0; i < pool_size; i++){
+        free_entries[free_count++] = &pool[pool_size - 1 - i];
+    }
+
+    rng_state = 88172645463325252ULL;
+    for(size_t i = 0; i < n; i++){
+        struct heap_entry* entry = free_entries[--free_count];
+        entry->deadline = timeout_for();
+        entry->conn = &conns[i];
+        conns[i].deadline = entry->deadline;
+        prio_queue_insert(hnd, entry);
+    }
+
+    double start = now_sec();
+    for(uint64_t tick = 1; tick <= ticks; tick++){
+        for(int e = 0; e < EVENTS_PER_TICK; e++){
+            struct connection* conn = &conns[rng_next() % n];
+            struct heap_entry* entry = free_entries[--free_count];
+            entry->deadline = tick + timeout_for();
+            entry->conn = conn;
+            // The old entry stays in the heap, it is recognised as stale by its deadline.
+            conn->deadline = entry->deadline;
+            if(prio_queue_insert(hnd, entry) == CST_OVERFLOW){
+                prio_queue_resize(hnd, (size_t)prio_queue_size(hnd) * 2);
+                prio_queue_insert(hnd, entry);
+            }
+        }
+        void* top = NULL;
+        while(prio_queue_size(hnd) > 0 && prio_queue_peek(hnd, &top) == CST_OK &&
+              ((struct heap_entry*)top)->deadline <= tick){
+            prio_queue_remove(hnd, &top);
+            struct heap_entry* entry = top;
+            if(entry->conn->deadline == entry->deadline){
+                (*expired)++;
+            }
+            free_entries[free_count++] = entry;
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    free(free_entries);
+    free(pool);
+    prio_queue_free(hnd);
+    return elapsed;
+}
+
+int main(int argc, char** argv){
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    uint64_t ticks = argc > 2 ? strtoull(argv[2], NULL, 10) : 40000;
+
+    struct connection* conns = calloc(n, sizeof(struct connection));
+    if(conns == NULL){
+        printf("Alloc Failed\n");
+        return 1;
+    }
+
+    double ops = (double)ticks * EVENTS_PER_TICK;
+    size_t wheel_expired = 0;
+    double wheel = bench_wheel(conns, n, ticks, &wheel_expired);
+    size_t heap_expired = 0;
+    double heap = bench_heap(conns, n, ticks, &heap_expired);
+
+    printf("connections: %zu, ticks: %llu, re-arms: %.0f\n", n, (unsigned long long)ticks, ops);
+    printf("timer_wheel: %.3f s, %.1f ns/re-arm, %zu expired\n", wheel, wheel * 1e9 / ops, wheel_expired);
+    printf("prio_queue:  %.3f s, %.1f ns/re-arm, %zu expired\n", heap, heap * 1e9 / ops, heap_expired);
+
+    free(conns);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Aging Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_AGING_PRIO_QUEUE_H
+#define CSTRUCTURES_AGING_PRIO_QUEUE_H
+
+/**
+ * @file aging_prio_queue.h
+ * @brief A Priority Queue with built in priority aging for c.
+ *
+ * Every item has a numeric base priority and an age class, the lowest effective priority is removed first. Waiting
+ * lowers the effective priority by the rate of the item's class per tick:
+ *
+ *     effective(now) = base - rate * (now - inserted)
+ *
+ * so old items eventually overtake newer ones with a better base priority and nothing starves, without draining and
+ * re-inserting the queue. Written as (base + rate * inserted) - rate * now, the first term is fixed at insert and
+ * stored as the item's key, and items of one class never change order. Each class is its own heap on that key, remove
+ * compares the tops of the non empty classes at the current time. Insert is O(log n), remove O(log n + classes).
+ *
+ * Ticks are whatever unit the caller uses, they are measured from the tick passed to init and must not go backwards.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define AGING_PRIO_QUEUE_RESIZE_ENABLED CSTRUCTURES_GLOBAL_RESIZE_ENABLE
+
+#define AGING_PRIO_QUEUE_MAX_CLASSES 64 /** The largest number of age classes supported. */
+
+/** @brief A handle for the aging priority queue. */
+struct aging_prio_queue_handle;
+
+/**
+ * @brief Initializes a new aging priority queue.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param max_size The maximum size of the aging priority queue.
+ * @param rates The aging rate of every class in priority per tick, not negative, 0 disables aging for a class.
+ * @param classes The number of age classes, from 1 to AGING_PRIO_QUEUE_MAX_CLASSES.
+ * @param now The current tick, ages are measured from here.
+ *
+ * @return CST_OK if successful, CST_PARAM_ERR if the classes or rates are out of range.
+ */
+cst_err aging_prio_queue_init(struct aging_prio_queue_handle** hnd, size_t max_size, const double* rates,
+                              size_t classes, uint64_t now);
+
+/**
+ * @brief Frees an allocated aging priority queue.
+ *
+ * @param hnd The aging priority queue handle which is to be freed.
+ */
+void aging_prio_queue_free(struct aging_prio_queue_handle* hnd);
+
+/**
+ * @brief Insert new data into the aging priority queue.
+ *
+ * @param hnd The aging priority queue in which you would like to insert the data.
+ * @param data A pointer to the data which is to be inserted.
+ * @param base The base priority of the data, lower is removed first.
+ * @param age_class The age class of the data, selects its aging rate.
+ * @param now The current tick.
+ *
+ * @return CST_OK if successful, CST_OVERFLOW if the queue is full, CST_PARAM_ERR if the class or tick is out of range.
+ */
+cst_err aging_prio_queue_insert(struct aging_prio_queue_handle* hnd, void* data, double base, size_t age_class,
+                                uint64_t now);
+
+/**
+ * @brief Remove the item with the lowest effective priority.
+ *
+ * @param hnd The queue from which you would like to remove the data.
+ * @param data The data which you would like to remove.
+ * @param now The current tick.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err aging_prio_queue_remove(struct aging_prio_queue_handle* hnd, void** data, uint64_t now);
+
+/**
+ * @brief Get the item with the lowest effective priority without removing it.
+ *
+ * @param hnd The queue to look at.
+ * @param data The next item is placed here.
+ * @param priority If not NULL the effective priority of the item at now is placed here.
+ * @param now The current tick.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err aging_prio_queue_peek(struct aging_prio_queue_handle* hnd, void** data, double* priority, uint64_t now);
+
+/**
+ * @brief Get the current size of the aging priority queue.
+ *
+ * @param hnd The queue to get the size of.
+ *
+ * @return The size of the queue.
+ */
+int aging_prio_queue_size(struct aging_prio_queue_handle* hnd);
+
+#if AGING_PRIO_QUEUE_RESIZE_ENABLED
+
+/**
+ * @brief Will attempt to resize the aging priority queue maximum.
+ *
+ * @param hnd The queue which needs to be resized.
+ * @param new_size The new size of the queue, not below the current size.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err aging_prio_queue_resize(struct aging_prio_queue_handle* hnd, size_t new_size);
+
+#endif
+
+#endif //CSTRUCTURES_AGING_PRIO_QUEUE_H
@@ -0,0 +1,124 @@
+/*
+ * Async Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_ASYNC_PRIO_QUEUE_H
+#define CSTRUCTURES_ASYNC_PRIO_QUEUE_H
+
+/**
+ * @file async_prio_queue.h
+ * @brief A thread safe Priority Queue with a pollable file descriptor for c.
+ *
+ * Wraps a prio_queue in a mutex and keeps a file descriptor which is readable whenever the queue holds items, so an
+ * event loop can wait for work with epoll, poll or select next to its sockets instead of blocking a thread on the queue
+ * or polling it. On Linux the descriptor is an eventfd, elsewhere the read end of a pipe.
+ *
+ * The descriptor is only written when the queue goes from empty to not empty and only drained when a remove empties
+ * it, so producers pay for a system call once per burst. With edge triggered epoll a consumer must remove until
+ * CST_EMPTY before waiting again.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASYNC_PRIO_QUEUE_ENABLED CSTRUCTURES_GLOBAL_PARALLEL_ENABLE /** The queue needs pthreads. */
+
+#if ASYNC_PRIO_QUEUE_ENABLED
+
+/** @brief A handle for the async priority queue. */
+struct async_prio_queue_handle;
+
+/**
+ * @brief Initializes a new async priority queue.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param max_size The initial maximum size of the queue, a full queue doubles on insert.
+ * @param comparator A pointer to the callback function which compares data, see prio_queue_init.
+ *
+ * @return CST_OK if successful, CST_IO_ERR if the file descriptor could not be created.
+ */
+cst_err async_prio_queue_init(struct async_prio_queue_handle** hnd, size_t max_size,
+                              int (comparator)(void* c1, void* c2));
+
+/**
+ * @brief Frees an async priority queue and closes its file descriptor, no thread may be using the queue.
+ *
+ * @param hnd The async priority queue handle which is to be freed.
+ */
+void async_prio_queue_free(struct async_prio_queue_handle* hnd);
+
+/**
+ * @brief Inserts an item, making the file descriptor readable if the queue was empty. Safe from any thread.
+ *
+ * @param hnd The async priority queue.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err async_prio_queue_insert(struct async_prio_queue_handle* hnd, void* data);
+
+/**
+ * @brief Removes the highest priority item without blocking. Safe from any thread.
+ *
+ * @param hnd The async priority queue.
+ * @param data A pointer to where the removed data will be placed.
+ *
+ * @return CST_OK if successful, CST_EMPTY if there was nothing to remove.
+ */
+cst_err async_prio_queue_remove(struct async_prio_queue_handle* hnd, void** data);
+
+/**
+ * @brief Get the file descriptor to wait on, it is readable while the queue is not empty.
+ *
+ * The descriptor is owned by the queue, only wait on it, never read or close it.
+ *
+ * @param hnd The async priority queue.
+ *
+ * @return The file descriptor, -1 if hnd is NULL.
+ */
+int async_prio_queue_fd(struct async_prio_queue_handle* hnd);
+
+/**
+ * @brief Get the number of items in the queue.
+ *
+ * @param hnd The async priority queue to get the size of.
+ *
+ * @return The number of items, only a snapshot when other threads use the queue.
+ */
+size_t async_prio_queue_size(struct async_prio_queue_handle* hnd);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CSTRUCTURES_ASYNC_PRIO_QUEUE_H
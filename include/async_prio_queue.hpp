@@ -0,0 +1,213 @@
+/*
+ * Async Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_ASYNC_PRIO_QUEUE_HPP
+#define CSTRUCTURES_ASYNC_PRIO_QUEUE_HPP
+
+/**
+ * @file async_prio_queue.hpp
+ * @brief A header only awaitable Priority Queue Template for c++20 coroutines.
+ *
+ * co_await q.pop() returns the item with the highest priority, suspending the coroutine while the queue is empty.
+ * Suspended consumers are kept in a FIFO list and a push hands its item straight to the longest waiting one and resumes
+ * it on the pushing thread, so a producer wakes a consumer without a system call or a context switch. push_range hands
+ * a batch to the waiters in priority order, the first waiter gets the highest priority item.
+ *
+ * Any thread may push and pop. A consumer continues on whatever thread pushed its item, a coroutine which must run on
+ * its own event loop should reschedule itself after the await. For C event loops see async_prio_queue.h.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "prio_queue.hpp"
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace cstructures {
+
+/**
+ * @brief An awaitable priority queue, the queue must outlive every coroutine suspended in pop.
+ *
+ * @tparam T The item type, it only needs to be move constructible and move assignable.
+ * @tparam Compare A strict weak ordering, compare(a, b) is true when a has the lower priority.
+ * @tparam Arity Children per node of the underlying priority_queue.
+ * @tparam Allocator The allocator for the item storage.
+ */
+template <class T, class Compare = std::less<T>, std::size_t Arity = 4, class Allocator = std::allocator<T>>
+class async_priority_queue {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    /** @brief The awaitable returned by pop, resumes with the removed item. */
+    class pop_awaiter {
+    public:
+        explicit pop_awaiter(async_priority_queue& queue) noexcept : queue_(queue) {}
+
+        // The check needs the lock, it is done once in await_suspend.
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle){
+            std::lock_guard<std::mutex> guard(queue_.lock_);
+            if(!queue_.items_.empty()){
+                value_.emplace(queue_.items_.pop());
+                return false;
+            }
+            handle_ = handle;
+            next_ = nullptr;
+            if(queue_.tail_ != nullptr){
+                queue_.tail_->next_ = this;
+            }else{
+                queue_.head_ = this;
+            }
+            queue_.tail_ = this;
+            queue_.waiting_++;
+            // A pushing thread may resume the coroutine as soon as the lock is released, nothing here is touched after.
+            return true;
+        }
+
+        T await_resume(){ return std::move(*value_); }
+
+    private:
+        friend class async_priority_queue;
+
+        async_priority_queue& queue_;
+        std::optional<T> value_;
+        std::coroutine_handle<> handle_;
+        pop_awaiter* next_ = nullptr;
+    };
+
+    explicit async_priority_queue(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : items_(compare, alloc) {}
+
+    async_priority_queue(const async_priority_queue&) = delete;
+    async_priority_queue& operator=(const async_priority_queue&) = delete;
+
+    /** @brief Removes the item with the highest priority, suspends until one is pushed if the queue is empty. */
+    pop_awaiter pop() noexcept { return pop_awaiter(*this); }
+
+    /** @brief Removes the item with the highest priority if there is one, never suspends. */
+    std::optional<T> try_pop(){
+        std::lock_guard<std::mutex> guard(lock_);
+        if(items_.empty()){
+            return std::nullopt;
+        }
+        return std::optional<T>(items_.pop());
+    }
+
+    void push(const T& value){ emplace(value); }
+    void push(T&& value){ emplace(std::move(value)); }
+
+    /** @brief Constructs an item, resumes the longest waiting consumer with it if there is one. */
+    template <class... Args>
+    void emplace(Args&&... args){
+        // Built outside the lock, a throwing constructor leaves the queue and its waiters untouched.
+        T value(std::forward<Args>(args)...);
+        pop_awaiter* waiter = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            // Consumers only wait while the queue is empty, so the item needs no comparison against the heap.
+            waiter = take_waiter();
+            if(waiter == nullptr){
+                items_.push(std::move(value));
+                return;
+            }
+            waiter->value_.emplace(std::move(value));
+        }
+        waiter->handle_.resume();
+    }
+
+    /** @brief Pushes a batch under one lock, the waiting consumers get its highest priority items in wait order. */
+    template <class InputIt>
+    void push_range(InputIt first, InputIt last){
+        pop_awaiter* resume_head = nullptr;
+        pop_awaiter* resume_tail = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            for(; first != last; ++first){
+                items_.push(*first);
+            }
+            while(head_ != nullptr && !items_.empty()){
+                pop_awaiter* waiter = take_waiter();
+                waiter->value_.emplace(items_.pop());
+                if(resume_tail != nullptr){
+                    resume_tail->next_ = waiter;
+                }else{
+                    resume_head = waiter;
+                }
+                resume_tail = waiter;
+            }
+        }
+        while(resume_head != nullptr){
+            // The awaiter lives in the coroutine frame, which may be gone once resumed.
+            pop_awaiter* next = resume_head->next_;
+            resume_head->handle_.resume();
+            resume_head = next;
+        }
+    }
+
+    size_type size() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return items_.size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /** @brief The number of coroutines suspended in pop. */
+    size_type waiting() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return waiting_;
+    }
+
+private:
+    pop_awaiter* take_waiter() noexcept {
+        pop_awaiter* waiter = head_;
+        if(waiter != nullptr){
+            head_ = waiter->next_;
+            if(head_ == nullptr){
+                tail_ = nullptr;
+            }
+            waiter->next_ = nullptr;
+            waiting_--;
+        }
+        return waiter;
+    }
+
+    mutable std::mutex lock_;
+    priority_queue<T, Compare, Arity, Allocator> items_;
+    pop_awaiter* head_ = nullptr;
+    pop_awaiter* tail_ = nullptr;
+    size_type waiting_ = 0;
+};
+
+} // namespace cstructures
+
+#endif //CSTRUCTURES_ASYNC_PRIO_QUEUE_HPP
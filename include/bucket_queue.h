@@ -0,0 +1,126 @@
+/*
+ * Bucket Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_BUCKET_QUEUE_H
+#define CSTRUCTURES_BUCKET_QUEUE_H
+
+/**
+ * @file bucket_queue.h
+ * @brief A Bucket Queue Implementation for c.
+ *
+ * A priority queue for a small range of integer priorities. Every level has its own FIFO ring and a two level bitmap
+ * tracks the non empty levels, insert and remove are O(1) and no comparator is needed. Level 0 is removed first and
+ * items of equal priority are removed in insertion order.
+ *
+ * The functions mirror the prio_queue api, so either can be selected by configuration.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+
+#define BUCKET_QUEUE_RESIZE_ENABLED CSTRUCTURES_GLOBAL_RESIZE_ENABLE
+
+#define BUCKET_QUEUE_MAX_LEVELS 4096 /** The largest number of priority levels supported. */
+
+/** @brief A handle for the bucket queue. */
+struct bucket_queue_handle;
+
+/**
+ * \brief Initializes a new bucket queue.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param levels The number of priority levels, priorities range from 0 to levels - 1.
+ * @param max_size The maximum size of the the bucket queue.
+ * @param priority A pointer to the callback function which returns the priority level of the data.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err bucket_queue_init(struct bucket_queue_handle** hnd, size_t levels, size_t max_size,
+                          unsigned int (priority)(void* data));
+
+/**
+ * @brief Frees an allocated bucket queue.
+ *
+ * @param hnd The bucket queue handle which is to be freed.
+ */
+void bucket_queue_free(struct bucket_queue_handle* hnd);
+
+/**
+ * @brief Insert new data into the bucket queue.
+ *
+ * @param hnd The bucket queue in which you would like to insert the data.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful, CST_PARAM_ERR if the priority of the data is out of range.
+ */
+cst_err bucket_queue_insert(struct bucket_queue_handle* hnd, void* data);
+
+/**
+ * @brief Remove the next item from the bucket queue.
+ *
+ * @param hnd The queue from which you would like to remove the data.
+ * @param data The data which you would like to remove.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err bucket_queue_remove(struct bucket_queue_handle* hnd, void** data);
+
+/**
+ * @brief Get the next item of the bucket queue without removing it.
+ *
+ * @param hnd The queue to look at.
+ * @param data The next item is placed here.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err bucket_queue_peek(struct bucket_queue_handle* hnd, void** data);
+
+/**
+ * @brief Get the current size of the bucket queue.
+ *
+ * @param hnd The queue to get the size of.
+ *
+ * @return The size of the queue.
+ */
+int bucket_queue_size(struct bucket_queue_handle* hnd);
+
+#if BUCKET_QUEUE_RESIZE_ENABLED
+
+/**
+ * @brief Will attempt to resize the bucket queue maximum.
+ *
+ * @param hnd The queue which needs to be resized.
+ * @param new_size The new size of the queue.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err bucket_queue_resize(struct bucket_queue_handle* hnd, size_t new_size);
+
+#endif
+
+#endif //CSTRUCTURES_BUCKET_QUEUE_H
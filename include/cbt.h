@@ -38,6 +38,13 @@
 #include "cstructures_config.h"
 
 #define CBT_RESIZE_ENABLED CSTRUCTURES_GLOBAL_RESIZE_ENABLE
+#define CBT_INLINE_ENABLED CSTRUCTURES_GLOBAL_CBT_INLINE
+
+#if CBT_INLINE_ENABLED
+#define CBT_ACCESSOR static inline  /** Accessors are defined in cbt_inline.h and inlined into every caller. */
+#else
+#define CBT_ACCESSOR
+#endif
 
 /** @brief A handle for the complete binary tree. */
 struct cbt_handle;
@@ -45,6 +52,13 @@ struct cbt_handle;
 /** @brief A complete binary tree node. */
 struct cbt_node;
 
+/** @brief Allocates the node array of a tree, e.g. on a given NUMA node. Both functions get the size in bytes. */
+struct cbt_allocator{
+    void* (*alloc)(size_t size, void* ctx);
+    void (*free)(void* ptr, size_t size, void* ctx);
+    void* ctx;  /** Passed to both functions. */
+};
+
 /**
  * @brief Initializes a new complete binary tree handle to a given size.
  *  
@@ -55,6 +69,19 @@ struct cbt_node;
  */
 cst_err cbt_init(struct cbt_handle **hnd, size_t max_size);
 
+/**
+ * @brief Initializes a new complete binary tree handle whose nodes come from an allocator.
+ *
+ * The handle itself is allocated as usual, the allocator is used for the node array, also when the tree is resized.
+ *
+ * @param hnd A pointer to a newly allocated tree handle will be placed here if successful.
+ * @param max_size The maximum number of items you want your tree to hold.
+ * @param allocator Copied into the handle, NULL uses malloc.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err cbt_init_allocator(struct cbt_handle **hnd, size_t max_size, const struct cbt_allocator* allocator);
+
 /**
  * @brief Frees a complete binary tree given the handle.
  * 
@@ -84,6 +111,15 @@ struct cbt_node* cbt_insert(struct cbt_handle *hnd, void* data);
  */
 cst_err cbt_remove(struct cbt_handle *hnd, void** data);
 
+/**
+ * @brief Removes every node from the tree, the data is not touched.
+ *
+ * @param hnd The cbt handle.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err cbt_clear(struct cbt_handle *hnd);
+
 /**
  * @brief Get the number of items currently in the tree.
  * 
@@ -91,7 +127,7 @@ cst_err cbt_remove(struct cbt_handle *hnd, void** data);
  * 
  * @return The number of items in the tree.
  */
-int cbt_size(struct cbt_handle *hnd);
+CBT_ACCESSOR int cbt_size(struct cbt_handle *hnd);
 
 /**
  * @brief Swaps two nodes in the tree.
@@ -101,7 +137,7 @@ int cbt_size(struct cbt_handle *hnd);
  * 
  * @return CST_OK if successful.
  */
-cst_err cbt_swap(struct cbt_node* n1, struct cbt_node* n2);
+CBT_ACCESSOR cst_err cbt_swap(struct cbt_node* n1, struct cbt_node* n2);
 
 /** 
  * @brief Gets the root node of the complete binary tree.
@@ -110,7 +146,17 @@ cst_err cbt_swap(struct cbt_node* n1, struct cbt_node* n2);
  * 
  * @return The root node of the tree, NULL if an error occurred.
  */
-struct cbt_node* cbt_get_root(struct cbt_handle *hnd);
+CBT_ACCESSOR struct cbt_node* cbt_get_root(struct cbt_handle *hnd);
+
+/**
+ * @brief Gets the node at a given position of the tree, in level order.
+ *
+ * @param hnd The cbt handle.
+ * @param index The position of the node, 0 is the root.
+ *
+ * @return The node, NULL if the index is out of range.
+ */
+CBT_ACCESSOR struct cbt_node* cbt_get_node(struct cbt_handle *hnd, int index);
 
 /**
  * @brief Gets the left child of a given node.
@@ -120,7 +166,7 @@ struct cbt_node* cbt_get_root(struct cbt_handle *hnd);
  * 
  * @return The left child node, NULL if an error occurred.
  */
-struct cbt_node* cbt_get_child_left(struct cbt_handle *hnd, struct cbt_node* node);
+CBT_ACCESSOR struct cbt_node* cbt_get_child_left(struct cbt_handle *hnd, struct cbt_node* node);
 
 /** 
  * @brief Gets the right child of a given node.
@@ -130,7 +176,7 @@ struct cbt_node* cbt_get_child_left(struct cbt_handle *hnd, struct cbt_node* nod
  * 
  * @return The right child node, NULL if an error occurred.
  */
-struct cbt_node* cbt_get_child_right(struct cbt_handle *hnd, struct cbt_node* node);
+CBT_ACCESSOR struct cbt_node* cbt_get_child_right(struct cbt_handle *hnd, struct cbt_node* node);
 
 /**
  * @brief Gets the parent node of a given child.
@@ -140,7 +186,7 @@ struct cbt_node* cbt_get_child_right(struct cbt_handle *hnd, struct cbt_node* no
  * 
  * @return The parent node, NULL if an error occurred.
  */
-struct cbt_node* cbt_get_parent(struct cbt_handle *hnd, struct cbt_node* node);
+CBT_ACCESSOR struct cbt_node* cbt_get_parent(struct cbt_handle *hnd, struct cbt_node* node);
 
 /** 
  * @brief Gets the data from a given node.
@@ -149,7 +195,7 @@ struct cbt_node* cbt_get_parent(struct cbt_handle *hnd, struct cbt_node* node);
  * 
  * @return A pointer to the data.
  */
-void* cbt_get_data(struct cbt_node* node);
+CBT_ACCESSOR void* cbt_get_data(struct cbt_node* node);
 
 /** 
  * @brief Sets new data for a given cbt node.
@@ -159,7 +205,7 @@ void* cbt_get_data(struct cbt_node* node);
  * 
  * @return CST_OK if the data was properly set.
  */
-cst_err cbt_set_data(struct cbt_node* node, void* data);
+CBT_ACCESSOR cst_err cbt_set_data(struct cbt_node* node, void* data);
 
 #if CBT_RESIZE_ENABLED
 
@@ -175,4 +221,8 @@ cst_err cbt_resize(struct cbt_handle *hnd, size_t new_size);
 
 #endif //CBT_RESIZE_ENABLED
 
+#if CBT_INLINE_ENABLED
+#include "cbt_inline.h"
+#endif
+
 #endif //CSTRUCTURES_CBT_H
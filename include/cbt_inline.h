@@ -0,0 +1,181 @@
+/*
+ * Complete Binary Tree Layout and Accessors
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_CBT_INLINE_H
+#define CSTRUCTURES_CBT_INLINE_H
+
+/**
+ * @file cbt_inline.h
+ * @brief The node layout and the accessors of the complete binary tree.
+ *
+ * Compiled into cbt.c by default. With CSTRUCTURES_GLOBAL_CBT_INLINE cbt.h includes it instead, the accessors become
+ * static inline and a sift step in the priority queue no longer pays a function call per node visited. Include cbt.h
+ * rather than this file.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cbt.h"
+
+// Debug output is only available when compiled into cbt.c.
+#ifdef cbt_printfln
+#define cbt_accessor_printfln(x, ...) cbt_printfln(x, ##__VA_ARGS__)
+#else
+#define cbt_accessor_printfln(x, ...)
+#endif
+
+struct cbt_node{
+    void* data;
+    int index;
+};
+
+struct cbt_handle{
+    struct cbt_node* tree_data;
+    size_t max_data;
+    int end;
+    struct cbt_allocator allocator;
+};
+
+CBT_ACCESSOR int cbt_size(struct cbt_handle *hnd){
+    // Safety check
+    if(!hnd){
+        cbt_accessor_printfln("Null Handle");
+        return CST_FAIL;
+    }
+
+    return hnd->end;
+}
+
+CBT_ACCESSOR cst_err cbt_swap(struct cbt_node* n1, struct cbt_node* n2){
+    void* tmp = n1->data;
+    n1->data = n2->data;
+    n2->data = tmp;
+    return CST_OK;
+}
+
+CBT_ACCESSOR struct cbt_node* cbt_get_root(struct cbt_handle *hnd){
+    // Safety check
+    if(!hnd){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    if(cbt_size(hnd) == 0){
+        cbt_accessor_printfln("Empty");
+        return NULL;
+    }
+
+    return &hnd->tree_data[0];
+}
+
+CBT_ACCESSOR struct cbt_node* cbt_get_node(struct cbt_handle *hnd, int index){
+    // Safety check
+    if(!hnd){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    if(index < 0 || index >= hnd->end){
+        cbt_accessor_printfln("Out of range");
+        return NULL;
+    }
+
+    return &hnd->tree_data[index];
+}
+
+CBT_ACCESSOR struct cbt_node* cbt_get_child_left(struct cbt_handle *hnd, struct cbt_node* node){
+    // Safety check
+    if(!hnd || !node){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    // Calculate the location of the child in the array
+    int index = (2 * node->index) + 1;
+    if(index >= hnd->end){
+        cbt_accessor_printfln("Too Small");
+        return NULL;
+    }
+
+    return &hnd->tree_data[index];
+}
+
+CBT_ACCESSOR struct cbt_node* cbt_get_child_right(struct cbt_handle *hnd, struct cbt_node* node){
+    // Safety check
+    if(!hnd || !node){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    // Calculate the location of the child in the array
+    int index = (2 * node->index) + 2;
+    if(index >= hnd->end){
+        cbt_accessor_printfln("Too Small");
+        return NULL;
+    }
+
+    return &hnd->tree_data[index];
+}
+
+CBT_ACCESSOR struct cbt_node* cbt_get_parent(struct cbt_handle *hnd, struct cbt_node* node){
+    // Safety check
+    if(!hnd || !node){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    // Check if node is root
+    if(node->index == 0){
+        cbt_accessor_printfln("Is Root");
+        return NULL;
+    }
+
+    // Calculate the location of the parent in the array
+    int index = (node->index - 1) / 2;
+
+    return &hnd->tree_data[index];
+}
+
+CBT_ACCESSOR void* cbt_get_data(struct cbt_node* node){
+    // Safety check
+    if(!node){
+        cbt_accessor_printfln("Null Handle");
+        return NULL;
+    }
+
+    return node->data;
+}
+
+CBT_ACCESSOR cst_err cbt_set_data(struct cbt_node* node, void* data){
+    // Safety check
+    if(!node){
+        cbt_accessor_printfln("Null Handle");
+        return CST_PARAM_ERR;
+    }
+    node->data = data;
+    return CST_OK;
+}
+
+#endif //CSTRUCTURES_CBT_INLINE_H
@@ -28,4 +28,24 @@
 
 #define CSTRUCTURES_GLOBAL_RESIZE_ENABLE 1  /** Enable auto reszing of the priority queue. */
 
+#ifndef CSTRUCTURES_GLOBAL_STATS_ENABLE
+#define CSTRUCTURES_GLOBAL_STATS_ENABLE 0   /** Enable per handle operation counters, off costs nothing. */
+#endif
+
+#ifndef CSTRUCTURES_GLOBAL_TRACE_ENABLE
+#define CSTRUCTURES_GLOBAL_TRACE_ENABLE 0   /** Enable sampled latency histograms and trace callbacks. */
+#endif
+
+#ifndef CSTRUCTURES_GLOBAL_PARALLEL_ENABLE
+#define CSTRUCTURES_GLOBAL_PARALLEL_ENABLE 1 /** Enable the multi threaded functions, needs pthreads. */
+#endif
+
+#ifndef CSTRUCTURES_GLOBAL_NUMA_ENABLE
+#define CSTRUCTURES_GLOBAL_NUMA_ENABLE 0    /** Place queue shards on NUMA nodes, needs libnuma. */
+#endif
+
+#ifndef CSTRUCTURES_GLOBAL_CBT_INLINE
+#define CSTRUCTURES_GLOBAL_CBT_INLINE 0     /** Define the cbt accessors static inline in cbt.h instead of cbt.c. */
+#endif
+
 #endif //CSTRUCTURES_CSTRUCTURES_CONFIG_H
@@ -34,12 +34,13 @@
  */
 
 typedef enum {
+    CST_OK = 0,
     CST_EMPTY,
     CST_PARAM_ERR,
     CST_OVERFLOW,
     CST_MEM_ERR,
     CST_FAIL,
-    CST_OK = 0
+    CST_IO_ERR
 }cst_err;
 
 #endif //CSTRUCTURES_CSTRUCTURES_ERR_H
@@ -0,0 +1,137 @@
+/*
+ * External Memory Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_EXT_PRIO_QUEUE_H
+#define CSTRUCTURES_EXT_PRIO_QUEUE_H
+
+/**
+ * @file ext_prio_queue.h
+ * @brief An External Memory Priority Queue Implementation for c.
+ *
+ * Items are buffered in an in memory prio_queue. Once the buffer holds its configured number of items it is flushed
+ * to a temporary file as a sorted run, removes merge the buffer with the heads of all runs through a small heap. Runs
+ * are written and read sequentially through large buffers. The budget counts items, not bytes: memory use is about
+ * buffer_items items plus one item and EXT_PRIO_QUEUE_IO_BUFFER bytes per run.
+ *
+ * Once there are EXT_PRIO_QUEUE_MAX_RUNS runs the EXT_PRIO_QUEUE_MERGE_RUNS smallest are merged into one, so runs grow
+ * in tiers and every item is rewritten O(log(n / buffer_items)) times.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+
+#define EXT_PRIO_QUEUE_IO_BUFFER (1 << 20) /** Size of the stdio buffer used for each run file. */
+#define EXT_PRIO_QUEUE_MAX_RUNS 64         /** The smallest runs are merged once there are this many. */
+#define EXT_PRIO_QUEUE_MERGE_RUNS 16       /** The number of runs merged at a time. */
+
+/** @brief A handle for the external memory priority queue. */
+struct ext_prio_queue_handle;
+
+/** @brief Callbacks used to move items to and from disk. */
+struct ext_prio_queue_serializer{
+    /**
+     * @brief Writes the data into buf.
+     *
+     * @return The number of bytes needed, if larger than cap nothing is written and it is called again.
+     */
+    size_t (*serialize)(void* data, void* buf, size_t cap);
+
+    /** @brief Recreates an item from the bytes written by serialize. */
+    void* (*deserialize)(const void* buf, size_t len);
+
+    /** @brief Called on items once they have been written to disk, may be NULL. */
+    void (*release)(void* data);
+};
+
+/**
+ * \brief Initializes a new external memory priority queue.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param dir The directory for temporary run files, NULL for the system default.
+ * @param buffer_items The number of items, not bytes, kept in memory before a run is written to disk.
+ * @param comparator A pointer to the callback function which will compare the data.
+ * @param serializer The callbacks used to write items to disk and read them back.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err ext_prio_queue_init(struct ext_prio_queue_handle** hnd, const char* dir, size_t buffer_items,
+                            int (comparator)(void* c1, void* c2),
+                            const struct ext_prio_queue_serializer* serializer);
+
+/**
+ * @brief Frees an external memory priority queue and removes its run files.
+ *
+ * Items still on disk are dropped, items in memory are not released.
+ *
+ * @param hnd The queue handle which is to be freed.
+ */
+void ext_prio_queue_free(struct ext_prio_queue_handle* hnd);
+
+/**
+ * @brief Insert new data into the queue, may write a run to disk.
+ *
+ * @param hnd The queue in which you would like to insert the data.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful, CST_IO_ERR if a run could not be written or read back. The queue is unchanged on
+ *         failure and the data is not inserted.
+ */
+cst_err ext_prio_queue_insert(struct ext_prio_queue_handle* hnd, void* data);
+
+/**
+ * @brief Remove the next item from the queue.
+ *
+ * Items which were on disk are recreated with the deserialize callback.
+ *
+ * @param hnd The queue from which you would like to remove the data.
+ * @param data The data which you would like to remove.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty, CST_IO_ERR or CST_MEM_ERR if the next item of a run
+ *         could not be read. Nothing is removed on failure and the remove may be retried.
+ */
+cst_err ext_prio_queue_remove(struct ext_prio_queue_handle* hnd, void** data);
+
+/**
+ * @brief Get the total number of items in the queue, in memory and on disk.
+ *
+ * @param hnd The queue to get the size of.
+ *
+ * @return The size of the queue.
+ */
+size_t ext_prio_queue_size(struct ext_prio_queue_handle* hnd);
+
+/**
+ * @brief Get the number of sorted runs currently on disk.
+ *
+ * @param hnd The queue to get the number of runs of.
+ *
+ * @return The number of runs.
+ */
+size_t ext_prio_queue_runs(struct ext_prio_queue_handle* hnd);
+
+#endif //CSTRUCTURES_EXT_PRIO_QUEUE_H
@@ -0,0 +1,106 @@
+/*
+ * K-Way Merge Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_KWAY_MERGE_H
+#define CSTRUCTURES_KWAY_MERGE_H
+
+/**
+ * @file kway_merge.h
+ * @brief A K-Way Merge Implementation for c.
+ *
+ * Merges many sorted sources into one sorted output with a loser tree. Every internal node of the tree holds the
+ * source which lost the match played there, so replacing the winner replays a single leaf to root path, about log2 k
+ * comparisons per item against roughly twice that for a remove and insert on a binary heap. Sources are pulled
+ * through a callback in batches and output is produced in blocks.
+ *
+ * Items which compare equal are output in source order, lower source indexes first.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+
+#define KWAY_MERGE_BATCH 256 /** Items pulled from a source at a time. */
+
+/** @brief A handle for the k-way merge. */
+struct kway_merge_handle;
+
+/**
+ * @brief Initializes a new merge over sorted sources.
+ *
+ * The first batch of every source is pulled here.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param sources The number of sources.
+ * @param contexts One pointer per source, handed to pull.
+ * @param pull Fills items with up to cap of the next items of the source in order and returns how many, 0 once the
+ *             source is exhausted.
+ * @param comparator A pointer to the callback function which will compare the data.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err kway_merge_init(struct kway_merge_handle** hnd, size_t sources, void** contexts,
+                        size_t (pull)(void* ctx, void** items, size_t cap), int (comparator)(void* c1, void* c2));
+
+/**
+ * @brief Frees a merge, items not yet output are dropped.
+ *
+ * @param hnd The merge handle which is to be freed.
+ */
+void kway_merge_free(struct kway_merge_handle* hnd);
+
+/**
+ * @brief Outputs the next block of merged items.
+ *
+ * @param hnd The merge.
+ * @param out Receives up to cap items in order.
+ * @param cap The size of out.
+ *
+ * @return The number of items placed in out, less than cap only once every source is exhausted.
+ */
+size_t kway_merge_next(struct kway_merge_handle* hnd, void** out, size_t cap);
+
+/**
+ * @brief Removes the next merged item.
+ *
+ * @param hnd The merge.
+ * @param data The next item is placed here.
+ *
+ * @return CST_OK if successful, CST_EMPTY once every source is exhausted.
+ */
+cst_err kway_merge_remove(struct kway_merge_handle* hnd, void** data);
+
+/**
+ * @brief Get the number of sources which still have items.
+ *
+ * @param hnd The merge.
+ *
+ * @return The number of sources not yet exhausted.
+ */
+size_t kway_merge_active(struct kway_merge_handle* hnd);
+
+#endif //CSTRUCTURES_KWAY_MERGE_H
@@ -0,0 +1,149 @@
+/*
+ * Persistent Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_MMAP_PRIO_QUEUE_H
+#define CSTRUCTURES_MMAP_PRIO_QUEUE_H
+
+/**
+ * @file mmap_prio_queue.h
+ * @brief A Memory Mapped Persistent Priority Queue Implementation for c.
+ *
+ * The heap array lives in a memory mapped file behind a small header, every record holds an inline 64 bit key and a
+ * fixed size payload. Reopening the file after a restart only maps it, there is nothing to rebuild. Changes reach
+ * the disk through msync at checkpoints, either explicitly or every configured number of operations. The first change
+ * after a checkpoint synchronously marks the header dirty on disk, so a file which may hold changes made after its last
+ * checkpoint is checked for heap order on open and rebuilt if needed. After a system crash the queue therefore opens as
+ * a valid heap, but it only holds exactly the checkpointed items if nothing changed since: records moved after the
+ * checkpoint may be lost or duplicated. A process crash in the middle of an insert or remove may lose the record being
+ * moved.
+ *
+ * The lowest key is removed first.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define MMAP_PRIO_QUEUE_RESIZE_ENABLED CSTRUCTURES_GLOBAL_RESIZE_ENABLE
+
+/** @brief A handle for the memory mapped priority queue. */
+struct mmap_prio_queue_handle;
+
+/**
+ * @brief Opens a memory mapped priority queue, creating the file if it does not exist.
+ *
+ * An existing file is checked before use: the header has to match and the count has to fit the file. If the queue
+ * was not closed cleanly the records are also checked for heap order and the heap is rebuilt if needed.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param path The file which holds the queue.
+ * @param payload_size The size in bytes of the payload of each record, has to match for an existing file.
+ * @param max_size The maximum number of records when creating the file, ignored for an existing file.
+ * @param checkpoint_ops A checkpoint is taken after this many inserts and removes, 0 for explicit checkpoints only.
+ *
+ * @return CST_OK if successful, CST_IO_ERR if the file could not be opened and CST_FAIL if it is not consistent.
+ */
+cst_err mmap_prio_queue_open(struct mmap_prio_queue_handle** hnd, const char* path, size_t payload_size,
+                             size_t max_size, size_t checkpoint_ops);
+
+/**
+ * @brief Takes a final checkpoint, unmaps the file and frees the handle.
+ *
+ * @param hnd The queue handle which is to be closed.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err mmap_prio_queue_close(struct mmap_prio_queue_handle* hnd);
+
+/**
+ * @brief Insert a new record into the queue.
+ *
+ * @param hnd The queue in which you would like to insert the record.
+ * @param key The key of the record.
+ * @param payload payload_size bytes which are copied into the record.
+ *
+ * @return CST_OK if successful, CST_OVERFLOW if the file is full, CST_IO_ERR if the header could not be marked dirty.
+ */
+cst_err mmap_prio_queue_insert(struct mmap_prio_queue_handle* hnd, uint64_t key, const void* payload);
+
+/**
+ * @brief Remove the record with the lowest key from the queue.
+ *
+ * @param hnd The queue from which you would like to remove the record.
+ * @param key The key of the record is placed here.
+ * @param payload The payload of the record is copied here, may be NULL.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty, CST_IO_ERR if the header could not be marked dirty.
+ */
+cst_err mmap_prio_queue_remove(struct mmap_prio_queue_handle* hnd, uint64_t* key, void* payload);
+
+/**
+ * @brief Get the record with the lowest key without removing it.
+ *
+ * @param hnd The queue to look at.
+ * @param key The key of the record is placed here.
+ * @param payload The payload of the record is copied here, may be NULL.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err mmap_prio_queue_peek(struct mmap_prio_queue_handle* hnd, uint64_t* key, void* payload);
+
+/**
+ * @brief Get the current number of records in the queue.
+ *
+ * @param hnd The queue to get the size of.
+ *
+ * @return The size of the queue.
+ */
+size_t mmap_prio_queue_size(struct mmap_prio_queue_handle* hnd);
+
+/**
+ * @brief Writes every change to disk with msync and marks the file as consistent.
+ *
+ * @param hnd The queue to checkpoint.
+ *
+ * @return CST_OK if successful, CST_IO_ERR if msync failed.
+ */
+cst_err mmap_prio_queue_checkpoint(struct mmap_prio_queue_handle* hnd);
+
+#if MMAP_PRIO_QUEUE_RESIZE_ENABLED
+
+/**
+ * @brief Will attempt to grow or shrink the file to hold a new maximum number of records.
+ *
+ * @param hnd The queue which needs to be resized.
+ * @param new_size The new maximum number of records.
+ *
+ * @return CST_OK if successful, CST_FAIL if more records are queued than new_size, CST_IO_ERR if the file could not be
+ *         resized or mapped, the queue keeps its old size and stays usable then.
+ */
+cst_err mmap_prio_queue_resize(struct mmap_prio_queue_handle* hnd, size_t new_size);
+
+#endif
+
+#endif //CSTRUCTURES_MMAP_PRIO_QUEUE_H
@@ -36,8 +36,32 @@
 #include "cstructures_err.h"
 #include "cstructures_config.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 #define PRIO_QUEUE_RESIZE_ENABLED CSTRUCTURES_GLOBAL_RESIZE_ENABLE
+#define PRIO_QUEUE_STATS_ENABLED CSTRUCTURES_GLOBAL_STATS_ENABLE
+#define PRIO_QUEUE_TRACE_ENABLED CSTRUCTURES_GLOBAL_TRACE_ENABLE
+#define PRIO_QUEUE_PARALLEL_ENABLED CSTRUCTURES_GLOBAL_PARALLEL_ENABLE
+
+#if !defined(__STDC_NO_ATOMICS__)
+#define PRIO_QUEUE_INGRESS_ENABLED 1    /** The ingress ring needs C11 atomics. */
+#else
+#define PRIO_QUEUE_INGRESS_ENABLED 0
+#endif
+
+#define PRIO_QUEUE_ERASE_FRACTION 0.25   /** Default share of erased entries which triggers a compaction. */
+
+#define PRIO_QUEUE_STATS_DEPTH_BUCKETS 32 /** Sift depths of this many levels or more share the last bucket. */
+
+#define PRIO_QUEUE_LATENCY_SUB_BITS 3     /** Latency buckets per power of two are 2^this, 12.5% precision. */
+#define PRIO_QUEUE_LATENCY_MAX_BITS 40    /** Latencies of 2^this ns and more share the last bucket. */
+#define PRIO_QUEUE_LATENCY_BUCKETS \
+    ((PRIO_QUEUE_LATENCY_MAX_BITS - PRIO_QUEUE_LATENCY_SUB_BITS + 1) << PRIO_QUEUE_LATENCY_SUB_BITS)
 
 /** @brief A handle for the priority queue. */
 struct prio_queue_handle;
@@ -53,6 +77,21 @@ struct prio_queue_handle;
  */
 cst_err prio_queue_init(struct prio_queue_handle** hnd, size_t max_size,  int (comparator)(void* c1, void* c2));
 
+struct cbt_allocator;
+
+/**
+ * @brief Initializes a new priority queue whose heap array comes from an allocator, see cbt_init_allocator.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param max_size The maximum size of the the priority queue.
+ * @param comparator A pointer to the callback function which will compare the data.
+ * @param allocator Allocates the heap array, also when the queue is resized. NULL uses malloc.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_init_allocator(struct prio_queue_handle** hnd, size_t max_size, int (comparator)(void* c1, void* c2),
+                                  const struct cbt_allocator* allocator);
+
 /** 
  * @brief Frees an allocated priority queue.
  * 
@@ -80,15 +119,172 @@ cst_err prio_queue_insert(struct prio_queue_handle* hnd, void* data);
  */
 cst_err prio_queue_remove(struct prio_queue_handle* hnd, void** data);
 
+/**
+ * @brief Get the next item of the priority queue without removing it.
+ *
+ * @param hnd The queue to look at.
+ * @param data The next item is placed here.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue is empty.
+ */
+cst_err prio_queue_peek(struct prio_queue_handle* hnd, void** data);
+
 /**
  * @brief Get the current size of the priority queue.
  * 
  * @param hnd The queue to get the size of.
  * 
- * @return The size of the queue.
+ * @return The size of the queue, erased items are not counted.
  */
 int prio_queue_size(struct prio_queue_handle* hnd);
 
+/**
+ * @brief Writes the queue to a stream in a versioned, checksummed binary format.
+ *
+ * The heap array is written in order in large blocks, each item as a length and the bytes from serialize. The queue
+ * is not changed, except that pending erased items are compacted away first.
+ *
+ * @param hnd The queue to write.
+ * @param file The stream to write to.
+ * @param serialize Writes an item into buf and returns the number of bytes needed, if larger than cap nothing is
+ *                  written and it is called again.
+ *
+ * @return CST_OK if successful, CST_IO_ERR if the stream could not be written.
+ */
+cst_err prio_queue_snapshot(struct prio_queue_handle* hnd, FILE* file,
+                            size_t (serialize)(void* data, void* buf, size_t cap));
+
+/**
+ * @brief Creates a new priority queue from a snapshot.
+ *
+ * The snapshot is already in heap order so items are placed as read, the comparator has to order items the same way
+ * as the one of the queue the snapshot was taken from. The stream is read in large blocks, on seekable streams the
+ * position is left right after the snapshot.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param file The stream to read from.
+ * @param comparator A pointer to the callback function which will compare the data.
+ * @param deserialize Recreates an item from the bytes written by serialize.
+ * @param release Frees items already restored if the snapshot turns out to be bad, may be NULL.
+ *
+ * @return CST_OK if successful, CST_FAIL if the snapshot is not valid and CST_IO_ERR if the stream could not be read.
+ */
+cst_err prio_queue_restore(struct prio_queue_handle** hnd, FILE* file, int (comparator)(void* c1, void* c2),
+                           void* (deserialize)(const void* buf, size_t len), void (release)(void* data));
+
+/**
+ * @brief Sets how prio_queue_erase_lazy identifies items and when the queue compacts.
+ *
+ * The key function can only be changed while no erased items are pending.
+ *
+ * @param hnd The queue to configure.
+ * @param key Returns the identity of an item, items with equal keys are interchangeable. NULL uses the data pointer.
+ * @param fraction Compact once erased entries exceed this share of the heap, above 0 and at most 1. The default is
+ *                 PRIO_QUEUE_ERASE_FRACTION.
+ *
+ * @return CST_OK if successful, CST_PARAM_ERR if fraction is out of range, CST_FAIL if erased items are pending.
+ */
+cst_err prio_queue_set_erase(struct prio_queue_handle* hnd, uint64_t (key)(void* data), double fraction);
+
+/**
+ * @brief Erases a queued item in O(1) by leaving a tombstone for its key.
+ *
+ * Erased items stay in the heap, remove and peek skip them and prio_queue_size does not count them. Once they exceed
+ * the configured fraction of the heap it is compacted and rebuilt in O(n), which keeps memory bounded under heavy
+ * cancellation. The first erase counts the queued items by key in O(n), from then on every insert and remove also
+ * updates that count, so an item which is not queued, or is already erased, is refused instead of leaving a tombstone
+ * for the next item inserted with its key.
+ *
+ * Inserting an item whose key has erased items still in the heap, the usual way to reschedule, compacts the heap first
+ * so the new item cannot be taken for an erased one. The comparator keeps reading erased items until remove or peek
+ * skip them at the top, a compaction drops them or the queue is freed, so their data has to stay valid and unchanged
+ * until then.
+ *
+ * @param hnd The queue holding the item.
+ * @param data The item, or any data with the same key.
+ *
+ * @return CST_OK if successful, CST_EMPTY if the queue holds no live items, CST_PARAM_ERR if no live item with the key
+ *         is queued, CST_MEM_ERR if the tombstone or the key count could not be stored.
+ */
+cst_err prio_queue_erase_lazy(struct prio_queue_handle* hnd, void* data);
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+
+/**
+ * @brief Attaches a bounded lock free ring through which other threads hand items to the queue.
+ *
+ * Producers call prio_queue_push_ingress from any thread, a push is one compare and swap when the ring is not full.
+ * Everything else stays with the thread owning the queue: remove, peek and erase first move what the ring holds into
+ * the heap in one batch, a batch at least the size of the heap is appended and heapified instead of inserted.
+ * prio_queue_size only counts items already moved.
+ *
+ * @param hnd The queue, no thread may push while attaching.
+ * @param capacity The number of items the ring holds, rounded up to a power of two.
+ *
+ * @return CST_OK if successful, CST_FAIL if a ring is already attached.
+ */
+cst_err prio_queue_attach_ingress(struct prio_queue_handle* hnd, size_t capacity);
+
+/**
+ * @brief Hands an item to the queue through its ingress ring, safe from any thread.
+ *
+ * @param hnd The queue with an attached ring.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful, CST_OVERFLOW if the ring is full, CST_FAIL if no ring is attached.
+ */
+cst_err prio_queue_push_ingress(struct prio_queue_handle* hnd, void* data);
+
+/**
+ * @brief Moves the items waiting in the ingress ring into the heap, only from the thread owning the queue.
+ *
+ * Items stay in the ring while the heap is full.
+ *
+ * @param hnd The queue.
+ *
+ * @return The number of items moved.
+ */
+size_t prio_queue_drain_ingress(struct prio_queue_handle* hnd);
+
+#endif
+
+#if PRIO_QUEUE_PARALLEL_ENABLED
+
+/**
+ * @brief Creates a new priority queue from an array of items, heapifying it on several threads.
+ *
+ * The items are heapified in place: the subtrees below a level with a few times more nodes than threads are built
+ * bottom up in parallel, then the levels above them. This is O(n) against O(n log n) for n inserts.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param items The items, the array is reordered into heap order.
+ * @param count The number of items.
+ * @param max_size The maximum size of the queue, at least count.
+ * @param comparator A pointer to the callback function which will compare the data, it is called from several
+ *                   threads at once.
+ * @param threads The number of threads to use, 0 for one per online processor.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_build_parallel(struct prio_queue_handle** hnd, void** items, size_t count, size_t max_size,
+                                  int (comparator)(void* c1, void* c2), unsigned int threads);
+
+/**
+ * @brief Removes every item from the queue in the order prio_queue_remove would, sorting on several threads.
+ *
+ * Every thread sorts a slice of the heap array, then the sorted slices are merged pairwise with each merge split
+ * between threads. Needs a temporary array of the queue size.
+ *
+ * @param hnd The queue to drain, it is empty afterwards.
+ * @param out Receives prio_queue_size items in removal order.
+ * @param threads The number of threads to use, 0 for one per online processor.
+ *
+ * @return CST_OK if successful, the queue is unchanged on failure.
+ */
+cst_err prio_queue_drain_sorted_parallel(struct prio_queue_handle* hnd, void** out, unsigned int threads);
+
+#endif
+
 #if PRIO_QUEUE_RESIZE_ENABLED
 
 /**
@@ -103,4 +299,115 @@ cst_err prio_queue_resize(struct prio_queue_handle* hnd, size_t new_size);
 
 #endif
 
+#if PRIO_QUEUE_STATS_ENABLED
+
+/** @brief Operation counters of a priority queue. */
+struct prio_queue_stats{
+    uint64_t inserts;          /** Successful inserts. */
+    uint64_t removes;          /** Successful removes. */
+    uint64_t comparisons;      /** Calls to the comparator. */
+    uint64_t swaps;            /** Nodes swapped while sifting. */
+    uint64_t resizes;          /** Successful resizes. */
+    uint64_t overflows;        /** Inserts rejected because the queue was full. */
+    uint64_t erases;           /** Items erased with prio_queue_erase_lazy. */
+    uint64_t compactions;      /** Heap rebuilds dropping erased items. */
+    uint64_t size_high_water;  /** The largest size the queue has reached. */
+    uint64_t sift_depth[PRIO_QUEUE_STATS_DEPTH_BUCKETS]; /** Number of sifts by levels moved. */
+};
+
+/**
+ * @brief Get the operation counters of a priority queue.
+ *
+ * @param hnd The queue to get the counters of.
+ * @param stats The counters are copied here.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_get_stats(struct prio_queue_handle* hnd, struct prio_queue_stats* stats);
+
+/**
+ * @brief Resets all operation counters of a priority queue, the high water mark starts from the current size.
+ *
+ * @param hnd The queue to reset the counters of.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_reset_stats(struct prio_queue_handle* hnd);
+
+#endif
+
+#if PRIO_QUEUE_TRACE_ENABLED
+
+/** @brief Events reported to trace callbacks. */
+enum prio_queue_event{
+    PRIO_QUEUE_EVENT_INSERT,
+    PRIO_QUEUE_EVENT_REMOVE,
+    PRIO_QUEUE_EVENT_RESIZE,
+    PRIO_QUEUE_EVENT_OVERFLOW,
+    PRIO_QUEUE_EVENT_COUNT
+};
+
+/** @brief A log linear histogram of operation latencies in nanoseconds. */
+struct prio_queue_latency{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[PRIO_QUEUE_LATENCY_BUCKETS];
+};
+
+/**
+ * @brief Sets the trace callback and the sampling rate of a priority queue.
+ *
+ * Every sample_rate-th insert and remove is timed with clock_gettime, recorded in the latency histogram of its event
+ * and reported to the callback. Resizes and overflows are rare and are always reported.
+ *
+ * @param hnd The queue to trace.
+ * @param callback Called with the event, the data involved, the latency in nanoseconds (0 if not timed) and ctx.
+ *                 May be NULL to only record histograms.
+ * @param ctx A pointer which is handed to the callback.
+ * @param sample_rate Time one in this many operations, 0 turns tracing off.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_set_trace(struct prio_queue_handle* hnd,
+                             void (callback)(enum prio_queue_event event, void* data, uint64_t latency_ns, void* ctx),
+                             void* ctx, uint32_t sample_rate);
+
+/**
+ * @brief Get the latency histogram of an event of a priority queue.
+ *
+ * @param hnd The queue to get the histogram of.
+ * @param event The event, only inserts, removes and resizes are timed.
+ * @param latency The histogram is copied here.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_get_latency(struct prio_queue_handle* hnd, enum prio_queue_event event,
+                               struct prio_queue_latency* latency);
+
+/**
+ * @brief Resets the latency histograms of a priority queue.
+ *
+ * @param hnd The queue to reset the histograms of.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err prio_queue_reset_latency(struct prio_queue_handle* hnd);
+
+/**
+ * @brief Get a percentile from a latency histogram.
+ *
+ * @param latency The histogram.
+ * @param percentile The percentile, for example 99.9.
+ *
+ * @return The highest latency of the bucket holding the percentile, in nanoseconds.
+ */
+uint64_t prio_queue_latency_percentile(const struct prio_queue_latency* latency, double percentile);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif //CSTRUCTURES_HEAP_H
@@ -0,0 +1,269 @@
+/*
+ * Priority Queue Template for C++
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_PRIO_QUEUE_HPP
+#define CSTRUCTURES_PRIO_QUEUE_HPP
+
+/**
+ * @file prio_queue.hpp
+ * @brief A header only Priority Queue Template for c++.
+ *
+ * Stores items by value in a d-ary heap, the comparator is a template parameter so every comparison can be inlined.
+ * Like std::priority_queue the top is the item which compares greatest, use std::greater for a min heap. Unlike
+ * std::priority_queue pop moves the top out, so move only types work.
+ *
+ * The template has its own sift functions and does not share the C queue's, which swaps nodes through cbt and trickles
+ * down from the top. Here a hole is moved instead of swapping items, and removal sifts the hole down to a leaf without
+ * comparing against the moved item, then bubbles it up from there (bottom up sift). That saves about half the
+ * comparisons of a classic trickle down since the last item usually belongs near a leaf.
+ *
+ * @author Brandon Bemister
+ */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(__GNUC__)
+#define CSTRUCTURES_PREFETCH(x) __builtin_prefetch(x)
+#else
+#define CSTRUCTURES_PREFETCH(x) ((void)0)
+#endif
+
+namespace cstructures {
+
+namespace heap {
+
+/**
+ * @brief Moves value up from the hole at index until its parent does not compare less.
+ *
+ * @param data The heap storage, the hole must hold a constructed but moved from item.
+ * @param index The hole.
+ * @param value The item to place.
+ * @param compare The comparator, compare(a, b) is true when a has the lower priority.
+ */
+template <std::size_t Arity, class T, class Compare>
+inline void bubble_up(T* data, std::size_t index, T&& value, Compare& compare){
+    while(index > 0){
+        std::size_t parent = (index - 1) / Arity;
+        if(!compare(data[parent], value)){
+            break;
+        }
+        data[index] = std::move(data[parent]);
+        index = parent;
+    }
+    data[index] = std::move(value);
+}
+
+/**
+ * @brief Moves the hole at index down to a leaf, always filling it from its greatest child.
+ *
+ * @param data The heap storage.
+ * @param index The hole.
+ * @param size The number of items taking part, the hole never moves to this index or past it.
+ * @param compare The comparator.
+ *
+ * @return The leaf the hole ended up in.
+ */
+template <std::size_t Arity, class T, class Compare>
+inline std::size_t trickle_down_hole(T* data, std::size_t index, std::size_t size, Compare& compare){
+    // Nodes with all Arity children, the child loop has a constant trip count.
+    std::size_t first = index * Arity + 1;
+    while(first + Arity <= size){
+        // The next level is needed whichever child wins, start fetching it while comparing.
+        std::size_t next = first * Arity + 1;
+        if(next < size){
+            CSTRUCTURES_PREFETCH(data + next);
+            CSTRUCTURES_PREFETCH(data + (next + Arity * Arity - 1 < size ? next + Arity * Arity - 1 : size - 1));
+        }
+        std::size_t best = first;
+        for(std::size_t child = first + 1; child < first + Arity; child++){
+            if(compare(data[best], data[child])){
+                best = child;
+            }
+        }
+        data[index] = std::move(data[best]);
+        index = best;
+        first = index * Arity + 1;
+    }
+    // At most one node has fewer children.
+    if(first < size){
+        std::size_t best = first;
+        for(std::size_t child = first + 1; child < size; child++){
+            if(compare(data[best], data[child])){
+                best = child;
+            }
+        }
+        data[index] = std::move(data[best]);
+        index = best;
+    }
+    return index;
+}
+
+} // namespace heap
+
+/**
+ * @brief A priority queue of T stored by value in a d-ary heap.
+ *
+ * @tparam T The item type, it only needs to be move constructible and move assignable.
+ * @tparam Compare A strict weak ordering, compare(a, b) is true when a has the lower priority.
+ * @tparam Arity Children per node, the default 8 keeps the heap a third shallower than 4, which pays off when popping
+ *               small T.
+ * @tparam Allocator The allocator for the item storage.
+ */
+template <class T, class Compare = std::less<T>, std::size_t Arity = 8, class Allocator = std::allocator<T>>
+class priority_queue {
+    static_assert(Arity >= 2, "A heap needs at least two children per node");
+
+    using alloc_traits = typename std::allocator_traits<Allocator>::template rebind_traits<T>;
+    using alloc_type = typename alloc_traits::allocator_type;
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+
+    explicit priority_queue(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : compare_(compare), alloc_(alloc) {}
+
+    priority_queue(const priority_queue& other)
+        : compare_(other.compare_),
+          alloc_(alloc_traits::select_on_container_copy_construction(other.alloc_)) {
+        reserve(other.size_);
+        for(; size_ < other.size_; size_++){
+            alloc_traits::construct(alloc_, data_ + size_, other.data_[size_]);
+        }
+    }
+
+    priority_queue(priority_queue&& other) noexcept
+        : compare_(std::move(other.compare_)), alloc_(std::move(other.alloc_)),
+          data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    priority_queue& operator=(priority_queue other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~priority_queue(){
+        clear();
+        if(data_ != nullptr){
+            alloc_traits::deallocate(alloc_, data_, capacity_);
+        }
+    }
+
+    void swap(priority_queue& other) noexcept {
+        using std::swap;
+        swap(compare_, other.compare_);
+        swap(alloc_, other.alloc_);
+        swap(data_, other.data_);
+        swap(size_, other.size_);
+        swap(capacity_, other.capacity_);
+    }
+
+    bool empty() const noexcept { return size_ == 0; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+
+    /** @brief The item with the highest priority, the queue must not be empty. */
+    const T& top() const { return data_[0]; }
+
+    /** @brief Makes room for at least capacity items without growing. */
+    void reserve(size_type capacity){
+        if(capacity <= capacity_){
+            return;
+        }
+        T* data = alloc_traits::allocate(alloc_, capacity);
+        for(size_type i = 0; i < size_; i++){
+            alloc_traits::construct(alloc_, data + i, std::move_if_noexcept(data_[i]));
+            alloc_traits::destroy(alloc_, data_ + i);
+        }
+        if(data_ != nullptr){
+            alloc_traits::deallocate(alloc_, data_, capacity_);
+        }
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    void push(const T& value){ emplace(value); }
+    void push(T&& value){ emplace(std::move(value)); }
+
+    /** @brief Constructs an item in place and moves it to its position in the heap. */
+    template <class... Args>
+    void emplace(Args&&... args){
+        if(size_ == capacity_){
+            reserve(capacity_ == 0 ? 16 : capacity_ * 2);
+        }
+        alloc_traits::construct(alloc_, data_ + size_, std::forward<Args>(args)...);
+        size_type index = size_++;
+        if(index > 0){
+            T value(std::move(data_[index]));
+            heap::bubble_up<Arity>(data_, index, std::move(value), compare_);
+        }
+    }
+
+    /** @brief Removes the item with the highest priority and returns it, the queue must not be empty. */
+    T pop(){
+        T top(std::move(data_[0]));
+        size_type last = --size_;
+        if(last > 0){
+            T value(std::move(data_[last]));
+            size_type hole = heap::trickle_down_hole<Arity>(data_, 0, last, compare_);
+            heap::bubble_up<Arity>(data_, hole, std::move(value), compare_);
+        }
+        alloc_traits::destroy(alloc_, data_ + last);
+        return top;
+    }
+
+    /** @brief Removes every item, the storage is kept. */
+    void clear() noexcept {
+        for(size_type i = 0; i < size_; i++){
+            alloc_traits::destroy(alloc_, data_ + i);
+        }
+        size_ = 0;
+    }
+
+private:
+    Compare compare_;
+    alloc_type alloc_;
+    T* data_ = nullptr;
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+};
+
+template <class T, class Compare, std::size_t Arity, class Allocator>
+void swap(priority_queue<T, Compare, Arity, Allocator>& a, priority_queue<T, Compare, Arity, Allocator>& b) noexcept {
+    a.swap(b);
+}
+
+} // namespace cstructures
+
+#endif //CSTRUCTURES_PRIO_QUEUE_HPP
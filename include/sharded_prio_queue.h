@@ -0,0 +1,151 @@
+/*
+ * Sharded Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_SHARDED_PRIO_QUEUE_H
+#define CSTRUCTURES_SHARDED_PRIO_QUEUE_H
+
+/**
+ * @file sharded_prio_queue.h
+ * @brief A sharded, NUMA aware, thread safe Priority Queue for c.
+ *
+ * The queue is split into shards, each a prio_queue with its own lock, by default one per NUMA node. Threads insert
+ * into the shard of the node they run on. With libnuma a shard's header and its heap array, also every larger array it
+ * grows into, are allocated on its node, so sifts stay in local memory whichever thread touches the pages first.
+ *
+ * A remove takes the better of the top of the local shard and the top of the shard holding the global best, which is
+ * cached and refreshed every SHARDED_PRIO_QUEUE_REFRESH removes or when the local shard runs dry. Removal order is
+ * therefore relaxed: between refreshes an item may be removed while a better one waits in a third shard. CST_EMPTY is
+ * only returned after every shard was seen empty.
+ *
+ * With libnuma on a machine with several nodes, shard i belongs to node i % nodes, also when the count of shards is
+ * given explicitly, and a thread picks among the shards of its node by the CPU it runs on. Without libnuma, on a
+ * single node, or on a node left without a shard, threads are spread over all shards by their CPU.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHARDED_PRIO_QUEUE_ENABLED CSTRUCTURES_GLOBAL_PARALLEL_ENABLE  /** The queue needs pthreads. */
+#define SHARDED_PRIO_QUEUE_NUMA_ENABLED CSTRUCTURES_GLOBAL_NUMA_ENABLE
+
+#define SHARDED_PRIO_QUEUE_REFRESH 64 /** Removes between refreshes of the cached global best shard. */
+
+#if SHARDED_PRIO_QUEUE_ENABLED
+
+/** @brief A handle for the sharded priority queue. */
+struct sharded_prio_queue_handle;
+
+/**
+ * @brief Initializes a new sharded priority queue.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param shards The number of shards, 0 for one per NUMA node (one without libnuma or on a single node machine).
+ * @param max_size The initial maximum size of every shard, a full shard doubles on insert.
+ * @param comparator A pointer to the callback function which compares data, see prio_queue_init.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err sharded_prio_queue_init(struct sharded_prio_queue_handle** hnd, size_t shards, size_t max_size,
+                                int (comparator)(void* c1, void* c2));
+
+/**
+ * @brief Frees a sharded priority queue, no thread may be using it.
+ *
+ * @param hnd The sharded priority queue handle which is to be freed.
+ */
+void sharded_prio_queue_free(struct sharded_prio_queue_handle* hnd);
+
+/**
+ * @brief Inserts into the shard local to the calling thread. Safe from any thread.
+ *
+ * @param hnd The sharded priority queue.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err sharded_prio_queue_insert(struct sharded_prio_queue_handle* hnd, void* data);
+
+/**
+ * @brief Inserts into a given shard. Safe from any thread.
+ *
+ * @param hnd The sharded priority queue.
+ * @param shard The shard, below sharded_prio_queue_shards.
+ * @param data A pointer to the data which is to be inserted.
+ *
+ * @return CST_OK if successful, CST_PARAM_ERR if the shard is out of range.
+ */
+cst_err sharded_prio_queue_insert_shard(struct sharded_prio_queue_handle* hnd, size_t shard, void* data);
+
+/**
+ * @brief Removes the better of the local and the cached global best shard's top. Safe from any thread.
+ *
+ * @param hnd The sharded priority queue.
+ * @param data A pointer to where the removed data will be placed.
+ *
+ * @return CST_OK if successful, CST_EMPTY if every shard was empty.
+ */
+cst_err sharded_prio_queue_remove(struct sharded_prio_queue_handle* hnd, void** data);
+
+/**
+ * @brief Get the number of shards.
+ *
+ * @param hnd The sharded priority queue.
+ *
+ * @return The number of shards, 0 if hnd is NULL.
+ */
+size_t sharded_prio_queue_shards(struct sharded_prio_queue_handle* hnd);
+
+/**
+ * @brief Get the shard the calling thread inserts into.
+ *
+ * @param hnd The sharded priority queue.
+ *
+ * @return The local shard.
+ */
+size_t sharded_prio_queue_local_shard(struct sharded_prio_queue_handle* hnd);
+
+/**
+ * @brief Get the number of items in all shards.
+ *
+ * @param hnd The sharded priority queue to get the size of.
+ *
+ * @return The number of items, only a snapshot when other threads use the queue.
+ */
+size_t sharded_prio_queue_size(struct sharded_prio_queue_handle* hnd);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CSTRUCTURES_SHARDED_PRIO_QUEUE_H
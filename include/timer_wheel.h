@@ -0,0 +1,119 @@
+/*
+ * Hierarchical Timer Wheel Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef CSTRUCTURES_TIMER_WHEEL_H
+#define CSTRUCTURES_TIMER_WHEEL_H
+
+/**
+ * @file timer_wheel.h
+ * @brief A Hierarchical Timer Wheel Implementation for c.
+ *
+ * Timers are kept in TIMER_WHEEL_LEVELS wheels of 64 slots each, every level being 64 times coarser than the one
+ * below it. Scheduling and cancelling a timer is O(1), deadlines too far in the future for the wheels are kept in a
+ * priority queue until they come into range.
+ *
+ * @author Brandon Bemister
+ */
+
+#include "cstructures_err.h"
+#include "cstructures_config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_LEVELS 4 /** Number of wheels, covers 64^TIMER_WHEEL_LEVELS ticks before using the heap. */
+
+/** @brief A handle for the timer wheel. */
+struct timer_wheel_handle;
+
+/** @brief A handle for a single scheduled timer. */
+struct timer_wheel_timer;
+
+/**
+ * @brief Initializes a new timer wheel.
+ *
+ * @param hnd The handle which will be initialized.
+ * @param now The current tick, timers are scheduled relative to this.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err timer_wheel_init(struct timer_wheel_handle** hnd, uint64_t now);
+
+/**
+ * @brief Frees a timer wheel, any pending timers are dropped without firing.
+ *
+ * @param hnd The timer wheel handle which is to be freed.
+ */
+void timer_wheel_free(struct timer_wheel_handle* hnd);
+
+/**
+ * @brief Schedules a new timer.
+ *
+ * @param hnd The timer wheel.
+ * @param deadline The tick at which the timer expires, deadlines already passed fire on the next advance.
+ * @param data A pointer to the data which is handed back when the timer expires.
+ * @param timer If not NULL the timer handle is placed here, it may be used to cancel the timer until it has fired.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err timer_wheel_schedule(struct timer_wheel_handle* hnd, uint64_t deadline, void* data,
+                             struct timer_wheel_timer** timer);
+
+/**
+ * @brief Cancels a timer which has not fired yet.
+ *
+ * @param hnd The timer wheel the timer was scheduled on.
+ * @param timer The timer to cancel, the handle is invalid after this call.
+ * @param data If not NULL the data of the cancelled timer is placed here.
+ *
+ * @return CST_OK if successful.
+ */
+cst_err timer_wheel_cancel(struct timer_wheel_handle* hnd, struct timer_wheel_timer* timer, void** data);
+
+/**
+ * @brief Advances the wheel and fires every timer due at or before now.
+ *
+ * Timers are fired in deadline order, timers which were already overdue when scheduled fire first in the order they
+ * were scheduled. The callback may schedule and cancel other timers.
+ *
+ * @param hnd The timer wheel.
+ * @param now The new current tick, must not be lower than the previous one.
+ * @param callback Called with the data of every expired timer.
+ * @param ctx A pointer which is handed to the callback.
+ *
+ * @return The number of timers fired.
+ */
+size_t timer_wheel_advance(struct timer_wheel_handle* hnd, uint64_t now, void (callback)(void* data, void* ctx),
+                           void* ctx);
+
+/**
+ * @brief Get the number of timers currently scheduled.
+ *
+ * @param hnd The timer wheel to get the size of.
+ *
+ * @return The number of scheduled timers.
+ */
+size_t timer_wheel_size(struct timer_wheel_handle* hnd);
+
+#endif //CSTRUCTURES_TIMER_WHEEL_H
@@ -0,0 +1,294 @@
+/*
+ * Aging Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/aging_prio_queue.h"
+
+#define AGING_PRIO_QUEUE_DEBUG 0
+
+#if AGING_PRIO_QUEUE_DEBUG
+
+#include <stdio.h>
+
+#define aq_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define aq_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define aq_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define aq_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include "stdlib.h"
+
+#define AQ_ALLOC(x) malloc(x);
+#define AQ_FREE(x) free(x);
+
+#define AQ_HEAP_INITIAL 16  /** Capacity of a class heap the first time it is used. */
+
+struct aq_entry{
+    double key;     // base + rate * inserted, the insertion tick folded into the priority.
+    void* data;
+};
+
+struct aq_class{
+    struct aq_entry* heap;  // Binary min heap on key.
+    size_t capacity;
+    size_t count;
+    double rate;
+};
+
+struct aging_prio_queue_handle{
+    struct aq_class* classes;
+    size_t class_count;
+    size_t max_data;
+    size_t size;
+    uint64_t start;         // Ticks are measured from here, keeping the keys small enough for a double.
+    uint64_t active;        // Bit c set if class c is not empty.
+};
+
+static cst_err __aq_grow(struct aq_class* cls){
+    size_t capacity = cls->capacity ? cls->capacity * 2 : AQ_HEAP_INITIAL;
+    struct aq_entry* heap = realloc(cls->heap, sizeof(struct aq_entry) * capacity);
+    if(heap == NULL){
+        aq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+    cls->heap = heap;
+    cls->capacity = capacity;
+    return CST_OK;
+}
+
+static void __aq_bubble_up(struct aq_entry* heap, size_t index, struct aq_entry entry){
+    while(index > 0){
+        size_t parent = (index - 1) / 2;
+        if(heap[parent].key <= entry.key){
+            break;
+        }
+        heap[index] = heap[parent];
+        index = parent;
+    }
+    heap[index] = entry;
+}
+
+// Moves the hole at the root down to a leaf along the smaller children and places entry on the way back up.
+static void __aq_sift_down(struct aq_entry* heap, size_t count, struct aq_entry entry){
+    size_t index = 0;
+    size_t child = 1;
+    while(child + 1 < count){
+        child += heap[child + 1].key < heap[child].key;
+        heap[index] = heap[child];
+        index = child;
+        child = index * 2 + 1;
+    }
+    if(child < count){
+        heap[index] = heap[child];
+        index = child;
+    }
+    __aq_bubble_up(heap, index, entry);
+}
+
+// The non empty class whose top has the lowest effective priority, the queue must not be empty.
+static size_t __aq_first_class(struct aging_prio_queue_handle* hnd, double age, double* priority){
+    uint64_t active = hnd->active;
+    size_t best = (size_t)__builtin_ctzll(active);
+    double best_priority = hnd->classes[best].heap[0].key - hnd->classes[best].rate * age;
+    active &= active - 1;
+    while(active){
+        size_t c = (size_t)__builtin_ctzll(active);
+        double p = hnd->classes[c].heap[0].key - hnd->classes[c].rate * age;
+        if(p < best_priority){
+            best = c;
+            best_priority = p;
+        }
+        active &= active - 1;
+    }
+    *priority = best_priority;
+    return best;
+}
+
+cst_err aging_prio_queue_init(struct aging_prio_queue_handle** hnd, size_t max_size, const double* rates,
+                              size_t classes, uint64_t now){
+    if(classes == 0 || classes > AGING_PRIO_QUEUE_MAX_CLASSES || rates == NULL){
+        aq_printfln("Bad Params");
+        *hnd = NULL;
+        return CST_PARAM_ERR;
+    }
+    for(size_t c = 0; c < classes; c++){
+        // Also rejects NaN.
+        if(!(rates[c] >= 0)){
+            aq_printfln("Bad Rate");
+            *hnd = NULL;
+            return CST_PARAM_ERR;
+        }
+    }
+
+    *hnd = AQ_ALLOC(sizeof(struct aging_prio_queue_handle));
+    if(*hnd == NULL){
+        aq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    (*hnd)->classes = calloc(classes, sizeof(struct aq_class));
+    if((*hnd)->classes == NULL){
+        AQ_FREE(*hnd);
+        *hnd = NULL;
+        return CST_MEM_ERR;
+    }
+    for(size_t c = 0; c < classes; c++){
+        (*hnd)->classes[c].rate = rates[c];
+    }
+
+    (*hnd)->class_count = classes;
+    (*hnd)->max_data = max_size;
+    (*hnd)->size = 0;
+    (*hnd)->start = now;
+    (*hnd)->active = 0;
+
+    return CST_OK;
+}
+
+void aging_prio_queue_free(struct aging_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return;
+    }
+    for(size_t c = 0; c < hnd->class_count; c++){
+        AQ_FREE(hnd->classes[c].heap);
+    }
+    AQ_FREE(hnd->classes);
+    AQ_FREE(hnd);
+}
+
+cst_err aging_prio_queue_insert(struct aging_prio_queue_handle* hnd, void* data, double base, size_t age_class,
+                                uint64_t now){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+    if(age_class >= hnd->class_count || now < hnd->start){
+        aq_printfln("Bad Params");
+        return CST_PARAM_ERR;
+    }
+    if(hnd->size >= hnd->max_data){
+        aq_printfln("Overflow");
+        return CST_OVERFLOW;
+    }
+
+    struct aq_class* cls = &hnd->classes[age_class];
+    if(cls->count == cls->capacity){
+        cst_err e = __aq_grow(cls);
+        if(e != CST_OK){
+            return e;
+        }
+    }
+
+    struct aq_entry entry;
+    entry.key = base + cls->rate * (double)(now - hnd->start);
+    entry.data = data;
+    __aq_bubble_up(cls->heap, cls->count++, entry);
+
+    hnd->active |= (uint64_t)1 << age_class;
+    hnd->size++;
+    return CST_OK;
+}
+
+cst_err aging_prio_queue_remove(struct aging_prio_queue_handle* hnd, void** data, uint64_t now){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+    if(hnd->size == 0){
+        return CST_EMPTY;
+    }
+
+    double priority;
+    double age = now > hnd->start ? (double)(now - hnd->start) : 0;
+    size_t c = __aq_first_class(hnd, age, &priority);
+    struct aq_class* cls = &hnd->classes[c];
+
+    *data = cls->heap[0].data;
+    if(--cls->count > 0){
+        __aq_sift_down(cls->heap, cls->count, cls->heap[cls->count]);
+    }else{
+        hnd->active &= ~((uint64_t)1 << c);
+    }
+    hnd->size--;
+    return CST_OK;
+}
+
+cst_err aging_prio_queue_peek(struct aging_prio_queue_handle* hnd, void** data, double* priority, uint64_t now){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+    if(hnd->size == 0){
+        return CST_EMPTY;
+    }
+
+    double p;
+    double age = now > hnd->start ? (double)(now - hnd->start) : 0;
+    size_t c = __aq_first_class(hnd, age, &p);
+    *data = hnd->classes[c].heap[0].data;
+    if(priority != NULL){
+        *priority = p;
+    }
+    return CST_OK;
+}
+
+int aging_prio_queue_size(struct aging_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    return (int)hnd->size;
+}
+
+#if AGING_PRIO_QUEUE_RESIZE_ENABLED
+
+cst_err aging_prio_queue_resize(struct aging_prio_queue_handle* hnd, size_t new_size){
+    // Safety check
+    if(hnd == NULL){
+        aq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    // Class heaps grow on demand, only the limit has to change.
+    if(new_size < hnd->size){
+        aq_printfln("Contains too many items to shrink");
+        return CST_FAIL;
+    }
+
+    hnd->max_data = new_size;
+    return CST_OK;
+}
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Async Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/async_prio_queue.h"
+
+#if ASYNC_PRIO_QUEUE_ENABLED
+
+#include "../include/prio_queue.h"
+
+#define ASYNC_PRIO_QUEUE_DEBUG 0
+
+#if ASYNC_PRIO_QUEUE_DEBUG
+
+#include <stdio.h>
+
+#define apq_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define apq_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define apq_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define apq_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "stdlib.h"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#define APQ_EVENTFD 1
+#else
+#define APQ_EVENTFD 0
+#endif
+
+#define APQ_ALLOC(x) malloc(x);
+#define APQ_FREE(x) free(x);
+
+struct async_prio_queue_handle{
+    struct prio_queue_handle* queue;
+    pthread_mutex_t lock;
+    int read_fd;    // The descriptor handed out, the eventfd or the pipe's read end.
+    int write_fd;   // Same as read_fd for an eventfd.
+    size_t size;
+    size_t max_size;
+};
+
+static cst_err __apq_open(struct async_prio_queue_handle* hnd){
+#if APQ_EVENTFD
+    hnd->read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    hnd->write_fd = hnd->read_fd;
+    return hnd->read_fd < 0 ? CST_IO_ERR : CST_OK;
+#else
+    int fds[2];
+    if(pipe(fds) != 0){
+        return CST_IO_ERR;
+    }
+    for(int i = 0; i < 2; i++){
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    hnd->read_fd = fds[0];
+    hnd->write_fd = fds[1];
+    return CST_OK;
+#endif
+}
+
+static void __apq_close(struct async_prio_queue_handle* hnd){
+    close(hnd->read_fd);
+    if(hnd->write_fd != hnd->read_fd){
+        close(hnd->write_fd);
+    }
+}
+
+// Both are called with the lock held, so signal and drain never interleave and the descriptor holds one token at most.
+static void __apq_signal(struct async_prio_queue_handle* hnd){
+#if APQ_EVENTFD
+    uint64_t one = 1;
+    while(write(hnd->write_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+#else
+    char one = 1;
+    while(write(hnd->write_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+#endif
+}
+
+static void __apq_drain(struct async_prio_queue_handle* hnd){
+#if APQ_EVENTFD
+    uint64_t value;
+    while(read(hnd->read_fd, &value, sizeof(value)) < 0 && errno == EINTR);
+#else
+    char value;
+    while(read(hnd->read_fd, &value, sizeof(value)) < 0 && errno == EINTR);
+#endif
+}
+
+cst_err async_prio_queue_init(struct async_prio_queue_handle** hnd, size_t max_size,
+                              int (comparator)(void* c1, void* c2)){
+    // Safety check
+    if(hnd == NULL){
+        return CST_PARAM_ERR;
+    }
+
+    struct async_prio_queue_handle* apq = APQ_ALLOC(sizeof(struct async_prio_queue_handle));
+    if(apq == NULL){
+        apq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+    apq->queue = NULL;
+    apq->size = 0;
+    apq->max_size = max_size;
+
+    cst_err err = prio_queue_init(&apq->queue, max_size, comparator);
+    if(err != CST_OK){
+        APQ_FREE(apq);
+        return err;
+    }
+    if(__apq_open(apq) != CST_OK){
+        apq_printfln("Could not create the file descriptor");
+        prio_queue_free(apq->queue);
+        APQ_FREE(apq);
+        return CST_IO_ERR;
+    }
+    if(pthread_mutex_init(&apq->lock, NULL) != 0){
+        __apq_close(apq);
+        prio_queue_free(apq->queue);
+        APQ_FREE(apq);
+        return CST_FAIL;
+    }
+
+    *hnd = apq;
+    return CST_OK;
+}
+
+void async_prio_queue_free(struct async_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        return;
+    }
+
+    pthread_mutex_destroy(&hnd->lock);
+    __apq_close(hnd);
+    prio_queue_free(hnd->queue);
+    APQ_FREE(hnd);
+}
+
+cst_err async_prio_queue_insert(struct async_prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        return CST_PARAM_ERR;
+    }
+
+    pthread_mutex_lock(&hnd->lock);
+    cst_err err = prio_queue_insert(hnd->queue, data);
+#if PRIO_QUEUE_RESIZE_ENABLED
+    // Producers on other threads cannot resize in between, so a full queue grows here.
+    if(err == CST_OVERFLOW){
+        size_t max_size = hnd->max_size ? hnd->max_size * 2 : 16;
+        err = prio_queue_resize(hnd->queue, max_size);
+        if(err == CST_OK){
+            hnd->max_size = max_size;
+            err = prio_queue_insert(hnd->queue, data);
+        }
+    }
+#endif
+    if(err == CST_OK && hnd->size++ == 0){
+        __apq_signal(hnd);
+    }
+    pthread_mutex_unlock(&hnd->lock);
+    return err;
+}
+
+cst_err async_prio_queue_remove(struct async_prio_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL || data == NULL){
+        return CST_PARAM_ERR;
+    }
+
+    pthread_mutex_lock(&hnd->lock);
+    cst_err err = prio_queue_remove(hnd->queue, data);
+    if(err == CST_OK && --hnd->size == 0){
+        __apq_drain(hnd);
+    }
+    pthread_mutex_unlock(&hnd->lock);
+    return err;
+}
+
+int async_prio_queue_fd(struct async_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        return -1;
+    }
+    return hnd->read_fd;
+}
+
+size_t async_prio_queue_size(struct async_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        return 0;
+    }
+
+    pthread_mutex_lock(&hnd->lock);
+    size_t size = hnd->size;
+    pthread_mutex_unlock(&hnd->lock);
+    return size;
+}
+
+#endif
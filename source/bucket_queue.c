@@ -0,0 +1,256 @@
+/*
+ * Bucket Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/bucket_queue.h"
+
+#define BUCKET_QUEUE_DEBUG 0
+
+#if BUCKET_QUEUE_DEBUG
+
+#include <stdio.h>
+
+#define bq_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define bq_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define bq_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define bq_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include <stdint.h>
+#include "stdlib.h"
+
+#define BQ_ALLOC(x) malloc(x);
+#define BQ_FREE(x) free(x);
+
+#define BQ_WORD_BITS 64
+#define BQ_WORDS (BUCKET_QUEUE_MAX_LEVELS / BQ_WORD_BITS)
+#define BQ_RING_INITIAL 8  /** Capacity of a level ring the first time it is used, always a power of two. */
+
+struct bq_ring{
+    void** items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+};
+
+struct bucket_queue_handle{
+    struct bq_ring* rings;
+    size_t levels;
+    size_t max_data;
+    size_t size;
+    uint64_t summary;           // Bit w set if words[w] is not zero.
+    uint64_t words[BQ_WORDS];   // Bit l set if level l is not empty.
+    unsigned int (*priority)(void* data);
+};
+
+static cst_err __bq_ring_grow(struct bq_ring* ring){
+    size_t capacity = ring->capacity ? ring->capacity * 2 : BQ_RING_INITIAL;
+    void** items = BQ_ALLOC(sizeof(void*) * capacity);
+    if(items == NULL){
+        bq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    // Unwrap the ring into the start of the new array.
+    for(size_t i = 0; i < ring->count; i++){
+        items[i] = ring->items[(ring->head + i) & (ring->capacity - 1)];
+    }
+
+    BQ_FREE(ring->items);
+    ring->items = items;
+    ring->capacity = capacity;
+    ring->head = 0;
+    return CST_OK;
+}
+
+// Finds the lowest non empty level, the queue must not be empty.
+static size_t __bq_first_level(struct bucket_queue_handle* hnd){
+    size_t word = (size_t)__builtin_ctzll(hnd->summary);
+    return word * BQ_WORD_BITS + (size_t)__builtin_ctzll(hnd->words[word]);
+}
+
+cst_err bucket_queue_init(struct bucket_queue_handle** hnd, size_t levels, size_t max_size,
+                          unsigned int (priority)(void* data)){
+    if(levels == 0 || levels > BUCKET_QUEUE_MAX_LEVELS || priority == NULL){
+        bq_printfln("Bad Params");
+        *hnd = NULL;
+        return CST_PARAM_ERR;
+    }
+
+    *hnd = BQ_ALLOC(sizeof(struct bucket_queue_handle));
+    if(*hnd == NULL){
+        bq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    (*hnd)->rings = calloc(levels, sizeof(struct bq_ring));
+    if((*hnd)->rings == NULL){
+        BQ_FREE(*hnd);
+        *hnd = NULL;
+        return CST_MEM_ERR;
+    }
+
+    (*hnd)->levels = levels;
+    (*hnd)->max_data = max_size;
+    (*hnd)->size = 0;
+    (*hnd)->summary = 0;
+    for(int i = 0; i < BQ_WORDS; i++){
+        (*hnd)->words[i] = 0;
+    }
+    (*hnd)->priority = priority;
+
+    return CST_OK;
+}
+
+void bucket_queue_free(struct bucket_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return;
+    }
+    for(size_t i = 0; i < hnd->levels; i++){
+        BQ_FREE(hnd->rings[i].items);
+    }
+    BQ_FREE(hnd->rings);
+    BQ_FREE(hnd);
+}
+
+cst_err bucket_queue_insert(struct bucket_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->size == hnd->max_data){
+        bq_printfln("No Room");
+        return CST_OVERFLOW;
+    }
+
+    size_t level = hnd->priority(data);
+    if(level >= hnd->levels){
+        bq_printfln("Priority out of range");
+        return CST_PARAM_ERR;
+    }
+
+    struct bq_ring* ring = &hnd->rings[level];
+    if(ring->count == ring->capacity){
+        cst_err e = __bq_ring_grow(ring);
+        if(e != CST_OK){
+            return e;
+        }
+    }
+
+    ring->items[(ring->head + ring->count) & (ring->capacity - 1)] = data;
+    ring->count++;
+    hnd->size++;
+
+    size_t word = level / BQ_WORD_BITS;
+    hnd->words[word] |= 1ULL << (level % BQ_WORD_BITS);
+    hnd->summary |= 1ULL << word;
+
+    return CST_OK;
+}
+
+cst_err bucket_queue_remove(struct bucket_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->size == 0){
+        // Nothing to remove
+        return CST_EMPTY;
+    }
+
+    size_t level = __bq_first_level(hnd);
+    struct bq_ring* ring = &hnd->rings[level];
+    *data = ring->items[ring->head];
+    ring->head = (ring->head + 1) & (ring->capacity - 1);
+    ring->count--;
+    hnd->size--;
+
+    if(ring->count == 0){
+        size_t word = level / BQ_WORD_BITS;
+        hnd->words[word] &= ~(1ULL << (level % BQ_WORD_BITS));
+        if(hnd->words[word] == 0){
+            hnd->summary &= ~(1ULL << word);
+        }
+    }
+
+    return CST_OK;
+}
+
+cst_err bucket_queue_peek(struct bucket_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->size == 0){
+        // Nothing to look at
+        return CST_EMPTY;
+    }
+
+    struct bq_ring* ring = &hnd->rings[__bq_first_level(hnd)];
+    *data = ring->items[ring->head];
+    return CST_OK;
+}
+
+int bucket_queue_size(struct bucket_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    return (int)hnd->size;
+}
+
+#if BUCKET_QUEUE_RESIZE_ENABLED
+
+cst_err bucket_queue_resize(struct bucket_queue_handle* hnd, size_t new_size){
+    // Safety check
+    if(hnd == NULL){
+        bq_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    // Rings grow on demand, only the limit has to change.
+    if(new_size < hnd->max_data && new_size <= hnd->size){
+        bq_printfln("Contains too many items to shrink");
+        return CST_FAIL;
+    }
+
+    hnd->max_data = new_size;
+    return CST_OK;
+}
+
+#endif
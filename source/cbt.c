@@ -26,9 +26,7 @@
 #include "../include/cbt.h"
 #include <stdlib.h>
 
-#if CBT_RESIZE_ENABLED
 #include "string.h"
-#endif //CBT_RESIZE_ENABLED
 
 #define CBT_DEBUG 0
 
@@ -49,28 +47,46 @@
 #define CBT_ALLOC(x) malloc(x);
 #define CBT_FREE(x) free(x);
 
-struct cbt_node{
-    void* data;
-    int index;
-};
+#if !CBT_INLINE_ENABLED
+#include "../include/cbt_inline.h"
+#endif
+
+static void* __cbt_alloc_nodes(struct cbt_handle *hnd, size_t count){
+    size_t size = sizeof(struct cbt_node) * count;
+    if(hnd->allocator.alloc != NULL){
+        return hnd->allocator.alloc(size, hnd->allocator.ctx);
+    }
+    return CBT_ALLOC(size)
+}
 
-struct cbt_handle{
-    struct cbt_node* tree_data;
-    size_t max_data;
-    int end;
-};
+static void __cbt_free_nodes(struct cbt_handle *hnd, struct cbt_node* nodes, size_t count){
+    if(hnd->allocator.free != NULL){
+        hnd->allocator.free(nodes, sizeof(struct cbt_node) * count, hnd->allocator.ctx);
+        return;
+    }
+    CBT_FREE(nodes)
+}
 
 cst_err cbt_init(struct cbt_handle **hnd, size_t max_size){
+    return cbt_init_allocator(hnd, max_size, NULL);
+}
+
+cst_err cbt_init_allocator(struct cbt_handle **hnd, size_t max_size, const struct cbt_allocator* allocator){
     cbt_printfln("Initializing %d", (int)max_size);
     // Alloc handle and data
     *hnd = CBT_ALLOC(sizeof(struct cbt_handle))
-    (*hnd)->tree_data = CBT_ALLOC(sizeof(struct cbt_node) * max_size);
-    (*hnd)->max_data = max_size;
     // Do memory checks
     if(*hnd == NULL){
         cbt_printfln("Alloc Error");
         return CST_MEM_ERR;
     }
+    if(allocator != NULL){
+        (*hnd)->allocator = *allocator;
+    } else {
+        memset(&(*hnd)->allocator, 0, sizeof((*hnd)->allocator));
+    }
+    (*hnd)->tree_data = __cbt_alloc_nodes(*hnd, max_size);
+    (*hnd)->max_data = max_size;
     if((*hnd)->tree_data == NULL){
         CBT_FREE(*hnd);
         cbt_printfln("Alloc Error");
@@ -89,8 +105,9 @@ cst_err cbt_free(struct cbt_handle *hnd){
         return CST_FAIL;
     }
 
-    CBT_FREE(hnd->tree_data)
+    __cbt_free_nodes(hnd, hnd->tree_data, hnd->max_data);
     CBT_FREE(hnd);
+    return CST_OK;
 }
 
 struct cbt_node* cbt_insert(struct cbt_handle *hnd, void* data){
@@ -131,108 +148,14 @@ cst_err cbt_remove(struct cbt_handle *hnd, void** data){
     return CST_OK;
 }
 
-int cbt_size(struct cbt_handle *hnd){
+cst_err cbt_clear(struct cbt_handle *hnd){
     // Safety check
     if(!hnd){
         cbt_printfln("Null Handle");
         return CST_FAIL;
     }
 
-    return hnd->end;
-}
-
-cst_err cbt_swap(struct cbt_node* n1, struct cbt_node* n2){
-    void* tmp = n1->data;
-    n1->data = n2->data;
-    n2->data = tmp;
-    return CST_OK;
-}
-
-struct cbt_node* cbt_get_root(struct cbt_handle *hnd){
-    // Safety check
-    if(!hnd){
-        cbt_printfln("Null Handle");
-        return NULL;
-    }
-
-    if(cbt_size(hnd) == 0){
-        cbt_printfln("Empty");
-        return NULL;
-    }
-
-    return &hnd->tree_data[0];
-}
-
-struct cbt_node* cbt_get_child_left(struct cbt_handle *hnd, struct cbt_node* node){
-    // Safety check
-    if(!hnd || !node){
-        cbt_printfln("Null Handle");
-        return NULL;
-    }
-
-    // Calculate the location of the child in the array
-    int index = (2 * node->index) + 1;
-    if(index >= hnd->end){
-        cbt_printfln("Too Small");
-        return NULL;
-    }
-
-    return &hnd->tree_data[index];
-}
-
-struct cbt_node* cbt_get_child_right(struct cbt_handle *hnd, struct cbt_node* node){
-    // Safety check
-    if(!hnd || !node){
-        cbt_printfln("Null Handle");
-        return NULL;
-    }
-
-    // Calculate the location of the child in the array
-    int index = (2 * node->index) + 2;
-    if(index >= hnd->end){
-        cbt_printfln("Too Small");
-        return NULL;
-    }
-
-    return &hnd->tree_data[index];
-}
-
-struct cbt_node* cbt_get_parent(struct cbt_handle *hnd, struct cbt_node* node){
-    // Safety check
-    if(!hnd || !node){
-        cbt_printfln("Null Handle");
-        return NULL;
-    }
-
-    // Check if node is root
-    if(node->index == 0){
-        cbt_printfln("Is Root");
-        return NULL;
-    }
-
-    // Calculate the location of the parent in the array
-    int index = (node->index - 1) / 2;
-
-    return &hnd->tree_data[index];
-}
-
-void* cbt_get_data(struct cbt_node* node){
-    // Safety check
-    if(!node){
-        cbt_printfln("Null Handle");
-        return NULL;
-    }
-
-    return node->data;
-}
-
-cst_err cbt_set_data(struct cbt_node* node, void* data){
-    // Safety check
-    if(!node){
-        cbt_printfln("Null Handle");
-        return CST_PARAM_ERR;
-    }
-    node->data = data;
+    hnd->end = 0;
     return CST_OK;
 }
 
@@ -245,38 +168,23 @@ cst_err cbt_resize(struct cbt_handle *hnd, size_t new_size){
         return CST_FAIL;
     }
 
-    if(new_size > hnd->max_data){
-        struct cbt_node *tmp = CBT_ALLOC(sizeof(struct cbt_node) * new_size);
-        if(tmp == NULL){
-            cbt_printfln("Failed to Alloc");
-            return CST_MEM_ERR;
-        }
-
-        memcpy(tmp, hnd->tree_data, (sizeof(struct cbt_node) * hnd->max_data));
-
-        CBT_FREE(hnd->tree_data);
-
-        hnd->max_data = new_size;
-        hnd->tree_data = tmp;
-    } else {
-        if(new_size <= cbt_size(hnd)){
-            cbt_printfln("Contains too many items to shrink");
-            return CST_FAIL;
-        }
+    if(new_size <= hnd->max_data && new_size <= (size_t)cbt_size(hnd)){
+        cbt_printfln("Contains too many items to shrink");
+        return CST_FAIL;
+    }
 
-        struct cbt_node *tmp = CBT_ALLOC(sizeof(struct cbt_node) * new_size);
-        if(tmp == NULL){
-            cbt_printfln("Failed to Alloc");
-            return CST_MEM_ERR;
-        }
+    struct cbt_node *tmp = __cbt_alloc_nodes(hnd, new_size);
+    if(tmp == NULL){
+        cbt_printfln("Failed to Alloc");
+        return CST_MEM_ERR;
+    }
 
-        memcpy(tmp, hnd->tree_data, (sizeof(struct cbt_node) * hnd->max_data));
+    memcpy(tmp, hnd->tree_data, sizeof(struct cbt_node) * (new_size < hnd->max_data ? new_size : hnd->max_data));
 
-        CBT_FREE(hnd->tree_data);
+    __cbt_free_nodes(hnd, hnd->tree_data, hnd->max_data);
 
-        hnd->max_data = new_size;
-        hnd->tree_data = tmp;
-    }
+    hnd->max_data = new_size;
+    hnd->tree_data = tmp;
     return CST_OK;
 }
 
@@ -0,0 +1,99 @@
+/*
+ * Complete Binary Tree Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/cstructures_crc.h"
+#include "../include/cstructures_config.h"
+
+#include <string.h>
+
+#if CSTRUCTURES_GLOBAL_PARALLEL_ENABLE
+#include <pthread.h>
+#endif
+
+#define CST_CRC32_POLY 0xEDB88320u
+
+// Slicing by eight, table[k][b] is the crc of byte b followed by k zero bytes. Built once on first use, snapshots
+// may be taken from several threads at the same time.
+static uint32_t crc_table[8][256];
+#if CSTRUCTURES_GLOBAL_PARALLEL_ENABLE
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+#else
+static int crc_table_ready = 0;
+#endif
+
+static void __cst_crc32_init(void){
+    for(uint32_t b = 0; b < 256; b++){
+        uint32_t crc = b;
+        for(int bit = 0; bit < 8; bit++){
+            crc = (crc >> 1) ^ (CST_CRC32_POLY & (0u - (crc & 1)));
+        }
+        crc_table[0][b] = crc;
+    }
+    for(uint32_t b = 0; b < 256; b++){
+        for(int k = 1; k < 8; k++){
+            crc_table[k][b] = (crc_table[k - 1][b] >> 8) ^ crc_table[0][crc_table[k - 1][b] & 0xFF];
+        }
+    }
+}
+
+uint32_t cst_crc32(uint32_t crc, const void* buf, size_t len){
+#if CSTRUCTURES_GLOBAL_PARALLEL_ENABLE
+    pthread_once(&crc_table_once, &__cst_crc32_init);
+#else
+    if(!crc_table_ready){
+        __cst_crc32_init();
+        crc_table_ready = 1;
+    }
+#endif
+
+    const unsigned char* p = buf;
+    crc = ~crc;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Byte at a time until aligned, then eight bytes at a time.
+    while(len > 0 && ((uintptr_t)p & 7) != 0){
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+        len--;
+    }
+    while(len >= 8){
+        // memcpy keeps the loads free of aliasing and alignment assumptions, compilers turn it into plain loads.
+        uint32_t lo, hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^ crc_table[5][(lo >> 16) & 0xFF] ^
+              crc_table[4][lo >> 24] ^ crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while(len > 0){
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+        len--;
+    }
+
+    return ~crc;
+}
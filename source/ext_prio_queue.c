@@ -0,0 +1,561 @@
+/*
+ * External Memory Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/ext_prio_queue.h"
+#include "../include/prio_queue.h"
+
+#define EXT_PRIO_QUEUE_DEBUG 0
+
+#if EXT_PRIO_QUEUE_DEBUG
+
+#define ext_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define ext_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define ext_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define ext_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "stdlib.h"
+
+#define EXT_ALLOC(x) malloc(x);
+#define EXT_FREE(x) free(x);
+
+#define EXT_RUN_TEMPLATE "/cstructures-run-XXXXXX"
+#define EXT_SCRATCH_INITIAL 256
+
+struct ext_run{
+    FILE* file;
+    char* io_buffer;
+    void* head;
+    long head_offset;   // Where the record of head starts, a failed merge rewinds the run to here.
+    size_t remaining;   // Records after head not read yet.
+    struct ext_prio_queue_handle* owner;
+};
+
+struct ext_prio_queue_handle{
+    struct prio_queue_handle* buffer;
+    struct prio_queue_handle* runs;
+    size_t buffer_items;
+    size_t count;
+    char* dir;
+    int (*comparator)(void* c1, void* c2);
+    struct ext_prio_queue_serializer serializer;
+    void** spill;
+    unsigned char* scratch;
+    size_t scratch_cap;
+};
+
+static int __ext_run_compare(void* c1, void* c2){
+    struct ext_run* r1 = c1;
+    struct ext_run* r2 = c2;
+    return r1->owner->comparator(r1->head, r2->head);
+}
+
+static cst_err __ext_scratch_reserve(struct ext_prio_queue_handle* hnd, size_t size){
+    if(size <= hnd->scratch_cap){
+        return CST_OK;
+    }
+    size_t cap = hnd->scratch_cap ? hnd->scratch_cap : EXT_SCRATCH_INITIAL;
+    while(cap < size){
+        cap *= 2;
+    }
+    unsigned char* scratch = EXT_ALLOC(cap);
+    if(scratch == NULL){
+        ext_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+    EXT_FREE(hnd->scratch);
+    hnd->scratch = scratch;
+    hnd->scratch_cap = cap;
+    return CST_OK;
+}
+
+// Opens a new run file, the file is unlinked straight away so nothing is left behind after a crash.
+static cst_err __ext_run_open(struct ext_prio_queue_handle* hnd, struct ext_run** run){
+    size_t dir_len = strlen(hnd->dir);
+    char* path = EXT_ALLOC(dir_len + sizeof(EXT_RUN_TEMPLATE));
+    if(path == NULL){
+        return CST_MEM_ERR;
+    }
+    memcpy(path, hnd->dir, dir_len);
+    memcpy(path + dir_len, EXT_RUN_TEMPLATE, sizeof(EXT_RUN_TEMPLATE));
+
+    int fd = mkstemp(path);
+    if(fd < 0){
+        ext_printfln("Could not create %s", path);
+        EXT_FREE(path);
+        return CST_IO_ERR;
+    }
+    unlink(path);
+    EXT_FREE(path);
+
+    *run = EXT_ALLOC(sizeof(struct ext_run));
+    if(*run == NULL){
+        close(fd);
+        return CST_MEM_ERR;
+    }
+    (*run)->io_buffer = EXT_ALLOC(EXT_PRIO_QUEUE_IO_BUFFER);
+    (*run)->file = fdopen(fd, "w+b");
+    if((*run)->io_buffer == NULL || (*run)->file == NULL){
+        if((*run)->file != NULL){
+            fclose((*run)->file);
+        } else {
+            close(fd);
+        }
+        EXT_FREE((*run)->io_buffer);
+        EXT_FREE(*run);
+        return CST_MEM_ERR;
+    }
+    setvbuf((*run)->file, (*run)->io_buffer, _IOFBF, EXT_PRIO_QUEUE_IO_BUFFER);
+    (*run)->head = NULL;
+    (*run)->head_offset = 0;
+    (*run)->remaining = 0;
+    (*run)->owner = hnd;
+    return CST_OK;
+}
+
+static void __ext_run_close(struct ext_run* run){
+    fclose(run->file);
+    EXT_FREE(run->io_buffer);
+    EXT_FREE(run);
+}
+
+static cst_err __ext_run_write(struct ext_prio_queue_handle* hnd, struct ext_run* run, void* data){
+    size_t len = hnd->serializer.serialize(data, hnd->scratch, hnd->scratch_cap);
+    if(len > hnd->scratch_cap){
+        cst_err e = __ext_scratch_reserve(hnd, len);
+        if(e != CST_OK){
+            return e;
+        }
+        len = hnd->serializer.serialize(data, hnd->scratch, hnd->scratch_cap);
+    }
+    if(len > UINT32_MAX){
+        return CST_PARAM_ERR;
+    }
+
+    uint32_t len32 = (uint32_t)len;
+    if(fwrite(&len32, sizeof(len32), 1, run->file) != 1 || fwrite(hnd->scratch, 1, len, run->file) != len){
+        ext_printfln("Write Failed");
+        return CST_IO_ERR;
+    }
+    run->remaining++;
+    return CST_OK;
+}
+
+// Reads the next item of a run into its head, CST_EMPTY once the run is exhausted. On an error the run is left as it
+// was, head included, and the read may be retried.
+static cst_err __ext_run_next(struct ext_prio_queue_handle* hnd, struct ext_run* run){
+    if(run->remaining == 0){
+        run->head = NULL;
+        return CST_EMPTY;
+    }
+
+    long offset = ftell(run->file);
+    if(offset < 0){
+        return CST_IO_ERR;
+    }
+    cst_err e = CST_IO_ERR;
+    uint32_t len = 0;
+    if(fread(&len, sizeof(len), 1, run->file) != 1){
+        ext_printfln("Read Failed");
+        goto rewind;
+    }
+    e = __ext_scratch_reserve(hnd, len);
+    if(e != CST_OK){
+        goto rewind;
+    }
+    if(fread(hnd->scratch, 1, len, run->file) != len){
+        ext_printfln("Read Failed");
+        e = CST_IO_ERR;
+        goto rewind;
+    }
+
+    void* head = hnd->serializer.deserialize(hnd->scratch, len);
+    if(head == NULL){
+        e = CST_MEM_ERR;
+        goto rewind;
+    }
+    run->head = head;
+    run->head_offset = offset;
+    run->remaining--;
+    return CST_OK;
+
+    rewind:
+    clearerr(run->file);
+    fseek(run->file, offset, SEEK_SET);
+    return e;
+}
+
+// Switches a fully written run over to reading and adds it to the merge heap, the run is closed if it is empty or on
+// failure.
+static cst_err __ext_run_start(struct ext_prio_queue_handle* hnd, struct ext_run* run){
+    if(fflush(run->file) != 0 || fseek(run->file, 0, SEEK_SET) != 0){
+        __ext_run_close(run);
+        return CST_IO_ERR;
+    }
+    cst_err e = __ext_run_next(hnd, run);
+    if(e == CST_EMPTY){
+        __ext_run_close(run);
+        return CST_OK;
+    }
+    if(e != CST_OK){
+        __ext_run_close(run);
+        return e;
+    }
+    e = prio_queue_insert(hnd->runs, run);
+    if(e != CST_OK){
+        // Untracked the run would leak, its items are still with the caller, which puts them back.
+        ext_printfln("Run not tracked");
+        if(hnd->serializer.release != NULL){
+            hnd->serializer.release(run->head);
+        }
+        __ext_run_close(run);
+    }
+    return e;
+}
+
+// Takes the head of the best run and moves that run on to its next item. If the next item can not be read the run
+// keeps its head and nothing is taken.
+static cst_err __ext_run_pop(struct ext_prio_queue_handle* hnd, void** data){
+    void* top = NULL;
+    cst_err e = prio_queue_remove(hnd->runs, &top);
+    if(e != CST_OK){
+        return e;
+    }
+    struct ext_run* run = top;
+    void* head = run->head;
+
+    e = __ext_run_next(hnd, run);
+    if(e == CST_EMPTY){
+        __ext_run_close(run);
+        *data = head;
+        return CST_OK;
+    }
+    prio_queue_insert(hnd->runs, run);
+    if(e != CST_OK){
+        return e;
+    }
+    *data = head;
+    return CST_OK;
+}
+
+static int __ext_run_compare_remaining(const void* c1, const void* c2){
+    const struct ext_run* r1 = *(struct ext_run* const*)c1;
+    const struct ext_run* r2 = *(struct ext_run* const*)c2;
+    return (r1->remaining > r2->remaining) - (r1->remaining < r2->remaining);
+}
+
+// Merges the EXT_PRIO_QUEUE_MERGE_RUNS smallest runs into one new run, so every item is merged about
+// log(n / buffer_items) / log(EXT_PRIO_QUEUE_MERGE_RUNS) times. The old runs are closed once the new run is complete.
+// On failure they are rewound to their heads and go back into the queue unchanged, a run which can not be read again
+// is dropped and its items are no longer counted.
+static cst_err __ext_merge_runs(struct ext_prio_queue_handle* hnd){
+    struct ext_run* runs[EXT_PRIO_QUEUE_MAX_RUNS + 1];
+    long offsets[EXT_PRIO_QUEUE_MAX_RUNS + 1];
+    size_t remaining[EXT_PRIO_QUEUE_MAX_RUNS + 1];
+    size_t total = 0;
+    void* top = NULL;
+    while(total < EXT_PRIO_QUEUE_MAX_RUNS + 1 && prio_queue_remove(hnd->runs, &top) == CST_OK){
+        runs[total++] = top;
+    }
+    qsort(runs, total, sizeof(runs[0]), &__ext_run_compare_remaining);
+    size_t merging = total < EXT_PRIO_QUEUE_MERGE_RUNS ? total : EXT_PRIO_QUEUE_MERGE_RUNS;
+    for(size_t i = merging; i < total; i++){
+        prio_queue_insert(hnd->runs, runs[i]);
+    }
+
+    struct prio_queue_handle* heap = NULL;
+    struct ext_run* merged = NULL;
+    cst_err e = prio_queue_init(&heap, merging + 1, &__ext_run_compare);
+    if(e == CST_OK){
+        e = __ext_run_open(hnd, &merged);
+    }
+    for(size_t i = 0; i < merging; i++){
+        offsets[i] = runs[i]->head_offset;
+        remaining[i] = runs[i]->remaining;
+        if(e == CST_OK){
+            prio_queue_insert(heap, runs[i]);
+        }
+    }
+
+    while(e == CST_OK && prio_queue_remove(heap, &top) == CST_OK){
+        struct ext_run* run = top;
+        void* data = run->head;
+        e = __ext_run_write(hnd, merged, data);
+        if(e == CST_OK){
+            e = __ext_run_next(hnd, run);
+            if(e == CST_OK){
+                prio_queue_insert(heap, run);
+            } else if(e == CST_EMPTY){
+                e = CST_OK;
+            }
+            // The head moved on, on an error the item is still the run's head and is read again below.
+            if(e == CST_OK && hnd->serializer.release != NULL){
+                hnd->serializer.release(data);
+            }
+        }
+    }
+    if(e == CST_OK){
+        e = __ext_run_start(hnd, merged);
+        merged = NULL;
+    }
+
+    for(size_t i = 0; i < merging; i++){
+        struct ext_run* run = runs[i];
+        if(e == CST_OK){
+            __ext_run_close(run);
+            continue;
+        }
+        if(run->head != NULL && run->head_offset == offsets[i]){
+            // Still at the head it had before the merge.
+            prio_queue_insert(hnd->runs, run);
+            continue;
+        }
+        if(run->head != NULL && hnd->serializer.release != NULL){
+            hnd->serializer.release(run->head);
+        }
+        clearerr(run->file);
+        run->remaining = remaining[i] + 1;
+        if(fseek(run->file, offsets[i], SEEK_SET) != 0 || __ext_run_next(hnd, run) != CST_OK){
+            ext_printfln("Lost a run of %zu items", remaining[i] + 1);
+            hnd->count -= remaining[i] + 1;
+            __ext_run_close(run);
+            continue;
+        }
+        prio_queue_insert(hnd->runs, run);
+    }
+
+    if(merged != NULL){
+        __ext_run_close(merged);
+    }
+    prio_queue_free(heap);
+    return e;
+}
+
+// Writes the in memory buffer to disk as a sorted run.
+static cst_err __ext_spill(struct ext_prio_queue_handle* hnd){
+    if((size_t)prio_queue_size(hnd->runs) >= EXT_PRIO_QUEUE_MAX_RUNS){
+        cst_err e = __ext_merge_runs(hnd);
+        if(e != CST_OK){
+            return e;
+        }
+    }
+
+    struct ext_run* run = NULL;
+    cst_err e = __ext_run_open(hnd, &run);
+    if(e != CST_OK){
+        return e;
+    }
+
+    ext_printfln("Spilling %d items", prio_queue_size(hnd->buffer));
+    size_t spilled = 0;
+    while(e == CST_OK && prio_queue_remove(hnd->buffer, &hnd->spill[spilled]) == CST_OK){
+        e = __ext_run_write(hnd, run, hnd->spill[spilled]);
+        spilled++;
+    }
+    if(e == CST_OK){
+        e = __ext_run_start(hnd, run);
+    } else {
+        __ext_run_close(run);
+    }
+    if(e != CST_OK){
+        // Nothing is released until the whole run is on disk and readable, put everything back.
+        for(size_t i = 0; i < spilled; i++){
+            prio_queue_insert(hnd->buffer, hnd->spill[i]);
+        }
+        return e;
+    }
+
+    if(hnd->serializer.release != NULL){
+        for(size_t i = 0; i < spilled; i++){
+            hnd->serializer.release(hnd->spill[i]);
+        }
+    }
+    return CST_OK;
+}
+
+cst_err ext_prio_queue_init(struct ext_prio_queue_handle** hnd, const char* dir, size_t buffer_items,
+                            int (comparator)(void* c1, void* c2),
+                            const struct ext_prio_queue_serializer* serializer){
+    if(buffer_items == 0 || serializer == NULL || serializer->serialize == NULL ||
+       serializer->deserialize == NULL){
+        ext_printfln("Bad Params");
+        *hnd = NULL;
+        return CST_PARAM_ERR;
+    }
+
+    *hnd = EXT_ALLOC(sizeof(struct ext_prio_queue_handle));
+    if(*hnd == NULL){
+        ext_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    if(dir == NULL){
+        dir = P_tmpdir;
+    }
+    (*hnd)->dir = EXT_ALLOC(strlen(dir) + 1);
+    if((*hnd)->dir == NULL){
+        EXT_FREE(*hnd);
+        *hnd = NULL;
+        return CST_MEM_ERR;
+    }
+    strcpy((*hnd)->dir, dir);
+
+    if(prio_queue_init(&(*hnd)->buffer, buffer_items, comparator) != CST_OK){
+        EXT_FREE((*hnd)->dir);
+        EXT_FREE(*hnd);
+        *hnd = NULL;
+        return CST_FAIL;
+    }
+    // One extra slot, a spill adds its run before the merge limit is checked again.
+    if(prio_queue_init(&(*hnd)->runs, EXT_PRIO_QUEUE_MAX_RUNS + 1, &__ext_run_compare) != CST_OK){
+        prio_queue_free((*hnd)->buffer);
+        EXT_FREE((*hnd)->dir);
+        EXT_FREE(*hnd);
+        *hnd = NULL;
+        return CST_FAIL;
+    }
+    (*hnd)->spill = EXT_ALLOC(sizeof(void*) * buffer_items);
+    if((*hnd)->spill == NULL){
+        prio_queue_free((*hnd)->runs);
+        prio_queue_free((*hnd)->buffer);
+        EXT_FREE((*hnd)->dir);
+        EXT_FREE(*hnd);
+        *hnd = NULL;
+        return CST_FAIL;
+    }
+
+    (*hnd)->buffer_items = buffer_items;
+    (*hnd)->count = 0;
+    (*hnd)->comparator = comparator;
+    (*hnd)->serializer = *serializer;
+    (*hnd)->scratch = NULL;
+    (*hnd)->scratch_cap = 0;
+
+    return CST_OK;
+}
+
+void ext_prio_queue_free(struct ext_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        ext_printfln("Null Handle")
+        return;
+    }
+
+    void* top = NULL;
+    while(prio_queue_remove(hnd->runs, &top) == CST_OK){
+        struct ext_run* run = top;
+        if(hnd->serializer.release != NULL){
+            hnd->serializer.release(run->head);
+        }
+        __ext_run_close(run);
+    }
+    prio_queue_free(hnd->runs);
+    prio_queue_free(hnd->buffer);
+    EXT_FREE(hnd->spill);
+    EXT_FREE(hnd->scratch);
+    EXT_FREE(hnd->dir);
+    EXT_FREE(hnd);
+}
+
+cst_err ext_prio_queue_insert(struct ext_prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        ext_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if((size_t)prio_queue_size(hnd->buffer) >= hnd->buffer_items){
+        cst_err e = __ext_spill(hnd);
+        if(e != CST_OK){
+            return e;
+        }
+    }
+
+    cst_err e = prio_queue_insert(hnd->buffer, data);
+    if(e != CST_OK){
+        return e;
+    }
+    hnd->count++;
+    return CST_OK;
+}
+
+cst_err ext_prio_queue_remove(struct ext_prio_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        ext_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->count == 0){
+        // Nothing to remove
+        return CST_EMPTY;
+    }
+
+    void* buffered = NULL;
+    void* top = NULL;
+    int have_buffered = prio_queue_peek(hnd->buffer, &buffered) == CST_OK;
+    int have_run = prio_queue_peek(hnd->runs, &top) == CST_OK;
+
+    cst_err e;
+    if(have_buffered && (!have_run || hnd->comparator(buffered, ((struct ext_run*)top)->head) <= 0)){
+        e = prio_queue_remove(hnd->buffer, data);
+    } else {
+        e = __ext_run_pop(hnd, data);
+    }
+    if(e != CST_OK){
+        return e;
+    }
+
+    hnd->count--;
+    return CST_OK;
+}
+
+size_t ext_prio_queue_size(struct ext_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        ext_printfln("Null Handle")
+        return 0;
+    }
+
+    return hnd->count;
+}
+
+size_t ext_prio_queue_runs(struct ext_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        ext_printfln("Null Handle")
+        return 0;
+    }
+
+    return (size_t)prio_queue_size(hnd->runs);
+}
@@ -0,0 +1,223 @@
+/*
+ * K-Way Merge Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/kway_merge.h"
+
+#define KWAY_MERGE_DEBUG 0
+
+#if KWAY_MERGE_DEBUG
+
+#include <stdio.h>
+
+#define kway_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define kway_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define kway_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define kway_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include "stdlib.h"
+
+#define KWAY_ALLOC(x) malloc(x);
+#define KWAY_FREE(x) free(x);
+
+struct kway_source{
+    void* ctx;
+    void** items;   // The current batch, items[pos] is the head.
+    size_t pos;
+    size_t len;     // 0 once the source is exhausted.
+};
+
+struct kway_merge_handle{
+    struct kway_source* sources;
+    size_t* tree;   // tree[0] is the winner, tree[1] to tree[k - 1] the losers of the internal nodes.
+    size_t k;
+    size_t active;
+    void** batches;
+    size_t (*pull)(void* ctx, void** items, size_t cap);
+    int (*comparator)(void* c1, void* c2);
+};
+
+static void __kway_refill(struct kway_merge_handle* hnd, struct kway_source* source){
+    source->pos = 0;
+    source->len = hnd->pull(source->ctx, source->items, KWAY_MERGE_BATCH);
+    if(source->len > KWAY_MERGE_BATCH){
+        source->len = KWAY_MERGE_BATCH;
+    }
+    if(source->len == 0){
+        hnd->active--;
+    }
+}
+
+// True if source a goes before source b, exhausted sources go last and ties go to the lower index.
+static inline int __kway_beats(struct kway_merge_handle* hnd, size_t a, size_t b){
+    struct kway_source* sa = &hnd->sources[a];
+    struct kway_source* sb = &hnd->sources[b];
+    if(sa->len == 0){
+        return 0;
+    }
+    if(sb->len == 0){
+        return 1;
+    }
+    int cmp = hnd->comparator(sa->items[sa->pos], sb->items[sb->pos]);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+// Plays the matches on the path from the leaf of source up to the root.
+static inline void __kway_replay(struct kway_merge_handle* hnd, size_t source){
+    size_t winner = source;
+    for(size_t node = (hnd->k + source) / 2; node > 0; node /= 2){
+        if(__kway_beats(hnd, hnd->tree[node], winner)){
+            size_t loser = winner;
+            winner = hnd->tree[node];
+            hnd->tree[node] = loser;
+        }
+    }
+    hnd->tree[0] = winner;
+}
+
+cst_err kway_merge_init(struct kway_merge_handle** hnd, size_t sources, void** contexts,
+                        size_t (pull)(void* ctx, void** items, size_t cap), int (comparator)(void* c1, void* c2)){
+    *hnd = NULL;
+    if((contexts == NULL && sources > 0) || pull == NULL || comparator == NULL){
+        kway_printfln("Bad Params");
+        return CST_PARAM_ERR;
+    }
+
+    *hnd = KWAY_ALLOC(sizeof(struct kway_merge_handle))
+    if(*hnd == NULL){
+        kway_printfln("Alloc Error");
+        return CST_MEM_ERR;
+    }
+    (*hnd)->sources = NULL;
+    (*hnd)->tree = NULL;
+    (*hnd)->batches = NULL;
+    size_t k = sources > 0 ? sources : 1;
+    (*hnd)->sources = KWAY_ALLOC(sizeof(struct kway_source) * k);
+    (*hnd)->tree = KWAY_ALLOC(sizeof(size_t) * k);
+    (*hnd)->batches = KWAY_ALLOC(sizeof(void*) * KWAY_MERGE_BATCH * k);
+    if((*hnd)->sources == NULL || (*hnd)->tree == NULL || (*hnd)->batches == NULL){
+        kway_printfln("Alloc Error");
+        kway_merge_free(*hnd);
+        *hnd = NULL;
+        return CST_MEM_ERR;
+    }
+    (*hnd)->k = sources;
+    (*hnd)->active = sources;
+    (*hnd)->pull = pull;
+    (*hnd)->comparator = comparator;
+
+    for(size_t i = 0; i < sources; i++){
+        (*hnd)->sources[i].ctx = contexts[i];
+        (*hnd)->sources[i].items = (*hnd)->batches + i * KWAY_MERGE_BATCH;
+        __kway_refill(*hnd, &(*hnd)->sources[i]);
+    }
+
+    // Build the tree bottom up, leaf k + i is source i and node n plays the winners of nodes 2n and 2n + 1.
+    size_t* winners = KWAY_ALLOC(sizeof(size_t) * 2 * k);
+    if(winners == NULL){
+        kway_printfln("Alloc Error");
+        kway_merge_free(*hnd);
+        *hnd = NULL;
+        return CST_MEM_ERR;
+    }
+    for(size_t i = 0; i < sources; i++){
+        winners[sources + i] = i;
+    }
+    for(size_t node = sources - 1; node >= 1 && sources > 1; node--){
+        size_t left = winners[2 * node];
+        size_t right = winners[2 * node + 1];
+        if(__kway_beats(*hnd, right, left)){
+            winners[node] = right;
+            (*hnd)->tree[node] = left;
+        } else {
+            winners[node] = left;
+            (*hnd)->tree[node] = right;
+        }
+    }
+    (*hnd)->tree[0] = sources > 0 ? winners[1] : 0;
+    KWAY_FREE(winners);
+
+    return CST_OK;
+}
+
+void kway_merge_free(struct kway_merge_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        kway_printfln("Null Handle");
+        return;
+    }
+
+    KWAY_FREE(hnd->sources);
+    KWAY_FREE(hnd->tree);
+    KWAY_FREE(hnd->batches);
+    KWAY_FREE(hnd);
+}
+
+size_t kway_merge_next(struct kway_merge_handle* hnd, void** out, size_t cap){
+    // Safety check
+    if(hnd == NULL || out == NULL){
+        kway_printfln("Null Handle");
+        return 0;
+    }
+
+    size_t count = 0;
+    while(count < cap && hnd->active > 0){
+        size_t winner = hnd->tree[0];
+        struct kway_source* source = &hnd->sources[winner];
+        out[count++] = source->items[source->pos++];
+        if(source->pos == source->len){
+            __kway_refill(hnd, source);
+        }
+        __kway_replay(hnd, winner);
+    }
+    return count;
+}
+
+cst_err kway_merge_remove(struct kway_merge_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        kway_printfln("Null Handle");
+        return CST_FAIL;
+    }
+
+    if(kway_merge_next(hnd, data, 1) == 0){
+        return CST_EMPTY;
+    }
+    return CST_OK;
+}
+
+size_t kway_merge_active(struct kway_merge_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        kway_printfln("Null Handle");
+        return 0;
+    }
+
+    return hnd->active;
+}
@@ -0,0 +1,440 @@
+/*
+ * Persistent Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/mmap_prio_queue.h"
+
+#define MMAP_PRIO_QUEUE_DEBUG 0
+
+#if MMAP_PRIO_QUEUE_DEBUG
+
+#include <stdio.h>
+
+#define mmap_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define mmap_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define mmap_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define mmap_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "stdlib.h"
+
+#define MMAP_ALLOC(x) malloc(x);
+#define MMAP_FREE(x) free(x);
+
+#define MMAP_PQ_MAGIC "CSTPQMAP"
+#define MMAP_PQ_VERSION 1
+
+// Keys are read in place, so records are padded to keep them aligned.
+#define MMAP_PQ_RECORD_SIZE(payload) ((sizeof(uint64_t) + (payload) + 7) & ~(size_t)7)
+
+#define MMAP_PQ_RECORD(hnd, i) ((hnd)->records + (size_t)(i) * (hnd)->record_size)
+#define MMAP_PQ_KEY(hnd, i) (*(uint64_t*)MMAP_PQ_RECORD(hnd, i))
+
+struct mmap_pq_header{
+    char magic[8];
+    uint32_t version;
+    uint32_t payload_size;
+    uint64_t max_size;
+    uint64_t count;
+    uint32_t clean;
+    uint32_t reserved;
+    uint64_t padding[3];
+};
+
+struct mmap_prio_queue_handle{
+    int fd;
+    unsigned char* map;
+    size_t map_len;
+    struct mmap_pq_header* header;
+    unsigned char* records;
+    size_t payload_size;
+    size_t record_size;
+    size_t checkpoint_ops;
+    size_t ops;
+    unsigned char* tmp;
+};
+
+static size_t __mmap_file_size(size_t record_size, size_t max_size){
+    return sizeof(struct mmap_pq_header) + record_size * max_size;
+}
+
+static cst_err __mmap_map(struct mmap_prio_queue_handle* hnd, size_t len){
+    void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, hnd->fd, 0);
+    if(map == MAP_FAILED){
+        mmap_printfln("Map Failed");
+        return CST_IO_ERR;
+    }
+    hnd->map = map;
+    hnd->map_len = len;
+    hnd->header = map;
+    hnd->records = hnd->map + sizeof(struct mmap_pq_header);
+    return CST_OK;
+}
+
+// The dirty header has to be on disk before any record changes, the kernel may write record pages back at any time
+// and a header still marked clean would make open trust them without checking.
+static cst_err __mmap_mark_dirty(struct mmap_prio_queue_handle* hnd){
+    if(hnd->header->clean){
+        hnd->header->clean = 0;
+        if(msync(hnd->map, sizeof(struct mmap_pq_header), MS_SYNC) != 0){
+            mmap_printfln("Sync Failed");
+            hnd->header->clean = 1;
+            return CST_IO_ERR;
+        }
+    }
+    return CST_OK;
+}
+
+static void __mmap_count_op(struct mmap_prio_queue_handle* hnd){
+    hnd->ops++;
+    if(hnd->checkpoint_ops != 0 && hnd->ops >= hnd->checkpoint_ops){
+        // A failed periodic checkpoint is reported by the next explicit one.
+        mmap_prio_queue_checkpoint(hnd);
+    }
+}
+
+// Moves the record in tmp up from the hole at index until its parent is not larger.
+static size_t __mmap_sift_up(struct mmap_prio_queue_handle* hnd, size_t index){
+    uint64_t key = *(uint64_t*)hnd->tmp;
+    while(index > 0){
+        size_t parent = (index - 1) / 2;
+        if(MMAP_PQ_KEY(hnd, parent) <= key){
+            break;
+        }
+        memcpy(MMAP_PQ_RECORD(hnd, index), MMAP_PQ_RECORD(hnd, parent), hnd->record_size);
+        index = parent;
+    }
+    memcpy(MMAP_PQ_RECORD(hnd, index), hnd->tmp, hnd->record_size);
+    return index;
+}
+
+// Moves the record in tmp down from the hole at index until no child is smaller.
+static size_t __mmap_sift_down(struct mmap_prio_queue_handle* hnd, size_t index){
+    uint64_t key = *(uint64_t*)hnd->tmp;
+    size_t count = (size_t)hnd->header->count;
+    while(1){
+        size_t child = 2 * index + 1;
+        if(child >= count){
+            break;
+        }
+        if(child + 1 < count && MMAP_PQ_KEY(hnd, child + 1) < MMAP_PQ_KEY(hnd, child)){
+            child++;
+        }
+        if(key <= MMAP_PQ_KEY(hnd, child)){
+            break;
+        }
+        memcpy(MMAP_PQ_RECORD(hnd, index), MMAP_PQ_RECORD(hnd, child), hnd->record_size);
+        index = child;
+    }
+    memcpy(MMAP_PQ_RECORD(hnd, index), hnd->tmp, hnd->record_size);
+    return index;
+}
+
+static int __mmap_is_heap(struct mmap_prio_queue_handle* hnd){
+    for(size_t i = 1; i < hnd->header->count; i++){
+        if(MMAP_PQ_KEY(hnd, (i - 1) / 2) > MMAP_PQ_KEY(hnd, i)){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void __mmap_heapify(struct mmap_prio_queue_handle* hnd){
+    size_t count = (size_t)hnd->header->count;
+    for(size_t i = count / 2; i-- > 0;){
+        memcpy(hnd->tmp, MMAP_PQ_RECORD(hnd, i), hnd->record_size);
+        __mmap_sift_down(hnd, i);
+    }
+}
+
+static cst_err __mmap_create(struct mmap_prio_queue_handle* hnd, size_t max_size){
+    size_t len = __mmap_file_size(hnd->record_size, max_size);
+    if(ftruncate(hnd->fd, (off_t)len) != 0){
+        mmap_printfln("Truncate Failed");
+        return CST_IO_ERR;
+    }
+    cst_err e = __mmap_map(hnd, len);
+    if(e != CST_OK){
+        return e;
+    }
+
+    memset(hnd->header, 0, sizeof(struct mmap_pq_header));
+    memcpy(hnd->header->magic, MMAP_PQ_MAGIC, sizeof(hnd->header->magic));
+    hnd->header->version = MMAP_PQ_VERSION;
+    hnd->header->payload_size = (uint32_t)hnd->payload_size;
+    hnd->header->max_size = max_size;
+    hnd->header->count = 0;
+    hnd->header->clean = 0;
+    return mmap_prio_queue_checkpoint(hnd);
+}
+
+static cst_err __mmap_load(struct mmap_prio_queue_handle* hnd, size_t file_len){
+    if(file_len < sizeof(struct mmap_pq_header)){
+        mmap_printfln("File too small");
+        return CST_FAIL;
+    }
+    cst_err e = __mmap_map(hnd, file_len);
+    if(e != CST_OK){
+        return e;
+    }
+
+    struct mmap_pq_header* header = hnd->header;
+    if(memcmp(header->magic, MMAP_PQ_MAGIC, sizeof(header->magic)) != 0 || header->version != MMAP_PQ_VERSION){
+        mmap_printfln("Not a queue file");
+        return CST_FAIL;
+    }
+    if(header->payload_size != hnd->payload_size){
+        mmap_printfln("Payload size mismatch");
+        return CST_FAIL;
+    }
+    if(header->max_size > (file_len - sizeof(struct mmap_pq_header)) / hnd->record_size ||
+       header->count > header->max_size){
+        mmap_printfln("Size mismatch");
+        return CST_FAIL;
+    }
+
+    if(!header->clean && !__mmap_is_heap(hnd)){
+        mmap_printfln("Not closed cleanly, rebuilding heap");
+        __mmap_heapify(hnd);
+    }
+    return CST_OK;
+}
+
+cst_err mmap_prio_queue_open(struct mmap_prio_queue_handle** hnd, const char* path, size_t payload_size,
+                             size_t max_size, size_t checkpoint_ops){
+    if(path == NULL || payload_size > UINT32_MAX){
+        mmap_printfln("Bad Params");
+        *hnd = NULL;
+        return CST_PARAM_ERR;
+    }
+
+    *hnd = MMAP_ALLOC(sizeof(struct mmap_prio_queue_handle));
+    if(*hnd == NULL){
+        mmap_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    (*hnd)->payload_size = payload_size;
+    (*hnd)->record_size = MMAP_PQ_RECORD_SIZE(payload_size);
+    (*hnd)->checkpoint_ops = checkpoint_ops;
+    (*hnd)->ops = 0;
+    (*hnd)->map = NULL;
+    (*hnd)->tmp = MMAP_ALLOC((*hnd)->record_size);
+    (*hnd)->fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    cst_err e = CST_OK;
+    struct stat st;
+    if((*hnd)->tmp == NULL){
+        e = CST_MEM_ERR;
+    } else if((*hnd)->fd < 0 || fstat((*hnd)->fd, &st) != 0){
+        e = CST_IO_ERR;
+    } else if(st.st_size == 0){
+        e = __mmap_create(*hnd, max_size);
+    } else {
+        e = __mmap_load(*hnd, (size_t)st.st_size);
+    }
+
+    if(e != CST_OK){
+        if((*hnd)->map != NULL){
+            munmap((*hnd)->map, (*hnd)->map_len);
+        }
+        if((*hnd)->fd >= 0){
+            close((*hnd)->fd);
+        }
+        MMAP_FREE((*hnd)->tmp);
+        MMAP_FREE(*hnd);
+        *hnd = NULL;
+    }
+    return e;
+}
+
+cst_err mmap_prio_queue_close(struct mmap_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    cst_err e = mmap_prio_queue_checkpoint(hnd);
+    munmap(hnd->map, hnd->map_len);
+    close(hnd->fd);
+    MMAP_FREE(hnd->tmp);
+    MMAP_FREE(hnd);
+    return e;
+}
+
+cst_err mmap_prio_queue_insert(struct mmap_prio_queue_handle* hnd, uint64_t key, const void* payload){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->header->count == hnd->header->max_size){
+        mmap_printfln("No Room");
+        return CST_OVERFLOW;
+    }
+
+    memset(hnd->tmp, 0, hnd->record_size);
+    memcpy(hnd->tmp, &key, sizeof(key));
+    if(payload != NULL){
+        memcpy(hnd->tmp + sizeof(key), payload, hnd->payload_size);
+    }
+
+    cst_err e = __mmap_mark_dirty(hnd);
+    if(e != CST_OK){
+        return e;
+    }
+    __mmap_sift_up(hnd, (size_t)hnd->header->count);
+    hnd->header->count++;
+    __mmap_count_op(hnd);
+    return CST_OK;
+}
+
+cst_err mmap_prio_queue_remove(struct mmap_prio_queue_handle* hnd, uint64_t* key, void* payload){
+    cst_err e = mmap_prio_queue_peek(hnd, key, payload);
+    if(e != CST_OK){
+        return e;
+    }
+
+    e = __mmap_mark_dirty(hnd);
+    if(e != CST_OK){
+        return e;
+    }
+    hnd->header->count--;
+    if(hnd->header->count > 0){
+        memcpy(hnd->tmp, MMAP_PQ_RECORD(hnd, hnd->header->count), hnd->record_size);
+        __mmap_sift_down(hnd, 0);
+    }
+    __mmap_count_op(hnd);
+    return CST_OK;
+}
+
+cst_err mmap_prio_queue_peek(struct mmap_prio_queue_handle* hnd, uint64_t* key, void* payload){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(hnd->header->count == 0){
+        // Nothing to look at
+        return CST_EMPTY;
+    }
+
+    *key = MMAP_PQ_KEY(hnd, 0);
+    if(payload != NULL){
+        memcpy(payload, MMAP_PQ_RECORD(hnd, 0) + sizeof(uint64_t), hnd->payload_size);
+    }
+    return CST_OK;
+}
+
+size_t mmap_prio_queue_size(struct mmap_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return 0;
+    }
+
+    return (size_t)hnd->header->count;
+}
+
+cst_err mmap_prio_queue_checkpoint(struct mmap_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    hnd->ops = 0;
+
+    // The records have to be on disk before the header claims they are consistent.
+    if(msync(hnd->map, hnd->map_len, MS_SYNC) != 0){
+        mmap_printfln("Sync Failed");
+        return CST_IO_ERR;
+    }
+    hnd->header->clean = 1;
+    if(msync(hnd->map, sizeof(struct mmap_pq_header), MS_SYNC) != 0){
+        mmap_printfln("Sync Failed");
+        return CST_IO_ERR;
+    }
+    return CST_OK;
+}
+
+#if MMAP_PRIO_QUEUE_RESIZE_ENABLED
+
+cst_err mmap_prio_queue_resize(struct mmap_prio_queue_handle* hnd, size_t new_size){
+    // Safety check
+    if(hnd == NULL){
+        mmap_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(new_size < hnd->header->count){
+        mmap_printfln("Contains too many items to shrink");
+        return CST_FAIL;
+    }
+
+    cst_err e = mmap_prio_queue_checkpoint(hnd);
+    if(e != CST_OK){
+        return e;
+    }
+
+    // The old mapping is only dropped once the new one exists, a failure leaves the handle as it was.
+    size_t len = __mmap_file_size(hnd->record_size, new_size);
+    unsigned char* old_map = hnd->map;
+    size_t old_len = hnd->map_len;
+    if(len > old_len && ftruncate(hnd->fd, (off_t)len) != 0){
+        mmap_printfln("Truncate Failed");
+        return CST_IO_ERR;
+    }
+    e = __mmap_map(hnd, len);
+    if(e != CST_OK){
+        if(len > old_len && ftruncate(hnd->fd, (off_t)old_len) != 0){
+            // The file stays longer than the header needs, which open accepts.
+            mmap_printfln("Truncate Failed");
+        }
+        return e;
+    }
+    munmap(old_map, old_len);
+    if(len < old_len && ftruncate(hnd->fd, (off_t)len) != 0){
+        // Only the mapping shrank, the records it covers are all the header will claim.
+        mmap_printfln("Truncate Failed");
+    }
+
+    hnd->header->clean = 0;
+    hnd->header->max_size = new_size;
+    return mmap_prio_queue_checkpoint(hnd);
+}
+
+#endif
@@ -42,118 +42,1584 @@
 
 #endif
 
+#include "../include/cstructures_crc.h"
+#include <stdint.h>
+#include <string.h>
 #include "stdlib.h"
 
+#if PRIO_QUEUE_TRACE_ENABLED
+#include <time.h>
+#endif
+
+#if PRIO_QUEUE_PARALLEL_ENABLED
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+#include <stdatomic.h>
+#endif
+
 #define PRIO_ALLOC(x) malloc(x);
 #define PRIO_FREE(x) free(x);
 
-struct prio_queue_handle{
+#define PRIO_SNAPSHOT_MAGIC "CSTPQSNP"
+#define PRIO_SNAPSHOT_VERSION 1
+#define PRIO_SNAPSHOT_BYTE_ORDER 0x01020304u
+#define PRIO_SNAPSHOT_BLOCK (4 << 20) /** Snapshots are written and read in blocks of this size. */
+#define PRIO_SNAPSHOT_INITIAL 4096    /** Restore starts with room for this many items and grows as they are read. */
+
+#define PRIO_PARALLEL_MIN_ITEMS 16384   /** Fewer items than this are built and sorted on the calling thread. */
+#define PRIO_PARALLEL_SUBTREES 4        /** Heapify subtrees per thread, evens out their unequal last levels. */
+#define PRIO_SORT_RUN 32                /** Runs of this length are insertion sorted before merging. */
+
+#define PRIO_KEYS_INITIAL 16            /** Slots of a key table the first time a key is added. */
+
+#define PRIO_CACHE_LINE 64
+
+struct prio_snapshot_header{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t count;
+    uint64_t reserved;
+};
+
+struct prio_snapshot_stream{
+    FILE* file;
+    unsigned char* block;
+    size_t len;
+    size_t pos;
+    size_t checked;
+    uint32_t crc;
+};
+
+// Counts items per key, a count of 0 marks a free slot.
+struct prio_key_slot{
+    uint64_t key;
+    size_t count;
+};
+
+// Linear probing, the capacity is a power of two.
+struct prio_key_table{
+    struct prio_key_slot* slots;
+    size_t capacity;
+    size_t used;
+};
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+
+// A slot is free for the producer claiming position p when sequence is p, and holds its item once sequence is p + 1.
+struct prio_ingress_slot{
+    atomic_size_t sequence;
+    void* data;
+};
+
+// Allocated on a cache line boundary, see __prio_ingress_alloc.
+struct prio_ingress{
+    atomic_size_t tail;     // Next position claimed by a producer.
+    char pad[PRIO_CACHE_LINE - sizeof(atomic_size_t)]; // Keeps the producers' line apart from the owner's.
+    size_t head;            // Next position the owner reads, only touched by the owner.
+    size_t mask;
+    struct prio_ingress_slot* slots;
+};
+
+#endif
+
+struct prio_queue_handle{
+    struct cbt_handle* cbt_hnd;
+    int (*comparator)(void* c1, void* c2);
+    uint64_t (*erase_key)(void* data);
+    struct prio_key_table tombstones;   // How many queued items with each key are dead.
+    struct prio_key_table live;         // How many items with each key are queued, kept from the first erase on.
+    size_t dead;                        // Erased items still in the heap.
+    double erase_fraction;
+#if PRIO_QUEUE_INGRESS_ENABLED
+    struct prio_ingress* ingress;
+#endif
+#if PRIO_QUEUE_STATS_ENABLED
+    struct prio_queue_stats stats;
+#endif
+#if PRIO_QUEUE_TRACE_ENABLED
+    void (*trace)(enum prio_queue_event event, void* data, uint64_t latency_ns, void* ctx);
+    void* trace_ctx;
+    uint32_t trace_rate;
+    uint32_t trace_tick;
+    struct prio_queue_latency latency[PRIO_QUEUE_EVENT_OVERFLOW]; // Overflows are not timed.
+#endif
+};
+
+#if PRIO_QUEUE_STATS_ENABLED
+
+#define PRIO_STAT_INC(hnd, field) ((hnd)->stats.field++)
+#define PRIO_STAT_DEPTH(hnd, depth) \
+    ((hnd)->stats.sift_depth[(depth) < PRIO_QUEUE_STATS_DEPTH_BUCKETS ? (depth) : PRIO_QUEUE_STATS_DEPTH_BUCKETS - 1]++)
+#define PRIO_STAT_HIGH_WATER(hnd) do{ \
+        uint64_t size = (uint64_t)cbt_size((hnd)->cbt_hnd); \
+        if(size > (hnd)->stats.size_high_water){ (hnd)->stats.size_high_water = size; } \
+    } while(0)
+
+#else
+
+#define PRIO_STAT_INC(hnd, field) ((void)0)
+#define PRIO_STAT_DEPTH(hnd, depth) ((void)0)
+#define PRIO_STAT_HIGH_WATER(hnd) ((void)0)
+
+#endif
+
+static inline int __prio_queue_compare(struct prio_queue_handle* hnd, void* c1, void* c2){
+    PRIO_STAT_INC(hnd, comparisons);
+    return hnd->comparator(c1, c2);
+}
+
+static cst_err __prio_queue_bubble_up(struct prio_queue_handle* hnd, struct cbt_node* node);
+
+static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct cbt_node* root);
+
+cst_err prio_queue_init(struct prio_queue_handle ** hnd, size_t max_size, int (comparator)(void* c1, void* c2)){
+    return prio_queue_init_allocator(hnd, max_size, comparator, NULL);
+}
+
+cst_err prio_queue_init_allocator(struct prio_queue_handle** hnd, size_t max_size, int (comparator)(void* c1, void* c2),
+                                  const struct cbt_allocator* allocator){
+    *hnd = PRIO_ALLOC(sizeof(struct prio_queue_handle));
+    if(*hnd == NULL){
+        prio_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    cst_err init_e = cbt_init_allocator(&((*hnd)->cbt_hnd), max_size, allocator);
+    if(init_e != CST_OK){
+        PRIO_FREE(*hnd);
+        *hnd = NULL;
+        return CST_FAIL;
+    }
+
+    (*hnd)->comparator = comparator;
+    (*hnd)->erase_key = NULL;
+    memset(&(*hnd)->tombstones, 0, sizeof((*hnd)->tombstones));
+    memset(&(*hnd)->live, 0, sizeof((*hnd)->live));
+    (*hnd)->dead = 0;
+    (*hnd)->erase_fraction = PRIO_QUEUE_ERASE_FRACTION;
+#if PRIO_QUEUE_INGRESS_ENABLED
+    (*hnd)->ingress = NULL;
+#endif
+#if PRIO_QUEUE_STATS_ENABLED
+    memset(&(*hnd)->stats, 0, sizeof((*hnd)->stats));
+#endif
+#if PRIO_QUEUE_TRACE_ENABLED
+    (*hnd)->trace = NULL;
+    (*hnd)->trace_ctx = NULL;
+    (*hnd)->trace_rate = 0;
+    (*hnd)->trace_tick = 0;
+    prio_queue_reset_latency(*hnd);
+#endif
+
+    return CST_OK;
+}
+
+void prio_queue_free(struct prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return;
+    }
+    cbt_free(hnd->cbt_hnd);
+    PRIO_FREE(hnd->tombstones.slots);
+    PRIO_FREE(hnd->live.slots);
+#if PRIO_QUEUE_INGRESS_ENABLED
+    if(hnd->ingress != NULL){
+        PRIO_FREE(hnd->ingress->slots);
+        PRIO_FREE(hnd->ingress);
+    }
+#endif
+    PRIO_FREE(hnd);
+}
+
+static inline uint64_t __prio_erase_key(struct prio_queue_handle* hnd, void* data){
+    return hnd->erase_key != NULL ? hnd->erase_key(data) : (uint64_t)(uintptr_t)data;
+}
+
+static inline size_t __prio_key_slot(uint64_t key, size_t mask){
+    // Pointers and small integers both hash poorly on their low bits, mix them in.
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key & mask;
+}
+
+static cst_err __prio_keys_add(struct prio_key_table* table, uint64_t key){
+    // Kept at most half full.
+    if((table->used + 1) * 2 > table->capacity){
+        size_t capacity = table->capacity ? table->capacity * 2 : PRIO_KEYS_INITIAL;
+        struct prio_key_slot* slots = calloc(capacity, sizeof(struct prio_key_slot));
+        if(slots == NULL){
+            prio_printfln("Alloc Failed");
+            return CST_MEM_ERR;
+        }
+        for(size_t i = 0; i < table->capacity; i++){
+            if(table->slots[i].count != 0){
+                size_t slot = __prio_key_slot(table->slots[i].key, capacity - 1);
+                while(slots[slot].count != 0){
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = table->slots[i];
+            }
+        }
+        PRIO_FREE(table->slots);
+        table->slots = slots;
+        table->capacity = capacity;
+    }
+
+    size_t mask = table->capacity - 1;
+    size_t slot = __prio_key_slot(key, mask);
+    while(table->slots[slot].count != 0 && table->slots[slot].key != key){
+        slot = (slot + 1) & mask;
+    }
+    if(table->slots[slot].count++ == 0){
+        table->slots[slot].key = key;
+        table->used++;
+    }
+    return CST_OK;
+}
+
+static size_t __prio_keys_count(struct prio_key_table* table, uint64_t key){
+    if(table->used == 0){
+        return 0;
+    }
+    size_t mask = table->capacity - 1;
+    size_t slot = __prio_key_slot(key, mask);
+    while(table->slots[slot].count != 0){
+        if(table->slots[slot].key == key){
+            return table->slots[slot].count;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return 0;
+}
+
+// Decrements the count of the key, returns 1 if it was there.
+static int __prio_keys_take(struct prio_key_table* table, uint64_t key){
+    if(table->used == 0){
+        return 0;
+    }
+    size_t mask = table->capacity - 1;
+    size_t slot = __prio_key_slot(key, mask);
+    while(table->slots[slot].count != 0){
+        if(table->slots[slot].key == key){
+            if(--table->slots[slot].count == 0){
+                // Backward shift deletion, moves later entries of the probe run into the gap.
+                table->used--;
+                size_t gap = slot;
+                size_t next = (gap + 1) & mask;
+                while(table->slots[next].count != 0){
+                    size_t home = __prio_key_slot(table->slots[next].key, mask);
+                    if(((next - home) & mask) >= ((next - gap) & mask)){
+                        table->slots[gap] = table->slots[next];
+                        table->slots[next].count = 0;
+                        gap = next;
+                    }
+                    next = (next + 1) & mask;
+                }
+            }
+            return 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return 0;
+}
+
+static void __prio_keys_clear(struct prio_key_table* table){
+    if(table->used != 0){
+        memset(table->slots, 0, sizeof(struct prio_key_slot) * table->capacity);
+    }
+    table->used = 0;
+}
+
+static void __prio_keys_free(struct prio_key_table* table){
+    PRIO_FREE(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+// Consumes one tombstone for the data's key, returns 1 if the data was erased.
+static int __prio_tombstone_take(struct prio_queue_handle* hnd, void* data){
+    if(!__prio_keys_take(&hnd->tombstones, __prio_erase_key(hnd, data))){
+        return 0;
+    }
+    hnd->dead--;
+    return 1;
+}
+
+static void __prio_tombstone_clear(struct prio_queue_handle* hnd){
+    __prio_keys_clear(&hnd->tombstones);
+    hnd->dead = 0;
+}
+
+// Whether erased items with the data's key are still in the heap. A tombstone cannot tell them from a new item with the
+// same key, which it would take instead whenever that one reached the top first.
+static inline int __prio_tombstone_pending(struct prio_queue_handle* hnd, void* data){
+    return hnd->dead != 0 && __prio_keys_count(&hnd->tombstones, __prio_erase_key(hnd, data)) != 0;
+}
+
+// Counts the queued items by key on the first erase, O(n). Afterwards every item entering or leaving the heap updates it.
+static cst_err __prio_live_build(struct prio_queue_handle* hnd){
+    int count = cbt_size(hnd->cbt_hnd);
+    for(int i = 0; i < count; i++){
+        if(__prio_keys_add(&hnd->live, __prio_erase_key(hnd, cbt_get_data(cbt_get_node(hnd->cbt_hnd, i)))) != CST_OK){
+            __prio_keys_free(&hnd->live);
+            return CST_MEM_ERR;
+        }
+    }
+    return CST_OK;
+}
+
+static inline void __prio_live_add(struct prio_queue_handle* hnd, void* data){
+    // Without memory for the key the counts are dropped, the next erase counts the heap again.
+    if(hnd->live.slots != NULL && __prio_keys_add(&hnd->live, __prio_erase_key(hnd, data)) != CST_OK){
+        __prio_keys_free(&hnd->live);
+    }
+}
+
+static inline void __prio_live_take(struct prio_queue_handle* hnd, void* data){
+    if(hnd->live.slots != NULL){
+        __prio_keys_take(&hnd->live, __prio_erase_key(hnd, data));
+    }
+}
+
+// Restores the heap property over the whole tree bottom up, O(n).
+static void __prio_queue_heapify(struct prio_queue_handle* hnd){
+    for(int i = cbt_size(hnd->cbt_hnd) / 2 - 1; i >= 0; i--){
+        __prio_queue_trickle_down(hnd, cbt_get_node(hnd->cbt_hnd, i));
+    }
+}
+
+// Drops every erased item and rebuilds the heap bottom up, O(n).
+static void __prio_queue_compact(struct prio_queue_handle* hnd){
+    int count = cbt_size(hnd->cbt_hnd);
+    int live = 0;
+    for(int i = 0; i < count; i++){
+        void* data = cbt_get_data(cbt_get_node(hnd->cbt_hnd, i));
+        if(hnd->dead == 0 || !__prio_tombstone_take(hnd, data)){
+            cbt_set_data(cbt_get_node(hnd->cbt_hnd, live++), data);
+        } else {
+            __prio_live_take(hnd, data);
+        }
+    }
+    void* tmp = NULL;
+    for(int i = live; i < count; i++){
+        cbt_remove(hnd->cbt_hnd, &tmp);
+    }
+    __prio_queue_heapify(hnd);
+    __prio_tombstone_clear(hnd);
+    PRIO_STAT_INC(hnd, compactions);
+}
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+
+// Moves at most one ring's worth of items into the heap, appending them first and restoring the heap afterwards.
+static size_t __prio_ingress_drain(struct prio_queue_handle* hnd){
+    struct prio_ingress* ring = hnd->ingress;
+    size_t total = 0;
+    int pending = 1;
+    while(pending){
+        int before = cbt_size(hnd->cbt_hnd);
+        size_t moved = 0;
+        pending = 0;
+        while(total + moved <= ring->mask){
+            struct prio_ingress_slot* slot = &ring->slots[ring->head & ring->mask];
+            if(atomic_load_explicit(&slot->sequence, memory_order_acquire) != ring->head + 1){
+                break;
+            }
+            // As on insert, the erased items with this key are compacted away before it joins them.
+            if(__prio_tombstone_pending(hnd, slot->data)){
+                pending = 1;
+                break;
+            }
+            // The slot is only handed back once the heap has taken the item.
+            if(cbt_insert(hnd->cbt_hnd, slot->data) == NULL){
+                break;
+            }
+            __prio_live_add(hnd, slot->data);
+            atomic_store_explicit(&slot->sequence, ring->head + ring->mask + 1, memory_order_release);
+            ring->head++;
+            moved++;
+        }
+
+        if(moved >= (size_t)before && moved != 0){
+            __prio_queue_heapify(hnd);
+        } else {
+            for(int i = before; i < before + (int)moved; i++){
+                __prio_queue_bubble_up(hnd, cbt_get_node(hnd->cbt_hnd, i));
+            }
+        }
+        total += moved;
+        if(pending){
+            __prio_queue_compact(hnd);
+        }
+    }
+    if(total == 0){
+        return 0;
+    }
+
+#if PRIO_QUEUE_STATS_ENABLED
+    hnd->stats.inserts += total;
+#endif
+    PRIO_STAT_HIGH_WATER(hnd);
+    return total;
+}
+
+#endif
+
+// Called before every operation of the owning thread which needs to see all items.
+static inline void __prio_ingress_poll(struct prio_queue_handle* hnd){
+#if PRIO_QUEUE_INGRESS_ENABLED
+    if(hnd->ingress != NULL){
+        __prio_ingress_drain(hnd);
+    }
+#else
+    (void)hnd;
+#endif
+}
+
+static inline cst_err __prio_queue_insert(struct prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    if(__prio_tombstone_pending(hnd, data)){
+        __prio_queue_compact(hnd);
+    }
+    struct cbt_node* new = cbt_insert(hnd->cbt_hnd, data);
+    if(!new){
+        prio_printfln("Insert Failed");
+        PRIO_STAT_INC(hnd, overflows);
+        return CST_OVERFLOW;
+    }
+    __prio_live_add(hnd, data);
+    if(__prio_queue_bubble_up(hnd, new) != CST_OK){
+        prio_printfln("Bubble Up Fail");
+        return CST_FAIL;
+    }
+    PRIO_STAT_INC(hnd, inserts);
+    PRIO_STAT_HIGH_WATER(hnd);
+    return CST_OK;
+}
+
+static inline cst_err __prio_queue_remove_top(struct prio_queue_handle* hnd, void** data){
+    struct cbt_node* root = cbt_get_root(hnd->cbt_hnd);
+    if(root == NULL){
+        // Nothing to remove
+        return CST_EMPTY;
+    }
+
+    *data = cbt_get_data(root);
+    void* tmp = NULL;
+    cbt_remove(hnd->cbt_hnd, &tmp);
+    if(tmp == NULL){
+        return CST_FAIL;
+    }
+    __prio_live_take(hnd, *data);
+
+    cbt_set_data(root, tmp);
+
+    if(__prio_queue_trickle_down(hnd, root) != CST_OK){
+        prio_printfln("Trickle Down Fail");
+        return CST_FAIL;
+    }
+    return CST_OK;
+}
+
+static inline cst_err __prio_queue_remove(struct prio_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    __prio_ingress_poll(hnd);
+    cst_err e = __prio_queue_remove_top(hnd, data);
+    // Erased items are only dropped once they reach the top.
+    while(e == CST_OK && hnd->dead != 0 && __prio_tombstone_take(hnd, *data)){
+        e = __prio_queue_remove_top(hnd, data);
+    }
+    if(e != CST_OK){
+        return e;
+    }
+
+    PRIO_STAT_INC(hnd, removes);
+    return CST_OK;
+}
+
+#if PRIO_QUEUE_TRACE_ENABLED
+
+static uint64_t __prio_trace_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int __prio_latency_bucket(uint64_t value){
+    if(value < (1ULL << PRIO_QUEUE_LATENCY_SUB_BITS)){
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    if(msb >= PRIO_QUEUE_LATENCY_MAX_BITS){
+        return PRIO_QUEUE_LATENCY_BUCKETS - 1;
+    }
+    int sub = (int)((value >> (msb - PRIO_QUEUE_LATENCY_SUB_BITS)) & ((1 << PRIO_QUEUE_LATENCY_SUB_BITS) - 1));
+    return ((msb - PRIO_QUEUE_LATENCY_SUB_BITS + 1) << PRIO_QUEUE_LATENCY_SUB_BITS) + sub;
+}
+
+static void __prio_latency_record(struct prio_queue_latency* latency, uint64_t value){
+    latency->buckets[__prio_latency_bucket(value)]++;
+    if(latency->count == 0 || value < latency->min){
+        latency->min = value;
+    }
+    if(value > latency->max){
+        latency->max = value;
+    }
+    latency->count++;
+}
+
+// Decides whether this operation is sampled, returns its start time or 0.
+static inline uint64_t __prio_trace_begin(struct prio_queue_handle* hnd){
+    if(++hnd->trace_tick < hnd->trace_rate){
+        return 0;
+    }
+    hnd->trace_tick = 0;
+    return __prio_trace_now();
+}
+
+static void __prio_trace_end(struct prio_queue_handle* hnd, enum prio_queue_event event, void* data, uint64_t start){
+    uint64_t latency = __prio_trace_now() - start;
+    __prio_latency_record(&hnd->latency[event], latency);
+    if(hnd->trace != NULL){
+        hnd->trace(event, data, latency, hnd->trace_ctx);
+    }
+}
+
+static cst_err __prio_queue_insert_traced(struct prio_queue_handle* hnd, void* data){
+    uint64_t start = __prio_trace_begin(hnd);
+    cst_err e = __prio_queue_insert(hnd, data);
+    if(e == CST_OVERFLOW){
+        if(hnd->trace != NULL){
+            hnd->trace(PRIO_QUEUE_EVENT_OVERFLOW, data, 0, hnd->trace_ctx);
+        }
+    } else if(start != 0){
+        __prio_trace_end(hnd, PRIO_QUEUE_EVENT_INSERT, data, start);
+    }
+    return e;
+}
+
+static cst_err __prio_queue_remove_traced(struct prio_queue_handle* hnd, void** data){
+    uint64_t start = __prio_trace_begin(hnd);
+    cst_err e = __prio_queue_remove(hnd, data);
+    if(start != 0 && e == CST_OK){
+        __prio_trace_end(hnd, PRIO_QUEUE_EVENT_REMOVE, *data, start);
+    }
+    return e;
+}
+
+#endif
+
+cst_err prio_queue_insert(struct prio_queue_handle* hnd, void* data){
+#if PRIO_QUEUE_TRACE_ENABLED
+    if(hnd != NULL && hnd->trace_rate != 0){
+        return __prio_queue_insert_traced(hnd, data);
+    }
+#endif
+    return __prio_queue_insert(hnd, data);
+}
+
+cst_err prio_queue_remove(struct prio_queue_handle* hnd, void** data){
+#if PRIO_QUEUE_TRACE_ENABLED
+    if(hnd != NULL && hnd->trace_rate != 0){
+        return __prio_queue_remove_traced(hnd, data);
+    }
+#endif
+    return __prio_queue_remove(hnd, data);
+}
+
+cst_err prio_queue_peek(struct prio_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    __prio_ingress_poll(hnd);
+    struct cbt_node* root = cbt_get_root(hnd->cbt_hnd);
+    while(root != NULL && hnd->dead != 0 && __prio_tombstone_take(hnd, cbt_get_data(root))){
+        void* dead = NULL;
+        __prio_queue_remove_top(hnd, &dead);
+        root = cbt_get_root(hnd->cbt_hnd);
+    }
+    if(root == NULL){
+        // Nothing to look at
+        return CST_EMPTY;
+    }
+
+    *data = cbt_get_data(root);
+    return CST_OK;
+}
+
+int prio_queue_size(struct prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    return cbt_size(hnd->cbt_hnd) - (int)hnd->dead;
+}
+
+cst_err prio_queue_set_erase(struct prio_queue_handle* hnd, uint64_t (key)(void* data), double fraction){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+    // Also rejects NaN.
+    if(!(fraction > 0 && fraction <= 1)){
+        return CST_PARAM_ERR;
+    }
+    if(hnd->dead != 0 && key != hnd->erase_key){
+        prio_printfln("Tombstones pending");
+        return CST_FAIL;
+    }
+    if(key != hnd->erase_key){
+        // Counted under the old key, the next erase counts again.
+        __prio_keys_free(&hnd->live);
+    }
+
+    hnd->erase_key = key;
+    hnd->erase_fraction = fraction;
+    return CST_OK;
+}
+
+cst_err prio_queue_erase_lazy(struct prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    __prio_ingress_poll(hnd);
+    int count = cbt_size(hnd->cbt_hnd);
+    if((size_t)count <= hnd->dead){
+        return CST_EMPTY;
+    }
+    if(hnd->live.slots == NULL && __prio_live_build(hnd) != CST_OK){
+        return CST_MEM_ERR;
+    }
+    // A tombstone without a queued item behind it would erase the next item inserted with the key.
+    uint64_t key = __prio_erase_key(hnd, data);
+    if(__prio_keys_count(&hnd->live, key) <= __prio_keys_count(&hnd->tombstones, key)){
+        prio_printfln("Not queued");
+        return CST_PARAM_ERR;
+    }
+    cst_err e = __prio_keys_add(&hnd->tombstones, key);
+    if(e != CST_OK){
+        return e;
+    }
+    hnd->dead++;
+    PRIO_STAT_INC(hnd, erases);
+
+    if((double)hnd->dead > hnd->erase_fraction * (double)count){
+        __prio_queue_compact(hnd);
+    }
+    return CST_OK;
+}
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+
+// The padding only separates tail from head if the ring starts on a line, which malloc does not promise.
+static struct prio_ingress* __prio_ingress_alloc(void){
+    void* mem = NULL;
+    size_t size = (sizeof(struct prio_ingress) + PRIO_CACHE_LINE - 1) / PRIO_CACHE_LINE * PRIO_CACHE_LINE;
+    if(posix_memalign(&mem, PRIO_CACHE_LINE, size) != 0){
+        return NULL;
+    }
+    return mem;
+}
+
+cst_err prio_queue_attach_ingress(struct prio_queue_handle* hnd, size_t capacity){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+    if(hnd->ingress != NULL){
+        prio_printfln("Ingress already attached");
+        return CST_FAIL;
+    }
+    if(capacity == 0 || capacity > ((size_t)1 << (sizeof(size_t) * 8 - 2))){
+        return CST_PARAM_ERR;
+    }
+
+    size_t slots = 1;
+    while(slots < capacity){
+        slots <<= 1;
+    }
+    struct prio_ingress* ring = __prio_ingress_alloc();
+    if(ring == NULL){
+        prio_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+    ring->slots = PRIO_ALLOC(sizeof(struct prio_ingress_slot) * slots);
+    if(ring->slots == NULL){
+        prio_printfln("Alloc Failed");
+        PRIO_FREE(ring);
+        return CST_MEM_ERR;
+    }
+    for(size_t i = 0; i < slots; i++){
+        atomic_init(&ring->slots[i].sequence, i);
+        ring->slots[i].data = NULL;
+    }
+    atomic_init(&ring->tail, 0);
+    ring->head = 0;
+    ring->mask = slots - 1;
+
+    hnd->ingress = ring;
+    return CST_OK;
+}
+
+cst_err prio_queue_push_ingress(struct prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL || hnd->ingress == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    struct prio_ingress* ring = hnd->ingress;
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    struct prio_ingress_slot* slot;
+    for(;;){
+        slot = &ring->slots[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if(diff == 0){
+            // Free for this position, claim it. On failure pos holds the current tail.
+            if(atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed,
+                                                     memory_order_relaxed)){
+                break;
+            }
+        } else if(diff < 0){
+            // Still holds the item from one lap ago, the owner has not drained it.
+            return CST_OVERFLOW;
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+    slot->data = data;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return CST_OK;
+}
+
+size_t prio_queue_drain_ingress(struct prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL || hnd->ingress == NULL){
+        return 0;
+    }
+    return __prio_ingress_drain(hnd);
+}
+
+#endif
+
+static cst_err __prio_snapshot_flush(struct prio_snapshot_stream* stream){
+    stream->crc = cst_crc32(stream->crc, stream->block, stream->len);
+    if(fwrite(stream->block, 1, stream->len, stream->file) != stream->len){
+        prio_printfln("Write Failed");
+        return CST_IO_ERR;
+    }
+    stream->len = 0;
+    return CST_OK;
+}
+
+static cst_err __prio_snapshot_put(struct prio_snapshot_stream* stream, const void* data, size_t len){
+    if(len > PRIO_SNAPSHOT_BLOCK - stream->len){
+        cst_err e = __prio_snapshot_flush(stream);
+        if(e != CST_OK){
+            return e;
+        }
+    }
+    if(len > PRIO_SNAPSHOT_BLOCK){
+        // Too large for a block, goes straight to the stream.
+        stream->crc = cst_crc32(stream->crc, data, len);
+        return fwrite(data, 1, len, stream->file) == len ? CST_OK : CST_IO_ERR;
+    }
+    memcpy(stream->block + stream->len, data, len);
+    stream->len += len;
+    return CST_OK;
+}
+
+// Serializes an item straight into the block, only items larger than a block go through a scratch buffer.
+static cst_err __prio_snapshot_put_item(struct prio_snapshot_stream* stream, void* data,
+                                        size_t (serialize)(void* data, void* buf, size_t cap)){
+    uint32_t len32 = 0;
+    size_t room = PRIO_SNAPSHOT_BLOCK - stream->len;
+    if(room > sizeof(len32)){
+        size_t len = serialize(data, stream->block + stream->len + sizeof(len32), room - sizeof(len32));
+        if(len <= room - sizeof(len32)){
+            len32 = (uint32_t)len;
+            memcpy(stream->block + stream->len, &len32, sizeof(len32));
+            stream->len += sizeof(len32) + len;
+            return CST_OK;
+        }
+    }
+
+    // Did not fit the rest of the block, start a new one.
+    cst_err e = __prio_snapshot_flush(stream);
+    if(e != CST_OK){
+        return e;
+    }
+    size_t len = serialize(data, stream->block + sizeof(len32), PRIO_SNAPSHOT_BLOCK - sizeof(len32));
+    if(len > UINT32_MAX){
+        return CST_PARAM_ERR;
+    }
+    len32 = (uint32_t)len;
+    if(len <= PRIO_SNAPSHOT_BLOCK - sizeof(len32)){
+        memcpy(stream->block, &len32, sizeof(len32));
+        stream->len = sizeof(len32) + len;
+        return CST_OK;
+    }
+
+    unsigned char* scratch = PRIO_ALLOC(len);
+    if(scratch == NULL){
+        return CST_MEM_ERR;
+    }
+    serialize(data, scratch, len);
+    e = __prio_snapshot_put(stream, &len32, sizeof(len32));
+    if(e == CST_OK){
+        e = __prio_snapshot_put(stream, scratch, len);
+    }
+    PRIO_FREE(scratch);
+    return e;
+}
+
+// Adds everything consumed from the block so far to the checksum.
+static void __prio_snapshot_check(struct prio_snapshot_stream* stream){
+    stream->crc = cst_crc32(stream->crc, stream->block + stream->checked, stream->pos - stream->checked);
+    stream->checked = stream->pos;
+}
+
+// Makes len bytes available at the read position, refilling the block from the stream as needed.
+static cst_err __prio_snapshot_fill(struct prio_snapshot_stream* stream, size_t len){
+    if(stream->len - stream->pos >= len){
+        return CST_OK;
+    }
+    __prio_snapshot_check(stream);
+    stream->checked = 0;
+    memmove(stream->block, stream->block + stream->pos, stream->len - stream->pos);
+    stream->len -= stream->pos;
+    stream->pos = 0;
+    stream->len += fread(stream->block + stream->len, 1, PRIO_SNAPSHOT_BLOCK - stream->len, stream->file);
+    if(stream->len < len){
+        prio_printfln("Read Failed");
+        return CST_IO_ERR;
+    }
+    return CST_OK;
+}
+
+// Reads len bytes, they are checksummed once the block moves on.
+static cst_err __prio_snapshot_get(struct prio_snapshot_stream* stream, void* data, size_t len){
+    unsigned char* out = data;
+    while(len > 0){
+        size_t chunk = len < PRIO_SNAPSHOT_BLOCK ? len : PRIO_SNAPSHOT_BLOCK;
+        cst_err e = __prio_snapshot_fill(stream, chunk);
+        if(e != CST_OK){
+            return e;
+        }
+        memcpy(out, stream->block + stream->pos, chunk);
+        stream->pos += chunk;
+        out += chunk;
+        len -= chunk;
+    }
+    return CST_OK;
+}
+
+cst_err prio_queue_snapshot(struct prio_queue_handle* hnd, FILE* file,
+                            size_t (serialize)(void* data, void* buf, size_t cap)){
+    // Safety check
+    if(hnd == NULL || file == NULL || serialize == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    struct prio_snapshot_stream stream = { file, NULL, 0, 0, 0, 0 };
+    stream.block = PRIO_ALLOC(PRIO_SNAPSHOT_BLOCK);
+    if(stream.block == NULL){
+        return CST_MEM_ERR;
+    }
+
+    // Only live items are written.
+    __prio_ingress_poll(hnd);
+    if(hnd->dead != 0){
+        __prio_queue_compact(hnd);
+    }
+    int count = cbt_size(hnd->cbt_hnd);
+    struct prio_snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PRIO_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = PRIO_SNAPSHOT_VERSION;
+    header.byte_order = PRIO_SNAPSHOT_BYTE_ORDER;
+    header.count = (uint64_t)count;
+
+    cst_err e = __prio_snapshot_put(&stream, &header, sizeof(header));
+    for(int i = 0; i < count && e == CST_OK; i++){
+        e = __prio_snapshot_put_item(&stream, cbt_get_data(cbt_get_node(hnd->cbt_hnd, i)), serialize);
+    }
+    if(e == CST_OK){
+        e = __prio_snapshot_flush(&stream);
+    }
+    if(e == CST_OK){
+        // The checksum covers everything before it.
+        uint32_t crc = stream.crc;
+        if(fwrite(&crc, sizeof(crc), 1, file) != 1 || fflush(file) != 0){
+            e = CST_IO_ERR;
+        }
+    }
+
+    PRIO_FREE(stream.block);
+    return e;
+}
+
+cst_err prio_queue_restore(struct prio_queue_handle** hnd, FILE* file, int (comparator)(void* c1, void* c2),
+                           void* (deserialize)(const void* buf, size_t len), void (release)(void* data)){
+    *hnd = NULL;
+    if(file == NULL || deserialize == NULL){
+        prio_printfln("Bad Params");
+        return CST_PARAM_ERR;
+    }
+
+    struct prio_snapshot_stream stream = { file, NULL, 0, 0, 0, 0 };
+    stream.block = PRIO_ALLOC(PRIO_SNAPSHOT_BLOCK);
+    if(stream.block == NULL){
+        return CST_MEM_ERR;
+    }
+    unsigned char* scratch = NULL;
+
+    struct prio_snapshot_header header;
+    cst_err e = __prio_snapshot_get(&stream, &header, sizeof(header));
+    if(e == CST_OK && (memcmp(header.magic, PRIO_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+                       header.version != PRIO_SNAPSHOT_VERSION || header.byte_order != PRIO_SNAPSHOT_BYTE_ORDER ||
+                       header.count > INT32_MAX)){
+        prio_printfln("Not a snapshot");
+        e = CST_FAIL;
+    }
+    // The count is not verified before the checksum, a corrupt one must not size the heap up front.
+    size_t capacity = header.count > 0 ? (size_t)header.count : 1;
+#if PRIO_QUEUE_RESIZE_ENABLED
+    capacity = capacity < PRIO_SNAPSHOT_INITIAL ? capacity : PRIO_SNAPSHOT_INITIAL;
+#endif
+    if(e == CST_OK){
+        e = prio_queue_init(hnd, capacity, comparator);
+    }
+
+    for(uint64_t i = 0; i < header.count && e == CST_OK; i++){
+        uint32_t len = 0;
+        e = __prio_snapshot_get(&stream, &len, sizeof(len));
+        if(e != CST_OK){
+            break;
+        }
+
+        void* data = NULL;
+        if(len <= PRIO_SNAPSHOT_BLOCK){
+            // Deserialize in place when the item is in the block.
+            e = __prio_snapshot_fill(&stream, len);
+            if(e != CST_OK){
+                break;
+            }
+            data = deserialize(stream.block + stream.pos, len);
+            stream.pos += len;
+        } else {
+            PRIO_FREE(scratch);
+            scratch = PRIO_ALLOC(len);
+            if(scratch == NULL){
+                e = CST_MEM_ERR;
+                break;
+            }
+            e = __prio_snapshot_get(&stream, scratch, len);
+            if(e != CST_OK){
+                break;
+            }
+            data = deserialize(scratch, len);
+        }
+
+        if(data == NULL){
+            e = CST_MEM_ERR;
+            break;
+        }
+#if PRIO_QUEUE_RESIZE_ENABLED
+        if(i == capacity){
+            capacity = capacity * 2 < header.count ? capacity * 2 : (size_t)header.count;
+            e = cbt_resize((*hnd)->cbt_hnd, capacity);
+        }
+#endif
+        // Already in heap order, append without bubbling up.
+        if(e != CST_OK || cbt_insert((*hnd)->cbt_hnd, data) == NULL){
+            if(release != NULL){
+                release(data);
+            }
+            e = e != CST_OK ? e : CST_MEM_ERR;
+        }
+    }
+
+    if(e == CST_OK){
+        __prio_snapshot_check(&stream);
+        uint32_t crc = stream.crc;
+        uint32_t expected = 0;
+        e = __prio_snapshot_get(&stream, &expected, sizeof(expected));
+        if(e == CST_OK && crc != expected){
+            prio_printfln("Checksum mismatch");
+            e = CST_FAIL;
+        }
+    }
+
+    // Hand back what was read beyond the snapshot, only possible on seekable streams.
+    if(stream.len > stream.pos){
+        fseek(file, -(long)(stream.len - stream.pos), SEEK_CUR);
+    }
+
+    if(e == CST_OK){
+        PRIO_STAT_HIGH_WATER(*hnd);
+    }
+
+    if(e != CST_OK && *hnd != NULL){
+        void* data = NULL;
+        while(release != NULL && cbt_remove((*hnd)->cbt_hnd, &data) == CST_OK){
+            release(data);
+        }
+        prio_queue_free(*hnd);
+        *hnd = NULL;
+    }
+
+    PRIO_FREE(scratch);
+    PRIO_FREE(stream.block);
+    return e;
+}
+
+#if PRIO_QUEUE_PARALLEL_ENABLED
+
+struct prio_parallel_task{
+    uint64_t (*fn)(void* arg, unsigned int id, unsigned int count);
+    void* arg;
+    unsigned int id;
+    unsigned int count;
+    uint64_t comparisons;
+};
+
+struct prio_build_job{
+    void** items;
+    size_t count;
+    size_t first_root;      // The subtree roots are first_root to 2 * first_root.
+    int (*comparator)(void* c1, void* c2);
+};
+
+struct prio_drain_job{
     struct cbt_handle* cbt_hnd;
+    void** out;
+    void** tmp;
+    size_t count;
     int (*comparator)(void* c1, void* c2);
+    size_t* bounds;         // Sorted runs, run i is bounds[i] to bounds[i + 1].
+    unsigned int runs;
+    unsigned int parts;     // Threads sharing one merge.
+    void** src;
+    void** dst;
 };
 
-static cst_err __prio_queue_bubble_up(struct prio_queue_handle* hnd, struct cbt_node* node);
+static unsigned int __prio_parallel_threads(unsigned int threads){
+    if(threads == 0){
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned int)online : 1;
+    }
+    return threads;
+}
 
-static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct cbt_node* root);
+static void* __prio_parallel_worker(void* arg){
+    struct prio_parallel_task* task = arg;
+    task->comparisons = task->fn(task->arg, task->id, task->count);
+    return NULL;
+}
 
-cst_err prio_queue_init(struct prio_queue_handle ** hnd, size_t max_size, int (comparator)(void* c1, void* c2)){
-    *hnd = PRIO_ALLOC(sizeof(struct prio_queue_handle));
-    if(*hnd == NULL){
-        prio_printfln("Alloc Failed");
+// Runs fn(arg, id, count) for every id below count, the calling thread takes id 0. The comparisons returned by fn
+// are added up.
+static cst_err __prio_parallel_run(uint64_t (fn)(void* arg, unsigned int id, unsigned int count), void* arg,
+                                   unsigned int count, uint64_t* comparisons){
+    pthread_t* threads = PRIO_ALLOC(sizeof(pthread_t) * count);
+    struct prio_parallel_task* tasks = PRIO_ALLOC(sizeof(struct prio_parallel_task) * count);
+    int* started = PRIO_ALLOC(sizeof(int) * count);
+    if(threads == NULL || tasks == NULL || started == NULL){
+        PRIO_FREE(threads);
+        PRIO_FREE(tasks);
+        PRIO_FREE(started);
         return CST_MEM_ERR;
     }
 
-    cst_err init_e = cbt_init(&((*hnd)->cbt_hnd), max_size);
-    if(init_e != CST_OK){
-        PRIO_FREE(*hnd);
-        *hnd = NULL;
-        return CST_FAIL;
+    for(unsigned int id = 0; id < count; id++){
+        tasks[id].fn = fn;
+        tasks[id].arg = arg;
+        tasks[id].id = id;
+        tasks[id].count = count;
+        // A thread which could not be started has its share run by the calling thread.
+        started[id] = id > 0 && pthread_create(&threads[id], NULL, &__prio_parallel_worker, &tasks[id]) == 0;
+    }
+    for(unsigned int id = 0; id < count; id++){
+        if(!started[id]){
+            tasks[id].comparisons = fn(arg, id, count);
+        }
+    }
+    for(unsigned int id = 0; id < count; id++){
+        if(started[id]){
+            pthread_join(threads[id], NULL);
+        }
+        *comparisons += tasks[id].comparisons;
     }
 
-    (*hnd)->comparator = comparator;
+    PRIO_FREE(threads);
+    PRIO_FREE(tasks);
+    PRIO_FREE(started);
+    return CST_OK;
+}
+
+static uint64_t __prio_sift_down(void** items, size_t index, size_t count, int (comparator)(void* c1, void* c2)){
+    void* item = items[index];
+    uint64_t comparisons = 0;
+    for(;;){
+        size_t child = 2 * index + 1;
+        if(child >= count){
+            break;
+        }
+        if(child + 1 < count){
+            comparisons++;
+            if(comparator(items[child + 1], items[child]) < 0){
+                child++;
+            }
+        }
+        comparisons++;
+        if(comparator(items[child], item) >= 0){
+            break;
+        }
+        items[index] = items[child];
+        index = child;
+    }
+    items[index] = item;
+    return comparisons;
+}
+
+// Heapifies the subtree below root level by level from the bottom, each level is a contiguous range of the array.
+static uint64_t __prio_heapify_subtree(void** items, size_t root, size_t count, int (comparator)(void* c1, void* c2)){
+    uint64_t comparisons = 0;
+    size_t width = 1;
+    size_t start = root;
+    while(start * 2 + 1 < count){
+        start = start * 2 + 1;
+        width *= 2;
+    }
+    while(width > 0){
+        size_t end = start + width < count ? start + width : count;
+        for(size_t i = end; i > start; i--){
+            comparisons += __prio_sift_down(items, i - 1, count, comparator);
+        }
+        start = (start - 1) / 2;
+        width /= 2;
+    }
+    return comparisons;
+}
+
+static uint64_t __prio_build_worker(void* arg, unsigned int id, unsigned int count){
+    struct prio_build_job* job = arg;
+    uint64_t comparisons = 0;
+    for(size_t root = job->first_root + id; root <= 2 * job->first_root && root < job->count; root += count){
+        comparisons += __prio_heapify_subtree(job->items, root, job->count, job->comparator);
+    }
+    return comparisons;
+}
+
+cst_err prio_queue_build_parallel(struct prio_queue_handle** hnd, void** items, size_t count, size_t max_size,
+                                  int (comparator)(void* c1, void* c2), unsigned int threads){
+    *hnd = NULL;
+    if((items == NULL && count > 0) || comparator == NULL || count > INT32_MAX){
+        prio_printfln("Bad Params");
+        return CST_PARAM_ERR;
+    }
+    if(max_size < count){
+        max_size = count;
+    }
+
+    cst_err e = prio_queue_init(hnd, max_size > 0 ? max_size : 1, comparator);
+    if(e != CST_OK){
+        return e;
+    }
+
+    uint64_t comparisons = 0;
+    struct prio_build_job job;
+    memset(&job, 0, sizeof(job));
+    job.items = items;
+    job.count = count;
+    job.comparator = comparator;
+
+    // The subtrees hang off the first level with PRIO_PARALLEL_SUBTREES nodes per thread.
+    threads = __prio_parallel_threads(threads);
+    size_t level = 0;
+    if(threads > 1 && count >= PRIO_PARALLEL_MIN_ITEMS){
+        level = 1;
+        while(level < (size_t)threads * PRIO_PARALLEL_SUBTREES && level * 4 < count){
+            level *= 2;
+        }
+        job.first_root = level - 1;
+        e = __prio_parallel_run(&__prio_build_worker, &job, threads, &comparisons);
+    }
+
+    // The levels above the subtrees, or everything when not worth a thread.
+    size_t top = level > 0 ? level - 1 : count / 2;
+    for(size_t i = top; i > 0 && e == CST_OK; i--){
+        comparisons += __prio_sift_down(items, i - 1, count, comparator);
+    }
+
+    for(size_t i = 0; i < count && e == CST_OK; i++){
+        cbt_insert((*hnd)->cbt_hnd, items[i]);
+    }
+
+    if(e != CST_OK){
+        prio_queue_free(*hnd);
+        *hnd = NULL;
+        return e;
+    }
 
+#if PRIO_QUEUE_STATS_ENABLED
+    (*hnd)->stats.comparisons += comparisons;
+    (*hnd)->stats.inserts += count;
+#endif
+    (void)comparisons;
+    PRIO_STAT_HIGH_WATER(*hnd);
     return CST_OK;
 }
 
-void prio_queue_free(struct prio_queue_handle* hnd){
-    // Safety check
-    if(hnd == NULL){
-        prio_printfln("Null Handle")
-        return;
+static uint64_t __prio_merge(void** a, size_t a_len, void** b, size_t b_len, void** out,
+                             int (comparator)(void* c1, void* c2)){
+    uint64_t comparisons = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while(i < a_len && j < b_len){
+        comparisons++;
+        // Ties are taken from a, which holds the earlier part of the array.
+        if(comparator(b[j], a[i]) < 0){
+            *out++ = b[j++];
+        } else {
+            *out++ = a[i++];
+        }
     }
-    cbt_free(hnd->cbt_hnd);
-    PRIO_FREE(hnd);
+    memcpy(out, a + i, (a_len - i) * sizeof(void*));
+    memcpy(out + (a_len - i), b + j, (b_len - j) * sizeof(void*));
+    return comparisons;
 }
 
-cst_err prio_queue_insert(struct prio_queue_handle* hnd, void* data){
+// Merge sort of items using tmp, the result ends up in items.
+static uint64_t __prio_sort(void** items, void** tmp, size_t count, int (comparator)(void* c1, void* c2)){
+    uint64_t comparisons = 0;
+    for(size_t lo = 0; lo < count; lo += PRIO_SORT_RUN){
+        size_t hi = lo + PRIO_SORT_RUN < count ? lo + PRIO_SORT_RUN : count;
+        for(size_t i = lo + 1; i < hi; i++){
+            void* item = items[i];
+            size_t j = i;
+            while(j > lo){
+                comparisons++;
+                if(comparator(item, items[j - 1]) >= 0){
+                    break;
+                }
+                items[j] = items[j - 1];
+                j--;
+            }
+            items[j] = item;
+        }
+    }
+
+    void** src = items;
+    void** dst = tmp;
+    for(size_t width = PRIO_SORT_RUN; width < count; width *= 2){
+        for(size_t lo = 0; lo < count; lo += 2 * width){
+            size_t mid = lo + width < count ? lo + width : count;
+            size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+            comparisons += __prio_merge(src + lo, mid - lo, src + mid, hi - mid, dst + lo, comparator);
+        }
+        void** swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if(src != items){
+        memcpy(items, src, count * sizeof(void*));
+    }
+    return comparisons;
+}
+
+// First index of sorted whose item does not come before item.
+static size_t __prio_lower_bound(void** sorted, size_t len, void* item, int (comparator)(void* c1, void* c2)){
+    size_t lo = 0;
+    while(lo < len){
+        size_t mid = lo + (len - lo) / 2;
+        if(comparator(sorted[mid], item) < 0){
+            lo = mid + 1;
+        } else {
+            len = mid;
+        }
+    }
+    return lo;
+}
+
+static uint64_t __prio_drain_sort_worker(void* arg, unsigned int id, unsigned int count){
+    struct prio_drain_job* job = arg;
+    (void)count;
+    size_t lo = job->bounds[id];
+    size_t hi = job->bounds[id + 1];
+    for(size_t i = lo; i < hi; i++){
+        job->out[i] = cbt_get_data(cbt_get_node(job->cbt_hnd, (int)i));
+    }
+    return __prio_sort(job->out + lo, job->tmp + lo, hi - lo, job->comparator);
+}
+
+// Merges run pairs of src into dst, every pair is split into job->parts slices merged independently.
+static uint64_t __prio_drain_merge_worker(void* arg, unsigned int id, unsigned int count){
+    struct prio_drain_job* job = arg;
+    unsigned int pairs = (job->runs + 1) / 2;
+    uint64_t comparisons = 0;
+    for(unsigned int task = id; task < pairs * job->parts; task += count){
+        unsigned int pair = task / job->parts;
+        unsigned int part = task % job->parts;
+        size_t lo = job->bounds[2 * pair];
+        size_t mid = job->bounds[2 * pair + 1];
+        size_t hi = 2 * pair + 2 <= job->runs ? job->bounds[2 * pair + 2] : mid;
+        void** a = job->src + lo;
+        void** b = job->src + mid;
+        size_t a_len = mid - lo;
+        size_t b_len = hi - mid;
+
+        // Slices split a evenly and b where the first item of the next slice of a would go.
+        size_t a_start = a_len * part / job->parts;
+        size_t a_end = a_len * (part + 1) / job->parts;
+        size_t b_start = part == 0 ? 0 : a_start == a_len ? b_len :
+                         __prio_lower_bound(b, b_len, a[a_start], job->comparator);
+        size_t b_end = part + 1 == job->parts || a_end == a_len ? b_len :
+                       __prio_lower_bound(b, b_len, a[a_end], job->comparator);
+        comparisons += __prio_merge(a + a_start, a_end - a_start, b + b_start, b_end - b_start,
+                                    job->dst + lo + a_start + b_start, job->comparator);
+    }
+    return comparisons;
+}
+
+cst_err prio_queue_drain_sorted_parallel(struct prio_queue_handle* hnd, void** out, unsigned int threads){
     // Safety check
     if(hnd == NULL){
         prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
-    struct cbt_node* new = cbt_insert(hnd->cbt_hnd, data);
-    if(!new){
-        prio_printfln("Insert Failed");
-        return CST_OVERFLOW;
+    __prio_ingress_poll(hnd);
+    if(hnd->dead != 0){
+        __prio_queue_compact(hnd);
     }
-    if(__prio_queue_bubble_up(hnd, new) != CST_OK){
-        prio_printfln("Bubble Up Fail");
-        return CST_FAIL;
+    size_t count = (size_t)cbt_size(hnd->cbt_hnd);
+    if(count == 0){
+        return CST_OK;
     }
-    return CST_OK;
+    if(out == NULL){
+        return CST_PARAM_ERR;
+    }
+
+    // Every thread sorts at least PRIO_SORT_RUN items.
+    threads = __prio_parallel_threads(threads);
+    if(count < PRIO_PARALLEL_MIN_ITEMS){
+        threads = 1;
+    } else if(threads > count / PRIO_SORT_RUN){
+        threads = (unsigned int)(count / PRIO_SORT_RUN);
+    }
+
+    struct prio_drain_job job;
+    memset(&job, 0, sizeof(job));
+    job.cbt_hnd = hnd->cbt_hnd;
+    job.out = out;
+    job.count = count;
+    job.comparator = hnd->comparator;
+    job.tmp = PRIO_ALLOC(sizeof(void*) * count);
+    job.bounds = PRIO_ALLOC(sizeof(size_t) * (threads + 1));
+    if(job.tmp == NULL || job.bounds == NULL){
+        PRIO_FREE(job.tmp);
+        PRIO_FREE(job.bounds);
+        return CST_MEM_ERR;
+    }
+    for(unsigned int i = 0; i <= threads; i++){
+        job.bounds[i] = count * i / threads;
+    }
+    job.runs = threads;
+
+    uint64_t comparisons = 0;
+    cst_err e = CST_OK;
+    if(threads == 1){
+        comparisons = __prio_drain_sort_worker(&job, 0, 1);
+    } else {
+        e = __prio_parallel_run(&__prio_drain_sort_worker, &job, threads, &comparisons);
+    }
+
+    job.src = out;
+    job.dst = job.tmp;
+    while(job.runs > 1 && e == CST_OK){
+        unsigned int pairs = (job.runs + 1) / 2;
+        job.parts = threads / pairs > 0 ? threads / pairs : 1;
+        e = __prio_parallel_run(&__prio_drain_merge_worker, &job, threads, &comparisons);
+
+        for(unsigned int i = 0; i < pairs; i++){
+            job.bounds[i] = job.bounds[2 * i];
+        }
+        job.bounds[pairs] = count;
+        job.runs = pairs;
+        void** swap = job.src;
+        job.src = job.dst;
+        job.dst = swap;
+    }
+    if(e == CST_OK && job.src != out){
+        memcpy(out, job.src, sizeof(void*) * count);
+    }
+
+    if(e == CST_OK){
+        cbt_clear(hnd->cbt_hnd);
+        __prio_keys_clear(&hnd->live);
+#if PRIO_QUEUE_STATS_ENABLED
+        hnd->stats.comparisons += comparisons;
+        hnd->stats.removes += count;
+#endif
+    }
+    (void)comparisons;
+
+    PRIO_FREE(job.tmp);
+    PRIO_FREE(job.bounds);
+    return e;
 }
 
-cst_err prio_queue_remove(struct prio_queue_handle* hnd, void** data){
+#endif
+
+#if PRIO_QUEUE_RESIZE_ENABLED
+
+cst_err prio_queue_resize(struct prio_queue_handle* hnd, size_t new_size){
     // Safety check
     if(hnd == NULL){
         prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
-    struct cbt_node* root = cbt_get_root(hnd->cbt_hnd);
-    if(root == NULL){
-        // Nothing to remove
-        return CST_EMPTY;
+#if PRIO_QUEUE_TRACE_ENABLED
+    uint64_t start = hnd->trace_rate != 0 ? __prio_trace_now() : 0;
+#endif
+    cst_err e = cbt_resize(hnd->cbt_hnd, new_size);
+    if(e == CST_OK){
+        PRIO_STAT_INC(hnd, resizes);
+#if PRIO_QUEUE_TRACE_ENABLED
+        if(start != 0){
+            __prio_trace_end(hnd, PRIO_QUEUE_EVENT_RESIZE, NULL, start);
+        }
+#endif
     }
+    return e;
+}
 
-    *data = cbt_get_data(root);
-    void* tmp = NULL;
-    cbt_remove(hnd->cbt_hnd, &tmp);
-    if(tmp == NULL){
+#endif
+
+#if PRIO_QUEUE_STATS_ENABLED
+
+cst_err prio_queue_get_stats(struct prio_queue_handle* hnd, struct prio_queue_stats* stats){
+    // Safety check
+    if(hnd == NULL || stats == NULL){
+        prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
-    cbt_set_data(root, tmp);
+    *stats = hnd->stats;
+    return CST_OK;
+}
 
-    if(__prio_queue_trickle_down(hnd, root) != CST_OK){
-        prio_printfln("Trickle Down Fail");
+cst_err prio_queue_reset_stats(struct prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
+    memset(&hnd->stats, 0, sizeof(hnd->stats));
+    hnd->stats.size_high_water = (uint64_t)cbt_size(hnd->cbt_hnd);
     return CST_OK;
 }
 
-int prio_queue_size(struct prio_queue_handle* hnd){
+#endif
+
+#if PRIO_QUEUE_TRACE_ENABLED
+
+cst_err prio_queue_set_trace(struct prio_queue_handle* hnd,
+                             void (callback)(enum prio_queue_event event, void* data, uint64_t latency_ns, void* ctx),
+                             void* ctx, uint32_t sample_rate){
     // Safety check
     if(hnd == NULL){
         prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
-    return cbt_size(hnd->cbt_hnd);
+    hnd->trace = callback;
+    hnd->trace_ctx = ctx;
+    hnd->trace_rate = sample_rate;
+    hnd->trace_tick = 0;
+    return CST_OK;
 }
 
-#if PRIO_QUEUE_RESIZE_ENABLED
+cst_err prio_queue_get_latency(struct prio_queue_handle* hnd, enum prio_queue_event event,
+                               struct prio_queue_latency* latency){
+    // Safety check
+    if(hnd == NULL || latency == NULL){
+        prio_printfln("Null Handle")
+        return CST_FAIL;
+    }
 
-cst_err prio_queue_resize(struct prio_queue_handle* hnd, size_t new_size){
+    if(event >= PRIO_QUEUE_EVENT_OVERFLOW){
+        prio_printfln("Event not timed");
+        return CST_PARAM_ERR;
+    }
+
+    *latency = hnd->latency[event];
+    return CST_OK;
+}
+
+cst_err prio_queue_reset_latency(struct prio_queue_handle* hnd){
     // Safety check
     if(hnd == NULL){
         prio_printfln("Null Handle")
         return CST_FAIL;
     }
 
-    return cbt_resize(hnd->cbt_hnd, new_size);
+    memset(hnd->latency, 0, sizeof(hnd->latency));
+    return CST_OK;
+}
+
+uint64_t prio_queue_latency_percentile(const struct prio_queue_latency* latency, double percentile){
+    if(latency == NULL || latency->count == 0){
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)latency->count);
+    uint64_t seen = 0;
+    for(int bucket = 0; bucket < PRIO_QUEUE_LATENCY_BUCKETS; bucket++){
+        seen += latency->buckets[bucket];
+        if(seen > rank){
+            if(bucket < (1 << PRIO_QUEUE_LATENCY_SUB_BITS)){
+                return (uint64_t)bucket;
+            }
+            // Highest value of the bucket, capped by the largest latency seen.
+            int msb = (bucket >> PRIO_QUEUE_LATENCY_SUB_BITS) + PRIO_QUEUE_LATENCY_SUB_BITS - 1;
+            uint64_t sub = (uint64_t)(bucket & ((1 << PRIO_QUEUE_LATENCY_SUB_BITS) - 1));
+            uint64_t value = (((1ULL << PRIO_QUEUE_LATENCY_SUB_BITS) + sub + 1) << (msb - PRIO_QUEUE_LATENCY_SUB_BITS)) - 1;
+            return value < latency->max ? value : latency->max;
+        }
+    }
+    return latency->max;
 }
 
 #endif
@@ -161,8 +1627,9 @@ cst_err prio_queue_resize(struct prio_queue_handle* hnd, size_t new_size){
 static cst_err __prio_queue_bubble_up(struct prio_queue_handle* hnd, struct cbt_node* node){
     struct cbt_node* child = node;
     struct cbt_node* parent = cbt_get_parent(hnd->cbt_hnd, child);
+    int depth = 0;
     while(parent != NULL){
-        int cmp = hnd->comparator(cbt_get_data(parent), cbt_get_data(child));
+        int cmp = __prio_queue_compare(hnd, cbt_get_data(parent), cbt_get_data(child));
         if(cmp == 0){
             // Nodes equal and done break loop.
             break;
@@ -172,27 +1639,34 @@ static cst_err __prio_queue_bubble_up(struct prio_queue_handle* hnd, struct cbt_
         } else if (cmp > 0) {
             // Swap
             cbt_swap(parent, child); // Note the parent node now holds the child nodes data and vice versa.
+            PRIO_STAT_INC(hnd, swaps);
+            depth++;
             child = parent;
             parent = cbt_get_parent(hnd->cbt_hnd, child);
         }
     }
+    PRIO_STAT_DEPTH(hnd, depth);
+    (void)depth;
     return CST_OK;
 }
 
 static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct cbt_node* root){
     struct cbt_node* parent = root;
+    int depth = 0;
     struct cbt_node* child_left = cbt_get_child_left(hnd->cbt_hnd, parent);
     struct cbt_node* child_right = cbt_get_child_right(hnd->cbt_hnd, parent);
 
     while(!((child_left == NULL) && (child_right == NULL))){
         if((child_left != NULL) && (child_right != NULL)){
-            int cmp = hnd->comparator(cbt_get_data(child_left), cbt_get_data(child_right));
+            int cmp = __prio_queue_compare(hnd, cbt_get_data(child_left), cbt_get_data(child_right));
             if (cmp > 0) {
                 // check right
-                int rcmp = hnd->comparator(cbt_get_data(parent), cbt_get_data(child_right));
+                int rcmp = __prio_queue_compare(hnd, cbt_get_data(parent), cbt_get_data(child_right));
                 if (rcmp > 0) {
                     // If parent larger swap and loop
                     cbt_swap(parent, child_right);
+                    PRIO_STAT_INC(hnd, swaps);
+                    depth++;
                     parent = child_right;
                     child_left = cbt_get_child_left(hnd->cbt_hnd, parent);
                     child_right = cbt_get_child_right(hnd->cbt_hnd, parent);
@@ -203,10 +1677,12 @@ static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct c
                 }
             } else {
                 // check left
-                int lcmp = hnd->comparator(cbt_get_data(parent), cbt_get_data(child_left));
+                int lcmp = __prio_queue_compare(hnd, cbt_get_data(parent), cbt_get_data(child_left));
                 if (lcmp > 0) {
                     // If parent larger swap and loop
                     cbt_swap(parent, child_left);
+                    PRIO_STAT_INC(hnd, swaps);
+                    depth++;
                     parent = child_left;
                     child_left = cbt_get_child_left(hnd->cbt_hnd, parent);
                     child_right = cbt_get_child_right(hnd->cbt_hnd, parent);
@@ -218,10 +1694,12 @@ static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct c
             }
         } else {
             if(child_left != NULL){
-                int cmp = hnd->comparator(cbt_get_data(parent), cbt_get_data(child_left));
+                int cmp = __prio_queue_compare(hnd, cbt_get_data(parent), cbt_get_data(child_left));
                 if (cmp > 0) {
                     // If parent larger swap and loop
                     cbt_swap(parent, child_left);
+                    PRIO_STAT_INC(hnd, swaps);
+                    depth++;
                     parent = child_left;
                     child_left = cbt_get_child_left(hnd->cbt_hnd, parent);
                     child_right = cbt_get_child_right(hnd->cbt_hnd, parent);
@@ -233,5 +1711,7 @@ static cst_err __prio_queue_trickle_down(struct prio_queue_handle* hnd, struct c
             }
         }
     }
+    PRIO_STAT_DEPTH(hnd, depth);
+    (void)depth;
     return CST_OK;
-}
\ No newline at end of file
+}
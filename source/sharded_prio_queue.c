@@ -0,0 +1,411 @@
+/*
+ * Sharded Priority Queue Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sched_getcpu
+#endif
+
+#include "../include/sharded_prio_queue.h"
+
+#if SHARDED_PRIO_QUEUE_ENABLED
+
+#include "../include/prio_queue.h"
+#include "../include/cbt.h"
+
+#define SHARDED_PRIO_QUEUE_DEBUG 0
+
+#if SHARDED_PRIO_QUEUE_DEBUG
+
+#include <stdio.h>
+
+#define spq_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define spq_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define spq_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define spq_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "stdlib.h"
+
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+#include <numa.h>
+#endif
+
+#define SPQ_ALLOC(x) malloc(x);
+#define SPQ_FREE(x) free(x);
+
+#define SPQ_CACHE_LINE 64
+
+struct spq_shard{
+    pthread_mutex_t lock;
+    struct prio_queue_handle* queue;
+    atomic_size_t size;     // Written under the lock, read without it to skip empty shards.
+    size_t max_size;
+    int numa;               // Allocated with libnuma.
+};
+
+struct sharded_prio_queue_handle{
+    struct spq_shard** shards;  // Separate allocations, on their node and never sharing a cache line.
+    size_t count;
+    size_t nodes;               // Shard i belongs to node i % nodes.
+    atomic_size_t best;         // Cached shard holding the global best.
+    atomic_uint removes;
+    int (*comparator)(void* c1, void* c2);
+};
+
+#if !defined(__linux__)
+static atomic_uint spq_next_thread;
+static _Thread_local int spq_thread = -1;
+#endif
+
+static int __spq_cpu(void){
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu;
+#else
+    // No way to ask for the CPU, threads are numbered instead.
+    if(spq_thread < 0){
+        spq_thread = (int)atomic_fetch_add(&spq_next_thread, 1);
+    }
+    return spq_thread;
+#endif
+}
+
+static size_t __spq_local(struct sharded_prio_queue_handle* hnd){
+    size_t cpu = (size_t)__spq_cpu();
+    size_t node = 0;
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+    if(hnd->nodes > 1){
+        int n = numa_node_of_cpu((int)cpu);
+        node = n < 0 ? 0 : (size_t)n % hnd->nodes;
+    }
+#endif
+    // The shards of this node are node, node + nodes, ..., spread its CPUs over them.
+    if(node >= hnd->count){
+        return cpu % hnd->count;
+    }
+    size_t per_node = (hnd->count - node + hnd->nodes - 1) / hnd->nodes;
+    return node + hnd->nodes * (cpu % per_node);
+}
+
+static struct spq_shard* __spq_shard_alloc(size_t node, int numa){
+    struct spq_shard* shard = NULL;
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+    if(numa){
+        shard = numa_alloc_onnode(sizeof(struct spq_shard), (int)node);
+        if(shard != NULL){
+            shard->numa = 1;
+            return shard;
+        }
+    }
+#else
+    (void)node;
+    (void)numa;
+#endif
+    void* mem = NULL;
+    size_t size = (sizeof(struct spq_shard) + SPQ_CACHE_LINE - 1) / SPQ_CACHE_LINE * SPQ_CACHE_LINE;
+    if(posix_memalign(&mem, SPQ_CACHE_LINE, size) != 0){
+        return NULL;
+    }
+    shard = mem;
+    shard->numa = 0;
+    return shard;
+}
+
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+
+// Heap arrays of a shard, ctx is its node. Pages are bound to the node whichever thread touches them first.
+static void* __spq_numa_alloc(size_t size, void* ctx){
+    return numa_alloc_onnode(size, (int)(uintptr_t)ctx);
+}
+
+static void __spq_numa_free(void* ptr, size_t size, void* ctx){
+    (void)ctx;
+    numa_free(ptr, size);
+}
+
+#endif
+
+static void __spq_shard_free(struct spq_shard* shard){
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+    if(shard->numa){
+        numa_free(shard, sizeof(struct spq_shard));
+        return;
+    }
+#endif
+    SPQ_FREE(shard);
+}
+
+// Called with the shard locked.
+static cst_err __spq_pop(struct spq_shard* shard, void** data){
+    cst_err e = prio_queue_remove(shard->queue, data);
+    if(e == CST_OK){
+        atomic_store_explicit(&shard->size, atomic_load_explicit(&shard->size, memory_order_relaxed) - 1,
+                              memory_order_relaxed);
+    }
+    return e;
+}
+
+// Finds the shard with the best top and caches it, returns count if every shard is empty. At most two locks are held
+// and they are taken in shard order, like in __spq_remove_pair.
+static size_t __spq_refresh(struct sharded_prio_queue_handle* hnd){
+    size_t best = hnd->count;
+    void* best_top = NULL;
+    for(size_t i = 0; i < hnd->count; i++){
+        struct spq_shard* shard = hnd->shards[i];
+        if(atomic_load_explicit(&shard->size, memory_order_relaxed) == 0){
+            continue;
+        }
+        pthread_mutex_lock(&shard->lock);
+        void* top = NULL;
+        if(prio_queue_peek(shard->queue, &top) == CST_OK &&
+           (best == hnd->count || hnd->comparator(top, best_top) < 0)){
+            if(best != hnd->count){
+                pthread_mutex_unlock(&hnd->shards[best]->lock);
+            }
+            best = i;
+            best_top = top;
+        } else {
+            pthread_mutex_unlock(&shard->lock);
+        }
+    }
+    if(best != hnd->count){
+        pthread_mutex_unlock(&hnd->shards[best]->lock);
+        atomic_store_explicit(&hnd->best, best, memory_order_relaxed);
+    }
+    return best;
+}
+
+// Removes the better top of two shards, CST_EMPTY if both are empty.
+static cst_err __spq_remove_pair(struct sharded_prio_queue_handle* hnd, size_t a, size_t b, void** data){
+    if(a == b){
+        struct spq_shard* shard = hnd->shards[a];
+        pthread_mutex_lock(&shard->lock);
+        cst_err e = __spq_pop(shard, data);
+        pthread_mutex_unlock(&shard->lock);
+        return e;
+    }
+
+    struct spq_shard* first = hnd->shards[a < b ? a : b];
+    struct spq_shard* second = hnd->shards[a < b ? b : a];
+    pthread_mutex_lock(&first->lock);
+    pthread_mutex_lock(&second->lock);
+    void* first_top = NULL;
+    void* second_top = NULL;
+    cst_err first_e = prio_queue_peek(first->queue, &first_top);
+    cst_err second_e = prio_queue_peek(second->queue, &second_top);
+    cst_err e = CST_EMPTY;
+    if(first_e == CST_OK && (second_e != CST_OK || hnd->comparator(first_top, second_top) <= 0)){
+        e = __spq_pop(first, data);
+    } else if(second_e == CST_OK){
+        e = __spq_pop(second, data);
+    }
+    pthread_mutex_unlock(&second->lock);
+    pthread_mutex_unlock(&first->lock);
+    return e;
+}
+
+cst_err sharded_prio_queue_init(struct sharded_prio_queue_handle** hnd, size_t shards, size_t max_size,
+                                int (comparator)(void* c1, void* c2)){
+    // Safety check
+    if(hnd == NULL || comparator == NULL){
+        return CST_PARAM_ERR;
+    }
+    *hnd = NULL;
+
+    size_t nodes = 1;
+    int numa = 0;
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+    if(numa_available() >= 0){
+        numa = 1;
+        nodes = (size_t)numa_max_node() + 1;
+    }
+#endif
+    size_t count = shards ? shards : nodes;
+
+    struct sharded_prio_queue_handle* spq = SPQ_ALLOC(sizeof(struct sharded_prio_queue_handle));
+    if(spq == NULL){
+        spq_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+    spq->shards = calloc(count, sizeof(struct spq_shard*));
+    if(spq->shards == NULL){
+        SPQ_FREE(spq);
+        return CST_MEM_ERR;
+    }
+    spq->count = count;
+    spq->nodes = nodes;
+    spq->comparator = comparator;
+    atomic_init(&spq->best, 0);
+    atomic_init(&spq->removes, 0);
+
+    for(size_t i = 0; i < count; i++){
+        struct spq_shard* shard = __spq_shard_alloc(i % nodes, numa);
+        if(shard == NULL){
+            sharded_prio_queue_free(spq);
+            return CST_MEM_ERR;
+        }
+        // The heap array, and every larger one it grows into, is allocated on the shard's node too.
+        struct cbt_allocator* allocator = NULL;
+#if SHARDED_PRIO_QUEUE_NUMA_ENABLED
+        struct cbt_allocator on_node = { &__spq_numa_alloc, &__spq_numa_free, (void*)(uintptr_t)(i % nodes) };
+        allocator = numa ? &on_node : NULL;
+#endif
+        shard->queue = NULL;
+        cst_err e = prio_queue_init_allocator(&shard->queue, max_size ? max_size : 1, comparator, allocator);
+        if(e != CST_OK){
+            __spq_shard_free(shard);
+            sharded_prio_queue_free(spq);
+            return e;
+        }
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->size, 0);
+        shard->max_size = max_size ? max_size : 1;
+        spq->shards[i] = shard;
+    }
+
+    *hnd = spq;
+    return CST_OK;
+}
+
+void sharded_prio_queue_free(struct sharded_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        return;
+    }
+
+    for(size_t i = 0; i < hnd->count; i++){
+        struct spq_shard* shard = hnd->shards[i];
+        if(shard != NULL){
+            pthread_mutex_destroy(&shard->lock);
+            prio_queue_free(shard->queue);
+            __spq_shard_free(shard);
+        }
+    }
+    SPQ_FREE(hnd->shards);
+    SPQ_FREE(hnd);
+}
+
+cst_err sharded_prio_queue_insert_shard(struct sharded_prio_queue_handle* hnd, size_t shard, void* data){
+    // Safety check
+    if(hnd == NULL){
+        return CST_FAIL;
+    }
+    if(shard >= hnd->count){
+        return CST_PARAM_ERR;
+    }
+
+    struct spq_shard* s = hnd->shards[shard];
+    pthread_mutex_lock(&s->lock);
+    cst_err e = prio_queue_insert(s->queue, data);
+#if PRIO_QUEUE_RESIZE_ENABLED
+    // Shards are not resized from outside, a full one grows here.
+    if(e == CST_OVERFLOW){
+        e = prio_queue_resize(s->queue, s->max_size * 2);
+        if(e == CST_OK){
+            s->max_size *= 2;
+            e = prio_queue_insert(s->queue, data);
+        }
+    }
+#endif
+    if(e == CST_OK){
+        atomic_store_explicit(&s->size, atomic_load_explicit(&s->size, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return e;
+}
+
+cst_err sharded_prio_queue_insert(struct sharded_prio_queue_handle* hnd, void* data){
+    // Safety check
+    if(hnd == NULL){
+        return CST_FAIL;
+    }
+    return sharded_prio_queue_insert_shard(hnd, hnd->count == 1 ? 0 : __spq_local(hnd), data);
+}
+
+cst_err sharded_prio_queue_remove(struct sharded_prio_queue_handle* hnd, void** data){
+    // Safety check
+    if(hnd == NULL || data == NULL){
+        return CST_FAIL;
+    }
+
+    // A single node machine gets one shard, which needs neither the local shard nor the cache.
+    if(hnd->count == 1){
+        return __spq_remove_pair(hnd, 0, 0, data);
+    }
+
+    size_t local = __spq_local(hnd);
+    size_t best;
+    if(atomic_fetch_add_explicit(&hnd->removes, 1, memory_order_relaxed) % SHARDED_PRIO_QUEUE_REFRESH == 0){
+        best = __spq_refresh(hnd);
+        if(best == hnd->count){
+            return CST_EMPTY;
+        }
+    } else {
+        best = atomic_load_explicit(&hnd->best, memory_order_relaxed);
+    }
+
+    cst_err e = __spq_remove_pair(hnd, local, best, data);
+    // Both ran dry, look through every shard. Only fails again if another thread took the item in between.
+    while(e == CST_EMPTY){
+        best = __spq_refresh(hnd);
+        if(best == hnd->count){
+            return CST_EMPTY;
+        }
+        e = __spq_remove_pair(hnd, best, best, data);
+    }
+    return e;
+}
+
+size_t sharded_prio_queue_shards(struct sharded_prio_queue_handle* hnd){
+    return hnd == NULL ? 0 : hnd->count;
+}
+
+size_t sharded_prio_queue_local_shard(struct sharded_prio_queue_handle* hnd){
+    return hnd == NULL ? 0 : __spq_local(hnd);
+}
+
+size_t sharded_prio_queue_size(struct sharded_prio_queue_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        return 0;
+    }
+
+    size_t size = 0;
+    for(size_t i = 0; i < hnd->count; i++){
+        size += atomic_load_explicit(&hnd->shards[i]->size, memory_order_relaxed);
+    }
+    return size;
+}
+
+#endif
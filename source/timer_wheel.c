@@ -0,0 +1,452 @@
+/*
+ * Hierarchical Timer Wheel Implementation
+ *
+ * Copyright (c) 2017 Brandon Bemister. All rights reserved.
+ * https://github.com/bjbemister19/CPriorityQueue
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 Brandon Bemister
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "../include/timer_wheel.h"
+#include "../include/prio_queue.h"
+
+#define TIMER_WHEEL_DEBUG 0
+
+#if TIMER_WHEEL_DEBUG
+
+#include <stdio.h>
+
+#define tw_printf(x, ...) printf(x, ##__VA_ARGS__)
+#define tw_printfln(x, ...) do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#else
+
+#define tw_printf(x, ...) //printf(x, ##__VA_ARGS__)
+#define tw_printfln(x, ...) //do{ printf(x, ##__VA_ARGS__); printf("\n"); } while(0);
+
+#endif
+
+#include "stdlib.h"
+
+#define TW_ALLOC(x) malloc(x);
+#define TW_FREE(x) free(x);
+
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK (TW_SLOTS - 1)
+#define TW_RANGE_BITS (TW_SLOT_BITS * TIMER_WHEEL_LEVELS)
+
+#define TW_CHUNK_TIMERS 256  /** Timers are allocated this many at a time. */
+#define TW_HEAP_INITIAL 64   /** Initial size of the far future heap. */
+
+enum tw_state{
+    TW_STATE_FREE,
+    TW_STATE_WHEEL,
+    TW_STATE_PENDING,
+    TW_STATE_HEAP,
+    TW_STATE_HEAP_CANCELLED
+};
+
+struct tw_link{
+    struct tw_link* next;
+    struct tw_link* prev;
+};
+
+struct timer_wheel_timer{
+    struct tw_link link; // Must be first, lists are made of links.
+    uint64_t deadline;
+    void* data;
+    unsigned char state;
+    unsigned char level;
+    unsigned char slot;
+};
+
+struct tw_chunk{
+    struct tw_chunk* next;
+    struct timer_wheel_timer timers[TW_CHUNK_TIMERS];
+};
+
+struct timer_wheel_handle{
+    struct tw_link slots[TIMER_WHEEL_LEVELS][TW_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+    struct tw_link pending;
+    struct prio_queue_handle* far;
+    struct timer_wheel_timer* free_timers;
+    struct tw_chunk* chunks;
+    uint64_t current;
+    size_t count;
+};
+
+static void __tw_list_init(struct tw_link* head){
+    head->next = head;
+    head->prev = head;
+}
+
+static int __tw_list_empty(struct tw_link* head){
+    return head->next == head;
+}
+
+static void __tw_list_append(struct tw_link* head, struct tw_link* link){
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void __tw_list_unlink(struct tw_link* link){
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+}
+
+// Moves every link of from onto the end of to, leaving from empty.
+static void __tw_list_splice(struct tw_link* from, struct tw_link* to){
+    if(__tw_list_empty(from)){
+        return;
+    }
+    from->next->prev = to->prev;
+    to->prev->next = from->next;
+    from->prev->next = to;
+    to->prev = from->prev;
+    __tw_list_init(from);
+}
+
+static int __tw_compare(void* c1, void* c2){
+    uint64_t d1 = ((struct timer_wheel_timer*)c1)->deadline;
+    uint64_t d2 = ((struct timer_wheel_timer*)c2)->deadline;
+    if(d1 > d2){
+        return 1;
+    } else if(d1 < d2){
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
+static struct timer_wheel_timer* __tw_alloc_timer(struct timer_wheel_handle* hnd){
+    if(hnd->free_timers == NULL){
+        struct tw_chunk* chunk = TW_ALLOC(sizeof(struct tw_chunk));
+        if(chunk == NULL){
+            tw_printfln("Alloc Failed");
+            return NULL;
+        }
+        chunk->next = hnd->chunks;
+        hnd->chunks = chunk;
+        for(int i = 0; i < TW_CHUNK_TIMERS; i++){
+            chunk->timers[i].state = TW_STATE_FREE;
+            chunk->timers[i].link.next = (struct tw_link*)hnd->free_timers;
+            hnd->free_timers = &chunk->timers[i];
+        }
+    }
+
+    struct timer_wheel_timer* timer = hnd->free_timers;
+    hnd->free_timers = (struct timer_wheel_timer*)timer->link.next;
+    return timer;
+}
+
+static void __tw_free_timer(struct timer_wheel_handle* hnd, struct timer_wheel_timer* timer){
+    timer->state = TW_STATE_FREE;
+    timer->data = NULL;
+    timer->link.next = (struct tw_link*)hnd->free_timers;
+    hnd->free_timers = timer;
+}
+
+// Places a timer relative to the current tick, either on the pending list, in a wheel or in the far future heap.
+static cst_err __tw_place(struct timer_wheel_handle* hnd, struct timer_wheel_timer* timer){
+    if(timer->deadline <= hnd->current){
+        timer->state = TW_STATE_PENDING;
+        __tw_list_append(&hnd->pending, &timer->link);
+        return CST_OK;
+    }
+
+    // The highest bit in which the deadline differs from now selects the wheel.
+    uint64_t diff = timer->deadline ^ hnd->current;
+    int level = (63 - __builtin_clzll(diff)) / TW_SLOT_BITS;
+    if(level >= TIMER_WHEEL_LEVELS){
+        cst_err e = prio_queue_insert(hnd->far, timer);
+        if(e == CST_OVERFLOW){
+            e = prio_queue_resize(hnd->far, (size_t)prio_queue_size(hnd->far) * 2);
+            if(e != CST_OK){
+                return e;
+            }
+            e = prio_queue_insert(hnd->far, timer);
+        }
+        if(e != CST_OK){
+            return e;
+        }
+        timer->state = TW_STATE_HEAP;
+        return CST_OK;
+    }
+
+    int slot = (int)((timer->deadline >> (level * TW_SLOT_BITS)) & TW_SLOT_MASK);
+    timer->state = TW_STATE_WHEEL;
+    timer->level = (unsigned char)level;
+    timer->slot = (unsigned char)slot;
+    __tw_list_append(&hnd->slots[level][slot], &timer->link);
+    hnd->occupied[level] |= (1ULL << slot);
+    return CST_OK;
+}
+
+// Re-places every timer of a wheel slot relative to the current tick.
+static void __tw_cascade(struct timer_wheel_handle* hnd, int level, int slot){
+    struct tw_link list;
+    __tw_list_init(&list);
+    __tw_list_splice(&hnd->slots[level][slot], &list);
+    hnd->occupied[level] &= ~(1ULL << slot);
+
+    while(!__tw_list_empty(&list)){
+        struct timer_wheel_timer* timer = (struct timer_wheel_timer*)list.next;
+        __tw_list_unlink(&timer->link);
+        // A cascade only ever moves timers to a lower wheel or the pending list, neither can fail.
+        __tw_place(hnd, timer);
+    }
+}
+
+// Moves far future timers which have come into range of the wheels out of the heap.
+static void __tw_migrate(struct timer_wheel_handle* hnd){
+    void* top = NULL;
+    while(prio_queue_size(hnd->far) > 0){
+        prio_queue_peek(hnd->far, &top);
+        struct timer_wheel_timer* timer = top;
+        if((timer->deadline >> TW_RANGE_BITS) != (hnd->current >> TW_RANGE_BITS)){
+            break;
+        }
+        prio_queue_remove(hnd->far, &top);
+        if(timer->state == TW_STATE_HEAP_CANCELLED){
+            __tw_free_timer(hnd, timer);
+        } else {
+            __tw_place(hnd, timer);
+        }
+    }
+}
+
+// Finds the next tick after the current one at which something has to be done, UINT64_MAX if there is none.
+static uint64_t __tw_next_event(struct timer_wheel_handle* hnd){
+    uint64_t next = UINT64_MAX;
+    for(int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+        if(hnd->occupied[level] == 0){
+            continue;
+        }
+        int shift = level * TW_SLOT_BITS;
+        int index = (int)((hnd->current >> shift) & TW_SLOT_MASK);
+        if(index == TW_SLOT_MASK){
+            continue;
+        }
+        // Timers are always placed in a slot after the current one, so only look ahead.
+        uint64_t mask = hnd->occupied[level] & (~0ULL << (index + 1));
+        if(mask == 0){
+            continue;
+        }
+        uint64_t base = (hnd->current >> (shift + TW_SLOT_BITS)) << (shift + TW_SLOT_BITS);
+        uint64_t tick = base | ((uint64_t)__builtin_ctzll(mask) << shift);
+        if(tick < next){
+            next = tick;
+        }
+    }
+
+    void* top = NULL;
+    if(prio_queue_size(hnd->far) > 0 && prio_queue_peek(hnd->far, &top) == CST_OK){
+        uint64_t tick = (((struct timer_wheel_timer*)top)->deadline >> TW_RANGE_BITS) << TW_RANGE_BITS;
+        if(tick < next){
+            next = tick;
+        }
+    }
+    return next;
+}
+
+static size_t __tw_fire_pending(struct timer_wheel_handle* hnd, void (callback)(void* data, void* ctx), void* ctx){
+    size_t fired = 0;
+    while(!__tw_list_empty(&hnd->pending)){
+        struct timer_wheel_timer* timer = (struct timer_wheel_timer*)hnd->pending.next;
+        void* data = timer->data;
+        __tw_list_unlink(&timer->link);
+        __tw_free_timer(hnd, timer);
+        hnd->count--;
+        fired++;
+        // The timer is released before the callback so it may schedule new timers freely.
+        callback(data, ctx);
+    }
+    return fired;
+}
+
+cst_err timer_wheel_init(struct timer_wheel_handle** hnd, uint64_t now){
+    *hnd = TW_ALLOC(sizeof(struct timer_wheel_handle));
+    if(*hnd == NULL){
+        tw_printfln("Alloc Failed");
+        return CST_MEM_ERR;
+    }
+
+    cst_err init_e = prio_queue_init(&((*hnd)->far), TW_HEAP_INITIAL, &__tw_compare);
+    if(init_e != CST_OK){
+        TW_FREE(*hnd);
+        *hnd = NULL;
+        return CST_FAIL;
+    }
+
+    for(int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+        for(int slot = 0; slot < TW_SLOTS; slot++){
+            __tw_list_init(&(*hnd)->slots[level][slot]);
+        }
+        (*hnd)->occupied[level] = 0;
+    }
+    __tw_list_init(&(*hnd)->pending);
+    (*hnd)->free_timers = NULL;
+    (*hnd)->chunks = NULL;
+    (*hnd)->current = now;
+    (*hnd)->count = 0;
+
+    return CST_OK;
+}
+
+void timer_wheel_free(struct timer_wheel_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        tw_printfln("Null Handle")
+        return;
+    }
+
+    prio_queue_free(hnd->far);
+    while(hnd->chunks != NULL){
+        struct tw_chunk* next = hnd->chunks->next;
+        TW_FREE(hnd->chunks);
+        hnd->chunks = next;
+    }
+    TW_FREE(hnd);
+}
+
+cst_err timer_wheel_schedule(struct timer_wheel_handle* hnd, uint64_t deadline, void* data,
+                             struct timer_wheel_timer** timer){
+    // Safety check
+    if(hnd == NULL){
+        tw_printfln("Null Handle")
+        return CST_FAIL;
+    }
+
+    struct timer_wheel_timer* new = __tw_alloc_timer(hnd);
+    if(new == NULL){
+        return CST_MEM_ERR;
+    }
+    new->deadline = deadline;
+    new->data = data;
+
+    cst_err e = __tw_place(hnd, new);
+    if(e != CST_OK){
+        __tw_free_timer(hnd, new);
+        return e;
+    }
+
+    hnd->count++;
+    if(timer != NULL){
+        *timer = new;
+    }
+    return CST_OK;
+}
+
+cst_err timer_wheel_cancel(struct timer_wheel_handle* hnd, struct timer_wheel_timer* timer, void** data){
+    // Safety check
+    if(hnd == NULL || timer == NULL){
+        tw_printfln("Null Handle")
+        return CST_PARAM_ERR;
+    }
+
+    if(data != NULL){
+        *data = timer->data;
+    }
+
+    switch(timer->state){
+        case TW_STATE_WHEEL:
+            __tw_list_unlink(&timer->link);
+            if(__tw_list_empty(&hnd->slots[timer->level][timer->slot])){
+                hnd->occupied[timer->level] &= ~(1ULL << timer->slot);
+            }
+            __tw_free_timer(hnd, timer);
+            break;
+        case TW_STATE_PENDING:
+            __tw_list_unlink(&timer->link);
+            __tw_free_timer(hnd, timer);
+            break;
+        case TW_STATE_HEAP:
+            // The heap cannot remove arbitrary items, the timer is released once it reaches the top.
+            timer->state = TW_STATE_HEAP_CANCELLED;
+            timer->data = NULL;
+            break;
+        default:
+            tw_printfln("Timer not scheduled");
+            return CST_PARAM_ERR;
+    }
+
+    hnd->count--;
+    return CST_OK;
+}
+
+size_t timer_wheel_advance(struct timer_wheel_handle* hnd, uint64_t now, void (callback)(void* data, void* ctx),
+                           void* ctx){
+    // Safety check
+    if(hnd == NULL || callback == NULL){
+        tw_printfln("Null Handle")
+        return 0;
+    }
+
+    size_t fired = __tw_fire_pending(hnd, callback, ctx);
+
+    while(hnd->current < now){
+        uint64_t next = __tw_next_event(hnd);
+        if(next > now){
+            hnd->current = now;
+            break;
+        }
+        hnd->current = next;
+
+        // Timers in an upper wheel slot starting now are spread over the wheels below.
+        for(int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--){
+            int shift = level * TW_SLOT_BITS;
+            if((next & ((1ULL << shift) - 1)) != 0){
+                continue;
+            }
+            int slot = (int)((next >> shift) & TW_SLOT_MASK);
+            if(hnd->occupied[level] & (1ULL << slot)){
+                __tw_cascade(hnd, level, slot);
+            }
+        }
+
+        if((next & ((1ULL << TW_RANGE_BITS) - 1)) == 0){
+            __tw_migrate(hnd);
+        }
+
+        // Everything in the lowest wheel slot is due now.
+        int slot = (int)(next & TW_SLOT_MASK);
+        if(hnd->occupied[0] & (1ULL << slot)){
+            __tw_list_splice(&hnd->slots[0][slot], &hnd->pending);
+            hnd->occupied[0] &= ~(1ULL << slot);
+        }
+
+        fired += __tw_fire_pending(hnd, callback, ctx);
+    }
+
+    return fired;
+}
+
+size_t timer_wheel_size(struct timer_wheel_handle* hnd){
+    // Safety check
+    if(hnd == NULL){
+        tw_printfln("Null Handle")
+        return 0;
+    }
+
+    return hnd->count;
+}
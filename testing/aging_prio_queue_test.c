@@ -0,0 +1,102 @@
+
+#include "aging_prio_queue_test.h"
+#include "../include/aging_prio_queue.h"
+#include "stdio.h"
+
+#define AGING_TEST_ITEMS 500
+
+struct aging_test_item{
+    double base;
+    size_t age_class;
+    uint64_t inserted;
+    int removed;
+};
+
+void aging_prio_queue_test(void){
+    printf("\nStarting aging_prio_queue_test\n\n");
+    struct aging_prio_queue_handle *hnd = NULL;
+
+    // Class 0 never ages, class 1 gains one priority per tick, class 2 a quarter.
+    double rates[] = {0, 1.0, 0.25};
+    cst_err err = aging_prio_queue_init(&hnd, 2, rates, 3, 100);
+    if(err != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    int old = 1, urgent = 2, late = 3;
+    aging_prio_queue_insert(hnd, &old, 10, 1, 100);
+    aging_prio_queue_insert(hnd, &urgent, 5, 0, 100);
+    if(aging_prio_queue_insert(hnd, &late, 1, 0, 100) != CST_OVERFLOW){
+        printf("Overflow fail\n");
+        goto exit;
+    }
+    aging_prio_queue_resize(hnd, AGING_TEST_ITEMS);
+
+    void* data = NULL;
+    double priority = 0;
+    aging_prio_queue_peek(hnd, &data, &priority, 100);
+    printf("Next at 100 (should be 2): %d, priority (should be 5): %g\n", *(int*)data, priority);
+    aging_prio_queue_peek(hnd, &data, &priority, 106);
+    printf("Next at 106 (should be 1): %d, priority (should be 4): %g\n", *(int*)data, priority);
+    if(*(int*)data != 1 || priority != 4){
+        printf("Aging fail\n");
+        goto exit;
+    }
+    aging_prio_queue_remove(hnd, &data, 106);
+    aging_prio_queue_remove(hnd, &data, 106);
+
+    // Random inserts and removes checked against a scan of every item's effective priority.
+    struct aging_test_item items[AGING_TEST_ITEMS];
+    uint32_t rng = 12345;
+    uint64_t now = 106;
+    int inserted = 0;
+    int queued = 0;
+    for(int op = 0; op < AGING_TEST_ITEMS * 2; op++){
+        now += rng % 3;
+        rng = rng * 1103515245 + 12345;
+        if(inserted < AGING_TEST_ITEMS && (queued == 0 || (rng >> 16) % 3 != 0)){
+            struct aging_test_item* item = &items[inserted++];
+            item->base = (double)((rng >> 8) % 200);
+            item->age_class = (rng >> 4) % 3;
+            item->inserted = now;
+            item->removed = 0;
+            if(aging_prio_queue_insert(hnd, item, item->base, item->age_class, now) != CST_OK){
+                printf("Insert Fail\n");
+                goto exit;
+            }
+            queued++;
+        }else if(queued > 0){
+            double best = 0;
+            int found = 0;
+            for(int i = 0; i < inserted; i++){
+                double p = items[i].base - rates[items[i].age_class] * (double)(now - items[i].inserted);
+                if(!items[i].removed && (!found || p < best)){
+                    best = p;
+                    found = 1;
+                }
+            }
+            aging_prio_queue_remove(hnd, &data, now);
+            struct aging_test_item* item = data;
+            double p = item->base - rates[item->age_class] * (double)(now - item->inserted);
+            if(item->removed || p != best){
+                printf("Order fail, removed %g, expected %g\n", p, best);
+                goto exit;
+            }
+            item->removed = 1;
+            queued--;
+        }
+    }
+    printf("Size (should be %d): %d\n", queued, aging_prio_queue_size(hnd));
+    while(aging_prio_queue_remove(hnd, &data, now) == CST_OK){
+        queued--;
+    }
+    if(queued != 0 || aging_prio_queue_size(hnd) != 0){
+        printf("Something went wrong, should be empty\n");
+    }
+
+exit:
+    if(hnd) {
+        aging_prio_queue_free(hnd);
+    }
+}
@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_AGING_PRIO_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_AGING_PRIO_QUEUE_TEST_H
+
+void aging_prio_queue_test(void);
+
+#endif //COMPLETEBINARYTREE_AGING_PRIO_QUEUE_TEST_H
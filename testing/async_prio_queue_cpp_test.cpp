@@ -0,0 +1,82 @@
+
+#include "async_prio_queue_cpp_test.h"
+#include "../include/async_prio_queue.hpp"
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// A coroutine which starts eagerly and destroys itself when done, enough to drive the queue without an event loop.
+struct detached{
+    struct promise_type{
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+static detached consume(cstructures::async_priority_queue<int>& queue, std::vector<int>& seen, int count){
+    for(int i = 0; i < count; i++){
+        int value = co_await queue.pop();
+        seen.push_back(value);
+    }
+}
+
+void async_prio_queue_cpp_test(void){
+    printf("\nStarting async_prio_queue_cpp_test\n\n");
+
+    // Items already queued are popped without suspending.
+    cstructures::async_priority_queue<int> queue;
+    queue.push(3);
+    queue.push(8);
+    std::vector<int> first;
+    consume(queue, first, 2);
+    if(first.size() != 2 || first[0] != 8 || first[1] != 3){
+        printf("Ready pop fail\n");
+        return;
+    }
+
+    // Consumers on an empty queue suspend and are resumed by push in the order they started waiting.
+    std::vector<int> a;
+    std::vector<int> b;
+    consume(queue, a, 1);
+    consume(queue, b, 2);
+    printf("Waiting (should be 2): %d\n", (int)queue.waiting());
+    queue.push(5);
+    printf("a got (should be 5): %d\n", a.empty() ? -1 : a[0]);
+    if(a.size() != 1 || a[0] != 5 || !b.empty()){
+        printf("Handoff fail\n");
+        return;
+    }
+
+    // A batch goes to the waiters highest priority first. b is resumed first and pops its second item from the rest.
+    std::vector<int> c;
+    consume(queue, c, 1);
+    int batch[] = {1, 7, 4, 9};
+    queue.push_range(batch, batch + 4);
+    printf("b got (should be 9 4): %d %d, c got (should be 7): %d\n", b.size() > 0 ? b[0] : -1,
+           b.size() > 1 ? b[1] : -1, c.empty() ? -1 : c[0]);
+    if(b.size() != 2 || b[0] != 9 || b[1] != 4 || c.size() != 1 || c[0] != 7){
+        printf("Batch order fail\n");
+        return;
+    }
+    std::optional<int> rest = queue.try_pop();
+    if(!rest || *rest != 1 || queue.try_pop() || queue.waiting() != 0){
+        printf("Something went wrong, should be empty\n");
+        return;
+    }
+
+    // Move only items are handed over by move.
+    cstructures::async_priority_queue<std::unique_ptr<int>, std::greater<std::unique_ptr<int>>> owned;
+    std::unique_ptr<int> got;
+    [](auto& queue, std::unique_ptr<int>& got) -> detached { got = co_await queue.pop(); }(owned, got);
+    owned.push(std::unique_ptr<int>(new int(6)));
+    printf("Owned (should be 6): %d\n", got ? *got : -1);
+    if(!got || *got != 6){
+        printf("Resume fail\n");
+    }
+}
@@ -0,0 +1,97 @@
+
+#include "async_prio_queue_test.h"
+#include "../include/async_prio_queue.h"
+#include "stdio.h"
+
+#if ASYNC_PRIO_QUEUE_ENABLED
+
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static int apq_compare(void* c1, void* c2){
+    int i1 = *(int*)c1;
+    int i2 = *(int*)c2;
+    return (i1 > i2) - (i1 < i2);
+}
+
+static int apq_readable(struct async_prio_queue_handle* hnd, int timeout){
+    struct pollfd fd = {async_prio_queue_fd(hnd), POLLIN, 0};
+    return poll(&fd, 1, timeout) == 1 && (fd.revents & POLLIN);
+}
+
+static int late = 42;
+
+static void* apq_producer(void* arg){
+    usleep(10000);
+    async_prio_queue_insert(arg, &late);
+    return NULL;
+}
+
+void async_prio_queue_test(void){
+    printf("\nStarting async_prio_queue_test\n\n");
+    struct async_prio_queue_handle *hnd = NULL;
+
+    cst_err err = async_prio_queue_init(&hnd, 2, &apq_compare);
+    if(err != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+    if(apq_readable(hnd, 0)){
+        printf("Readable while empty fail\n");
+        goto exit;
+    }
+
+    int dat[] = {5, 1, 9, 3};
+    // More items than max_size, the queue grows.
+    for(int i = 0; i < 4; i++){
+        if(async_prio_queue_insert(hnd, &dat[i]) != CST_OK){
+            printf("Insert Fail\n");
+            goto exit;
+        }
+    }
+    printf("Size (should be 4): %d\n", (int)async_prio_queue_size(hnd));
+    printf("Readable (should be 1): %d\n", apq_readable(hnd, 0));
+
+    void* data = NULL;
+    int last = -1;
+    while(async_prio_queue_remove(hnd, &data) == CST_OK){
+        printf("%d ", *(int*)data);
+        if(*(int*)data < last){
+            printf("\nOrder fail\n");
+            goto exit;
+        }
+        last = *(int*)data;
+    }
+    printf("\n");
+    if(apq_readable(hnd, 0)){
+        printf("Readable after draining fail\n");
+        goto exit;
+    }
+
+    // A consumer waiting on the descriptor is woken by an insert from another thread.
+    pthread_t producer;
+    if(pthread_create(&producer, NULL, &apq_producer, hnd) != 0){
+        printf("Something went wrong, could not start the producer\n");
+        goto exit;
+    }
+    int woken = apq_readable(hnd, 5000);
+    pthread_join(producer, NULL);
+    printf("Woken (should be 1): %d\n", woken);
+    if(!woken || async_prio_queue_remove(hnd, &data) != CST_OK || *(int*)data != 42){
+        printf("Wake fail\n");
+    }
+
+exit:
+    if(hnd) {
+        async_prio_queue_free(hnd);
+    }
+}
+
+#else
+
+void async_prio_queue_test(void){
+    printf("\nSkipping async_prio_queue_test, built without pthreads\n\n");
+}
+
+#endif
@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_ASYNC_PRIO_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_ASYNC_PRIO_QUEUE_TEST_H
+
+void async_prio_queue_test(void);
+
+#endif //COMPLETEBINARYTREE_ASYNC_PRIO_QUEUE_TEST_H
@@ -0,0 +1,74 @@
+
+#include "bucket_queue_test.h"
+#include "../include/bucket_queue.h"
+#include "stdio.h"
+
+static unsigned int level_of(void* data){
+    return (unsigned int)(*(int*)data / 10);
+}
+
+void bucket_queue_test(void){
+    printf("\nStarting bucket_queue_test\n\n");
+    struct bucket_queue_handle *hnd = NULL;
+    cst_err e = bucket_queue_init(&hnd, 200, 4, &level_of);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Levels are value / 10, so 23 and 27 share a level and keep their insertion order.
+    int dat[] = {1999,27,5,1000,23,1234,70,5000};
+
+    printf("Queue Size Initial: %d\n", bucket_queue_size(hnd));
+
+    bucket_queue_insert(hnd, &dat[0]);
+    bucket_queue_insert(hnd, &dat[1]);
+    bucket_queue_insert(hnd, &dat[2]);
+    bucket_queue_insert(hnd, &dat[3]);
+
+    cst_err insert_err = bucket_queue_insert(hnd, &dat[4]);
+    if(insert_err == CST_OK){
+        printf("Something went wrong, should have failed\n");
+        goto exit;
+    }
+
+    cst_err insert_err2 = bucket_queue_resize(hnd, 20);
+    if(insert_err2 != CST_OK){
+        printf("Resize Failed\n");
+        goto exit;
+    }
+    bucket_queue_insert(hnd, &dat[4]);
+    bucket_queue_insert(hnd, &dat[5]);
+    bucket_queue_insert(hnd, &dat[6]);
+
+    cst_err range_err = bucket_queue_insert(hnd, &dat[7]);
+    if(range_err != CST_PARAM_ERR){
+        printf("Something went wrong, priority should be out of range\n");
+        goto exit;
+    }
+
+    printf("Queue Size Inserted: %d\n", bucket_queue_size(hnd));
+
+    void* out[7];
+    for(int i = 0; i < 7; i++){
+        bucket_queue_remove(hnd, &out[i]);
+    }
+
+    printf("Printing values:\n");
+
+    printf("[ %d , %d , %d , %d , %d , %d , %d ]\n", *(int*)out[0], *(int*)out[1], *(int*)out[2], *(int*)out[3],
+           *(int*)out[4], *(int*)out[5], *(int*)out[6]);
+
+    void* none = NULL;
+    if(bucket_queue_remove(hnd, &none) != CST_EMPTY){
+        printf("fail\n");
+        goto exit;
+    }
+
+    printf("Queue size final: %d\n", bucket_queue_size(hnd));
+
+exit:
+    if(hnd) {
+        bucket_queue_free(hnd);
+    }
+}
@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_BUCKET_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_BUCKET_QUEUE_TEST_H
+
+void bucket_queue_test(void);
+
+#endif //COMPLETEBINARYTREE_BUCKET_QUEUE_TEST_H
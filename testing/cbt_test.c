@@ -3,6 +3,7 @@
 #include "../include/cbt.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 void test_cbt(){
 
@@ -120,4 +121,58 @@ void test_cbt(){
     }
 
     cbt_free(hnd);
-}
\ No newline at end of file
+}
+
+// Counts the blocks handed out and checks that every free gets the size its block was allocated with.
+struct counting_allocator{
+    int live;
+    size_t sizes[4];
+    int bad_free;
+};
+
+static void* counting_alloc(size_t size, void* ctx){
+    struct counting_allocator* counter = ctx;
+    if(counter->live == 4){
+        return NULL;
+    }
+    counter->sizes[counter->live++] = size;
+    return malloc(size);
+}
+
+static void counting_free(void* ptr, size_t size, void* ctx){
+    struct counting_allocator* counter = ctx;
+    counter->bad_free |= counter->live == 0 || counter->sizes[0] != size;
+    for(int i = 1; i < counter->live; i++){
+        counter->sizes[i - 1] = counter->sizes[i];
+    }
+    counter->live--;
+    free(ptr);
+}
+
+void test_cbt_allocator(){
+    printf("\nStarting test_cbt_allocator\n\n");
+    struct counting_allocator counter = { 0, {0}, 0 };
+    struct cbt_allocator allocator = { &counting_alloc, &counting_free, &counter };
+    struct cbt_handle *hnd = NULL;
+    if(cbt_init_allocator(&hnd, 2, &allocator) != CST_OK || counter.live != 1){
+        printf("Init Fail\n");
+        return;
+    }
+
+    int dat[] = {1,2,3};
+    cbt_insert(hnd, &dat[0]);
+    cbt_insert(hnd, &dat[1]);
+#if CBT_RESIZE_ENABLED
+    // Growing takes the new array from the allocator and hands the old one back.
+    if(cbt_resize(hnd, 4) != CST_OK || counter.live != 1 || cbt_insert(hnd, &dat[2]) == NULL){
+        printf("Resize with allocator went wrong\n");
+    }
+#endif
+    printf("Tree Size: %d\n", cbt_size(hnd));
+    printf("Root: %d\n", *(int*)cbt_get_data(cbt_get_root(hnd)));
+
+    cbt_free(hnd);
+    if(counter.live != 0 || counter.bad_free){
+        printf("Allocator went wrong, %d blocks left\n", counter.live);
+    }
+}
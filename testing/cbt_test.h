@@ -3,4 +3,6 @@
 
 void test_cbt();
 
+void test_cbt_allocator();
+
 #endif //COMPLETEBINARYTREE_CBT_TEST_H
@@ -0,0 +1,675 @@
+
+#include "differential_test.h"
+#include "../include/prio_queue.h"
+#include "../include/bucket_queue.h"
+#include "../include/aging_prio_queue.h"
+#include "../include/ext_prio_queue.h"
+#include "../include/mmap_prio_queue.h"
+#include "../include/async_prio_queue.h"
+#include "../include/sharded_prio_queue.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+
+#define DIFF_MAX_OPS 8192      /** Longer inputs are cut, the model is a sorted array. */
+#define DIFF_INITIAL_SIZE 4    /** Queues start this small so every variant grows while it runs. */
+#define DIFF_INGRESS_RING 8    /** A small ring, pushes regularly find it full. */
+#define DIFF_EXT_MEMORY 16     /** Items the external queue keeps in memory before writing a run. */
+#define DIFF_SHARDS 4          /** Shards of the relaxed sharded variant. */
+#define DIFF_TEST_RUNS 150
+#define DIFF_TEST_MAX_OPS 1500
+
+// Operation codes, taken from the low three bits of a byte. Half of all bytes insert.
+#define DIFF_OP_REMOVE 4
+#define DIFF_OP_PEEK 6
+#define DIFF_OP_ERASE 7
+
+struct diff_item{
+    uint64_t key;
+    size_t id;
+};
+
+struct diff_queue;
+
+/** One queue implementation behind a common interface, peek and erase are NULL where the queue has none. */
+struct diff_variant{
+    const char* name;
+    int relaxed;    // Removes may return any queued item, not only one with the lowest key.
+    cst_err (*init)(struct diff_queue* q, size_t max_items);
+    void (*free)(struct diff_queue* q);
+    cst_err (*insert)(struct diff_queue* q, struct diff_item* item);
+    cst_err (*remove)(struct diff_queue* q, struct diff_item** item);
+    cst_err (*peek)(struct diff_queue* q, struct diff_item** item);
+    cst_err (*erase)(struct diff_queue* q, struct diff_item* item);
+    size_t (*size)(struct diff_queue* q);
+};
+
+/** A variant under test and the items it should hold, sorted by key. */
+struct diff_queue{
+    const struct diff_variant* variant;
+    void* hnd;
+    size_t capacity;    // Grown by the variants which resize by hand.
+    struct diff_item** model;
+    size_t count;
+};
+
+static int diff_compare(void* c1, void* c2){
+    uint64_t k1 = ((struct diff_item*)c1)->key;
+    uint64_t k2 = ((struct diff_item*)c2)->key;
+    if(k1 > k2){
+        return 1;
+    } else if(k1 < k2){
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
+// prio_queue, grown by hand since it does not resize itself. Queues which are grown start at q->capacity.
+
+static cst_err diff_pq_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return prio_queue_init((struct prio_queue_handle**)&q->hnd, q->capacity, &diff_compare);
+}
+
+static cst_err diff_pq_erase_init(struct diff_queue* q, size_t max_items){
+    cst_err e = diff_pq_init(q, max_items);
+    if(e == CST_OK){
+        e = prio_queue_set_erase(q->hnd, NULL, PRIO_QUEUE_ERASE_FRACTION);
+    }
+    return e;
+}
+
+static void diff_pq_free(struct diff_queue* q){
+    prio_queue_free(q->hnd);
+}
+
+static cst_err diff_pq_insert(struct diff_queue* q, struct diff_item* item){
+    cst_err e = prio_queue_insert(q->hnd, item);
+#if PRIO_QUEUE_RESIZE_ENABLED
+    if(e == CST_OVERFLOW){
+        q->capacity *= 2;
+        e = prio_queue_resize(q->hnd, q->capacity);
+        if(e == CST_OK){
+            e = prio_queue_insert(q->hnd, item);
+        }
+    }
+#endif
+    return e;
+}
+
+static cst_err diff_pq_remove(struct diff_queue* q, struct diff_item** item){
+    return prio_queue_remove(q->hnd, (void**)item);
+}
+
+static cst_err diff_pq_peek(struct diff_queue* q, struct diff_item** item){
+    return prio_queue_peek(q->hnd, (void**)item);
+}
+
+static cst_err diff_pq_erase(struct diff_queue* q, struct diff_item* item){
+    return prio_queue_erase_lazy(q->hnd, item);
+}
+
+static size_t diff_pq_size(struct diff_queue* q){
+    return (size_t)prio_queue_size(q->hnd);
+}
+
+#if PRIO_QUEUE_INGRESS_ENABLED
+
+// prio_queue fed through its ingress ring, the heap holds every item so a drain always empties the ring.
+
+static cst_err diff_ingress_init(struct diff_queue* q, size_t max_items){
+    cst_err e = prio_queue_init((struct prio_queue_handle**)&q->hnd, max_items + 1, &diff_compare);
+    if(e == CST_OK){
+        e = prio_queue_attach_ingress(q->hnd, DIFF_INGRESS_RING);
+    }
+    if(e == CST_OK){
+        e = prio_queue_set_erase(q->hnd, NULL, PRIO_QUEUE_ERASE_FRACTION);
+    }
+    return e;
+}
+
+static cst_err diff_ingress_insert(struct diff_queue* q, struct diff_item* item){
+    cst_err e = prio_queue_push_ingress(q->hnd, item);
+    if(e == CST_OVERFLOW){
+        prio_queue_drain_ingress(q->hnd);
+        e = prio_queue_push_ingress(q->hnd, item);
+    }
+    return e;
+}
+
+static size_t diff_ingress_size(struct diff_queue* q){
+    prio_queue_drain_ingress(q->hnd);
+    return (size_t)prio_queue_size(q->hnd);
+}
+
+#endif
+
+// bucket_queue, keys are the levels.
+
+static unsigned int diff_bucket_priority(void* data){
+    return (unsigned int)((struct diff_item*)data)->key;
+}
+
+static cst_err diff_bucket_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return bucket_queue_init((struct bucket_queue_handle**)&q->hnd, 256, q->capacity, &diff_bucket_priority);
+}
+
+static void diff_bucket_free(struct diff_queue* q){
+    bucket_queue_free(q->hnd);
+}
+
+static cst_err diff_bucket_insert(struct diff_queue* q, struct diff_item* item){
+    cst_err e = bucket_queue_insert(q->hnd, item);
+#if BUCKET_QUEUE_RESIZE_ENABLED
+    if(e == CST_OVERFLOW){
+        q->capacity *= 2;
+        e = bucket_queue_resize(q->hnd, q->capacity);
+        if(e == CST_OK){
+            e = bucket_queue_insert(q->hnd, item);
+        }
+    }
+#endif
+    return e;
+}
+
+static cst_err diff_bucket_remove(struct diff_queue* q, struct diff_item** item){
+    return bucket_queue_remove(q->hnd, (void**)item);
+}
+
+static cst_err diff_bucket_peek(struct diff_queue* q, struct diff_item** item){
+    return bucket_queue_peek(q->hnd, (void**)item);
+}
+
+static size_t diff_bucket_size(struct diff_queue* q){
+    return (size_t)bucket_queue_size(q->hnd);
+}
+
+// aging_prio_queue with a single class which does not age, the clock stays at 0.
+
+static cst_err diff_aging_init(struct diff_queue* q, size_t max_items){
+    double rate = 0;
+    (void)max_items;
+    return aging_prio_queue_init((struct aging_prio_queue_handle**)&q->hnd, q->capacity, &rate, 1, 0);
+}
+
+static void diff_aging_free(struct diff_queue* q){
+    aging_prio_queue_free(q->hnd);
+}
+
+static cst_err diff_aging_insert(struct diff_queue* q, struct diff_item* item){
+    cst_err e = aging_prio_queue_insert(q->hnd, item, (double)item->key, 0, 0);
+#if AGING_PRIO_QUEUE_RESIZE_ENABLED
+    if(e == CST_OVERFLOW){
+        q->capacity *= 2;
+        e = aging_prio_queue_resize(q->hnd, q->capacity);
+        if(e == CST_OK){
+            e = aging_prio_queue_insert(q->hnd, item, (double)item->key, 0, 0);
+        }
+    }
+#endif
+    return e;
+}
+
+static cst_err diff_aging_remove(struct diff_queue* q, struct diff_item** item){
+    return aging_prio_queue_remove(q->hnd, (void**)item, 0);
+}
+
+static cst_err diff_aging_peek(struct diff_queue* q, struct diff_item** item){
+    double priority = 0;
+    cst_err e = aging_prio_queue_peek(q->hnd, (void**)item, &priority, 0);
+    if(e == CST_OK && priority != (double)(*item)->key){
+        return CST_FAIL;
+    }
+    return e;
+}
+
+static size_t diff_aging_size(struct diff_queue* q){
+    return (size_t)aging_prio_queue_size(q->hnd);
+}
+
+// ext_prio_queue, the pointer itself goes to disk so items keep their identity.
+
+static size_t diff_ext_serialize(void* data, void* buf, size_t cap){
+    if(cap >= sizeof(data)){
+        memcpy(buf, &data, sizeof(data));
+    }
+    return sizeof(data);
+}
+
+static void* diff_ext_deserialize(const void* buf, size_t len){
+    void* data = NULL;
+    if(len == sizeof(data)){
+        memcpy(&data, buf, sizeof(data));
+    }
+    return data;
+}
+
+static const struct ext_prio_queue_serializer diff_ext_serializer = { &diff_ext_serialize, &diff_ext_deserialize, NULL };
+
+static cst_err diff_ext_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return ext_prio_queue_init((struct ext_prio_queue_handle**)&q->hnd, NULL, DIFF_EXT_MEMORY, &diff_compare,
+                               &diff_ext_serializer);
+}
+
+static void diff_ext_free(struct diff_queue* q){
+    ext_prio_queue_free(q->hnd);
+}
+
+static cst_err diff_ext_insert(struct diff_queue* q, struct diff_item* item){
+    return ext_prio_queue_insert(q->hnd, item);
+}
+
+static cst_err diff_ext_remove(struct diff_queue* q, struct diff_item** item){
+    return ext_prio_queue_remove(q->hnd, (void**)item);
+}
+
+static size_t diff_ext_size(struct diff_queue* q){
+    return ext_prio_queue_size(q->hnd);
+}
+
+// mmap_prio_queue, the key is inline and the payload is the item pointer.
+
+static char diff_mmap_path[64];
+
+static cst_err diff_mmap_init(struct diff_queue* q, size_t max_items){
+    snprintf(diff_mmap_path, sizeof(diff_mmap_path), "%s/cstructures_diff_%ld.pq", P_tmpdir, (long)getpid());
+    remove(diff_mmap_path);
+    (void)max_items;
+    return mmap_prio_queue_open((struct mmap_prio_queue_handle**)&q->hnd, diff_mmap_path, sizeof(void*), q->capacity,
+                                0);
+}
+
+static void diff_mmap_free(struct diff_queue* q){
+    mmap_prio_queue_close(q->hnd);
+    remove(diff_mmap_path);
+}
+
+static cst_err diff_mmap_insert(struct diff_queue* q, struct diff_item* item){
+    cst_err e = mmap_prio_queue_insert(q->hnd, item->key, &item);
+#if MMAP_PRIO_QUEUE_RESIZE_ENABLED
+    if(e == CST_OVERFLOW){
+        q->capacity *= 2;
+        e = mmap_prio_queue_resize(q->hnd, q->capacity);
+        if(e == CST_OK){
+            e = mmap_prio_queue_insert(q->hnd, item->key, &item);
+        }
+    }
+#endif
+    return e;
+}
+
+// The stored key has to come back with the payload it was inserted with.
+static cst_err diff_mmap_remove(struct diff_queue* q, struct diff_item** item){
+    uint64_t key = 0;
+    cst_err e = mmap_prio_queue_remove(q->hnd, &key, item);
+    if(e == CST_OK && key != (*item)->key){
+        return CST_FAIL;
+    }
+    return e;
+}
+
+static cst_err diff_mmap_peek(struct diff_queue* q, struct diff_item** item){
+    uint64_t key = 0;
+    cst_err e = mmap_prio_queue_peek(q->hnd, &key, item);
+    if(e == CST_OK && key != (*item)->key){
+        return CST_FAIL;
+    }
+    return e;
+}
+
+static size_t diff_mmap_size(struct diff_queue* q){
+    return mmap_prio_queue_size(q->hnd);
+}
+
+#if ASYNC_PRIO_QUEUE_ENABLED
+
+// async_prio_queue, it grows by itself.
+
+static cst_err diff_async_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return async_prio_queue_init((struct async_prio_queue_handle**)&q->hnd, q->capacity, &diff_compare);
+}
+
+static void diff_async_free(struct diff_queue* q){
+    async_prio_queue_free(q->hnd);
+}
+
+static cst_err diff_async_insert(struct diff_queue* q, struct diff_item* item){
+    return async_prio_queue_insert(q->hnd, item);
+}
+
+static cst_err diff_async_remove(struct diff_queue* q, struct diff_item** item){
+    return async_prio_queue_remove(q->hnd, (void**)item);
+}
+
+static size_t diff_async_size(struct diff_queue* q){
+    return async_prio_queue_size(q->hnd);
+}
+
+#endif
+
+#if SHARDED_PRIO_QUEUE_ENABLED
+
+// sharded_prio_queue, exact with one shard and relaxed with items spread over several.
+
+static cst_err diff_sharded_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return sharded_prio_queue_init((struct sharded_prio_queue_handle**)&q->hnd, 1, q->capacity, &diff_compare);
+}
+
+static cst_err diff_sharded_spread_init(struct diff_queue* q, size_t max_items){
+    (void)max_items;
+    return sharded_prio_queue_init((struct sharded_prio_queue_handle**)&q->hnd, DIFF_SHARDS, q->capacity,
+                                   &diff_compare);
+}
+
+static void diff_sharded_free(struct diff_queue* q){
+    sharded_prio_queue_free(q->hnd);
+}
+
+static cst_err diff_sharded_insert(struct diff_queue* q, struct diff_item* item){
+    return sharded_prio_queue_insert(q->hnd, item);
+}
+
+static cst_err diff_sharded_spread_insert(struct diff_queue* q, struct diff_item* item){
+    return sharded_prio_queue_insert_shard(q->hnd, item->id % DIFF_SHARDS, item);
+}
+
+static cst_err diff_sharded_remove(struct diff_queue* q, struct diff_item** item){
+    return sharded_prio_queue_remove(q->hnd, (void**)item);
+}
+
+static size_t diff_sharded_size(struct diff_queue* q){
+    return sharded_prio_queue_size(q->hnd);
+}
+
+#endif
+
+static const struct diff_variant diff_variants[] = {
+    { "prio_queue", 0, &diff_pq_init, &diff_pq_free, &diff_pq_insert, &diff_pq_remove, &diff_pq_peek, NULL,
+      &diff_pq_size },
+    { "prio_queue erase", 0, &diff_pq_erase_init, &diff_pq_free, &diff_pq_insert, &diff_pq_remove, &diff_pq_peek,
+      &diff_pq_erase, &diff_pq_size },
+#if PRIO_QUEUE_INGRESS_ENABLED
+    { "prio_queue ingress", 0, &diff_ingress_init, &diff_pq_free, &diff_ingress_insert, &diff_pq_remove,
+      &diff_pq_peek, &diff_pq_erase, &diff_ingress_size },
+#endif
+    { "bucket_queue", 0, &diff_bucket_init, &diff_bucket_free, &diff_bucket_insert, &diff_bucket_remove,
+      &diff_bucket_peek, NULL, &diff_bucket_size },
+    { "aging_prio_queue", 0, &diff_aging_init, &diff_aging_free, &diff_aging_insert, &diff_aging_remove,
+      &diff_aging_peek, NULL, &diff_aging_size },
+    { "ext_prio_queue", 0, &diff_ext_init, &diff_ext_free, &diff_ext_insert, &diff_ext_remove, NULL, NULL,
+      &diff_ext_size },
+    { "mmap_prio_queue", 0, &diff_mmap_init, &diff_mmap_free, &diff_mmap_insert, &diff_mmap_remove,
+      &diff_mmap_peek, NULL, &diff_mmap_size },
+#if ASYNC_PRIO_QUEUE_ENABLED
+    { "async_prio_queue", 0, &diff_async_init, &diff_async_free, &diff_async_insert, &diff_async_remove, NULL,
+      NULL, &diff_async_size },
+#endif
+#if SHARDED_PRIO_QUEUE_ENABLED
+    { "sharded_prio_queue", 0, &diff_sharded_init, &diff_sharded_free, &diff_sharded_insert, &diff_sharded_remove,
+      NULL, NULL, &diff_sharded_size },
+    { "sharded_prio_queue spread", 1, &diff_sharded_spread_init, &diff_sharded_free, &diff_sharded_spread_insert,
+      &diff_sharded_remove, NULL, NULL, &diff_sharded_size },
+#endif
+};
+
+#define DIFF_VARIANTS (sizeof(diff_variants) / sizeof(diff_variants[0]))
+
+// Index of the first model entry with a key of at least key.
+static size_t __diff_model_lower(struct diff_queue* q, uint64_t key){
+    size_t lo = 0, hi = q->count;
+    while(lo < hi){
+        size_t mid = lo + (hi - lo) / 2;
+        if(q->model[mid]->key < key){
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void __diff_model_insert(struct diff_queue* q, struct diff_item* item){
+    size_t at = __diff_model_lower(q, item->key + 1);
+    memmove(&q->model[at + 1], &q->model[at], (q->count - at) * sizeof(*q->model));
+    q->model[at] = item;
+    q->count++;
+}
+
+// Returns the model index of exactly this item, or q->count if it is not queued.
+static size_t __diff_model_find(struct diff_queue* q, struct diff_item* item){
+    for(size_t at = __diff_model_lower(q, item->key); at < q->count && q->model[at]->key == item->key; at++){
+        if(q->model[at] == item){
+            return at;
+        }
+    }
+    return q->count;
+}
+
+static void __diff_model_erase(struct diff_queue* q, size_t at){
+    memmove(&q->model[at], &q->model[at + 1], (q->count - at - 1) * sizeof(*q->model));
+    q->count--;
+}
+
+// Checks an item handed out by remove or peek, returns its model index or q->count after printing the mismatch.
+static size_t __diff_check_top(struct diff_queue* q, struct diff_item* item, size_t op, const char* what){
+    size_t at = __diff_model_find(q, item);
+    if(at == q->count){
+        printf("Differential fail, %s at op %zu: %s returned an item which is not queued\n", q->variant->name, op,
+               what);
+    } else if(!q->variant->relaxed && item->key != q->model[0]->key){
+        printf("Differential fail, %s at op %zu: %s returned key %llu, expected %llu\n", q->variant->name, op, what,
+               (unsigned long long)item->key, (unsigned long long)q->model[0]->key);
+        at = q->count;
+    }
+    return at;
+}
+
+static int __diff_remove(struct diff_queue* q, size_t op){
+    struct diff_item* item = NULL;
+    cst_err e = q->variant->remove(q, &item);
+    if(q->count == 0){
+        if(e != CST_EMPTY){
+            printf("Differential fail, %s at op %zu: remove on an empty queue returned %d\n", q->variant->name, op, e);
+            return -1;
+        }
+        return 0;
+    }
+    if(e != CST_OK){
+        printf("Differential fail, %s at op %zu: remove returned %d\n", q->variant->name, op, e);
+        return -1;
+    }
+    size_t at = __diff_check_top(q, item, op, "remove");
+    if(at == q->count){
+        return -1;
+    }
+    __diff_model_erase(q, at);
+    return 0;
+}
+
+static int __diff_peek(struct diff_queue* q, size_t op){
+    struct diff_item* item = NULL;
+    cst_err e = q->variant->peek(q, &item);
+    if(q->count == 0){
+        if(e != CST_EMPTY){
+            printf("Differential fail, %s at op %zu: peek on an empty queue returned %d\n", q->variant->name, op, e);
+            return -1;
+        }
+        return 0;
+    }
+    if(e != CST_OK){
+        printf("Differential fail, %s at op %zu: peek returned %d\n", q->variant->name, op, e);
+        return -1;
+    }
+    return __diff_check_top(q, item, op, "peek") == q->count ? -1 : 0;
+}
+
+int differential_run(const uint8_t* data, size_t size){
+    if(size > DIFF_MAX_OPS){
+        size = DIFF_MAX_OPS;
+    }
+    int result = -1;
+    size_t queues = 0;
+    struct diff_queue q[DIFF_VARIANTS];
+    struct diff_item* items = malloc((size + 1) * sizeof(*items));
+    if(items == NULL){
+        printf("Differential fail: out of memory\n");
+        return -1;
+    }
+
+    for(; queues < DIFF_VARIANTS; queues++){
+        q[queues].variant = &diff_variants[queues];
+        q[queues].count = 0;
+        q[queues].hnd = NULL;
+        q[queues].capacity = CSTRUCTURES_GLOBAL_RESIZE_ENABLE ? DIFF_INITIAL_SIZE : size + 1;
+        q[queues].model = malloc((size + 1) * sizeof(*q[queues].model));
+        if(q[queues].model == NULL || q[queues].variant->init(&q[queues], size) != CST_OK){
+            printf("Differential fail, %s: init failed\n", q[queues].variant->name);
+            if(q[queues].hnd != NULL){
+                q[queues].variant->free(&q[queues]);
+            }
+            free(q[queues].model);
+            goto exit;
+        }
+    }
+
+    size_t inserted = 0;
+    size_t i = 0;
+    while(i < size){
+        size_t op = i;
+        uint8_t code = data[i++] & 7;
+        // Inserts and erases read one more byte, a missing one counts as 0.
+        uint8_t arg = 0;
+        if((code < DIFF_OP_REMOVE || code == DIFF_OP_ERASE) && i < size){
+            arg = data[i++];
+        }
+        if(code < DIFF_OP_REMOVE){
+            struct diff_item* item = &items[inserted];
+            item->key = arg;
+            item->id = inserted++;
+            for(size_t v = 0; v < queues; v++){
+                cst_err e = q[v].variant->insert(&q[v], item);
+                if(e != CST_OK){
+                    printf("Differential fail, %s at op %zu: insert returned %d\n", q[v].variant->name, op, e);
+                    goto exit;
+                }
+                __diff_model_insert(&q[v], item);
+            }
+        } else if(code < DIFF_OP_PEEK){
+            for(size_t v = 0; v < queues; v++){
+                if(__diff_remove(&q[v], op) != 0){
+                    goto exit;
+                }
+            }
+        } else if(code == DIFF_OP_PEEK){
+            for(size_t v = 0; v < queues; v++){
+                if(q[v].variant->peek != NULL && __diff_peek(&q[v], op) != 0){
+                    goto exit;
+                }
+            }
+        } else {
+            for(size_t v = 0; v < queues; v++){
+                if(q[v].variant->erase == NULL || q[v].count == 0){
+                    continue;
+                }
+                size_t at = arg % q[v].count;
+                cst_err e = q[v].variant->erase(&q[v], q[v].model[at]);
+                if(e != CST_OK){
+                    printf("Differential fail, %s at op %zu: erase returned %d\n", q[v].variant->name, op, e);
+                    goto exit;
+                }
+                __diff_model_erase(&q[v], at);
+            }
+        }
+        for(size_t v = 0; v < queues; v++){
+            size_t queued = q[v].variant->size(&q[v]);
+            if(queued != q[v].count){
+                printf("Differential fail, %s at op %zu: size %zu, expected %zu\n", q[v].variant->name, op, queued,
+                       q[v].count);
+                goto exit;
+            }
+        }
+    }
+
+    // Everything left has to come out in order, followed by CST_EMPTY.
+    for(size_t v = 0; v < queues; v++){
+        while(q[v].count > 0){
+            if(__diff_remove(&q[v], size) != 0){
+                goto exit;
+            }
+        }
+        if(__diff_remove(&q[v], size) != 0){
+            goto exit;
+        }
+    }
+    result = 0;
+
+    exit:
+    for(size_t v = 0; v < queues; v++){
+        q[v].variant->free(&q[v]);
+        free(q[v].model);
+    }
+    free(items);
+    return result;
+}
+
+static uint32_t diff_rng = 2463534242u;
+
+static uint32_t __diff_rng_next(void){
+    diff_rng ^= diff_rng << 13;
+    diff_rng ^= diff_rng >> 17;
+    diff_rng ^= diff_rng << 5;
+    return diff_rng;
+}
+
+void differential_test(void){
+    printf("\nStarting differential_test\n\n");
+    uint8_t* data = malloc(DIFF_TEST_MAX_OPS * 2);
+    if(data == NULL){
+        printf("Alloc Fail\n");
+        return;
+    }
+
+    // Ascending, descending and equal keys, all inserted before anything is removed.
+    size_t half = DIFF_TEST_MAX_OPS / 2;
+    for(int pattern = 0; pattern < 3; pattern++){
+        for(size_t i = 0; i < half; i++){
+            data[i * 2] = 0;
+            data[i * 2 + 1] = (uint8_t)(pattern == 0 ? i : pattern == 1 ? half - i : 42);
+        }
+        memset(&data[half * 2], DIFF_OP_REMOVE, half);
+        if(differential_run(data, half * 3) != 0){
+            printf("Differential fail for pattern %d\n", pattern);
+            goto exit;
+        }
+    }
+
+    // Random sequences, each with its own share of inserts so queues grow, hover and shrink.
+    for(int run = 0; run < DIFF_TEST_RUNS; run++){
+        uint32_t seed = diff_rng;
+        size_t length = __diff_rng_next() % (DIFF_TEST_MAX_OPS * 2);
+        uint32_t inserts = 30 + __diff_rng_next() % 60;
+        uint32_t keys = 1 + __diff_rng_next() % 256;
+        for(size_t i = 0; i < length;){
+            uint32_t r = __diff_rng_next();
+            uint8_t code = (uint8_t)(r % 100 < inserts ? r >> 8 & 3 : DIFF_OP_REMOVE + (r >> 8) % 4);
+            data[i++] = code;
+            if((code < DIFF_OP_REMOVE || code == DIFF_OP_ERASE) && i < length){
+                data[i++] = (uint8_t)((r >> 16) % keys);
+            }
+        }
+        if(differential_run(data, length) != 0){
+            printf("Differential fail for run %d, seed %u, length %zu\n", run, (unsigned int)seed, length);
+            goto exit;
+        }
+    }
+    printf("%d sequences matched the model\n", DIFF_TEST_RUNS + 3);
+
+    exit:
+    free(data);
+}
@@ -0,0 +1,20 @@
+
+#ifndef COMPLETEBINARYTREE_DIFFERENTIAL_TEST_H
+#define COMPLETEBINARYTREE_DIFFERENTIAL_TEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Runs one operation sequence against every queue variant and a sorted reference model.
+ *
+ * Every byte selects an operation, inserts take their key from the following byte and erases pick the item. Shared by
+ * differential_test and the fuzz target prio_queue_fuzz.
+ *
+ * @return 0 if every variant matched the model, -1 after printing the first mismatch.
+ */
+int differential_run(const uint8_t* data, size_t size);
+
+void differential_test(void);
+
+#endif //COMPLETEBINARYTREE_DIFFERENTIAL_TEST_H
@@ -0,0 +1,190 @@
+
+#include "ext_prio_queue_test.h"
+#include "../include/ext_prio_queue.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+
+static int ext_compare(void* c1, void* c2){
+    int i1 = *(int*)c1;
+    int i2 = *(int*)c2;
+    if(i1 > i2){
+        return 1;
+    } else if(i1 < i2){
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
+static size_t ext_serialize(void* data, void* buf, size_t cap){
+    if(cap >= sizeof(int)){
+        memcpy(buf, data, sizeof(int));
+    }
+    return sizeof(int);
+}
+
+static int ext_fail_in = -1;    // Counts down reads, the read which reaches 0 fails.
+
+static void* ext_deserialize(const void* buf, size_t len){
+    if(ext_fail_in >= 0 && ext_fail_in-- == 0){
+        return NULL;
+    }
+    int* data = malloc(sizeof(int));
+    if(data != NULL && len == sizeof(int)){
+        memcpy(data, buf, sizeof(int));
+    }
+    return data;
+}
+
+static void ext_release(void* data){
+    free(data);
+}
+
+void ext_prio_queue_test(void){
+    printf("\nStarting ext_prio_queue_test\n\n");
+    struct ext_prio_queue_serializer serializer = { &ext_serialize, &ext_deserialize, &ext_release };
+    struct ext_prio_queue_handle *hnd = NULL;
+    // Only four items fit in memory, everything else goes to disk.
+    cst_err e = ext_prio_queue_init(&hnd, NULL, 4, &ext_compare, &serializer);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    int dat[] = {23,267,5,7,1,1000,10,8,42,3,99,-4,17};
+    for(int i = 0; i < 13; i++){
+        int* item = malloc(sizeof(int));
+        *item = dat[i];
+        if(ext_prio_queue_insert(hnd, item) != CST_OK){
+            printf("Insert Failed\n");
+            free(item);
+            goto exit;
+        }
+        // Take one out half way through, it has to come from a mix of disk and memory.
+        if(i == 8){
+            void* first = NULL;
+            ext_prio_queue_remove(hnd, &first);
+            printf("Removed early (should be 1): %d\n", *(int*)first);
+            free(first);
+        }
+    }
+
+    printf("Queue Size Inserted: %d\n", (int)ext_prio_queue_size(hnd));
+    printf("Runs on disk: %d\n", (int)ext_prio_queue_runs(hnd));
+
+    int out[12];
+    for(int i = 0; i < 12; i++){
+        void* item = NULL;
+        if(ext_prio_queue_remove(hnd, &item) != CST_OK){
+            printf("fail\n");
+            goto exit;
+        }
+        out[i] = *(int*)item;
+        free(item);
+    }
+
+    printf("Printing values:\n");
+    printf("[ %d , %d , %d , %d , %d , %d , %d , %d , %d , %d , %d , %d ]\n", out[0], out[1], out[2], out[3], out[4],
+           out[5], out[6], out[7], out[8], out[9], out[10], out[11]);
+
+    void* none = NULL;
+    if(ext_prio_queue_remove(hnd, &none) != CST_EMPTY){
+        printf("fail\n");
+        goto exit;
+    }
+
+    printf("Queue size final: %d\n", (int)ext_prio_queue_size(hnd));
+
+exit:
+    if(hnd) {
+        ext_prio_queue_free(hnd);
+    }
+}
+
+void ext_prio_queue_recovery_test(void){
+    printf("\nStarting ext_prio_queue_recovery_test\n\n");
+    struct ext_prio_queue_serializer serializer = { &ext_serialize, &ext_deserialize, &ext_release };
+    struct ext_prio_queue_handle *hnd = NULL;
+    if(ext_prio_queue_init(&hnd, NULL, 4, &ext_compare, &serializer) != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Fill until the runs are merged, the first merge breaks off part way through reading the runs.
+    uint32_t rng = 777;
+    int inserted = 0;
+    int merge_failed = 0;
+    while(!merge_failed || ext_prio_queue_runs(hnd) == EXT_PRIO_QUEUE_MAX_RUNS){
+        int* item = malloc(sizeof(int));
+        rng = rng * 1103515245 + 12345;
+        *item = (int)((rng >> 8) % 1000);
+        if(!merge_failed && ext_prio_queue_runs(hnd) == EXT_PRIO_QUEUE_MAX_RUNS){
+            ext_fail_in = 20;
+        }
+        cst_err e = ext_prio_queue_insert(hnd, item);
+        if(e != CST_OK){
+            if(merge_failed || ext_fail_in != -1){
+                printf("Insert Fail\n");
+                free(item);
+                goto exit;
+            }
+            merge_failed = 1;
+            if(ext_prio_queue_size(hnd) != (size_t)inserted || ext_prio_queue_runs(hnd) != EXT_PRIO_QUEUE_MAX_RUNS){
+                printf("Failed merge changed the queue, fail\n");
+                free(item);
+                goto exit;
+            }
+            e = ext_prio_queue_insert(hnd, item);
+        }
+        if(e != CST_OK){
+            printf("Insert Fail\n");
+            free(item);
+            goto exit;
+        }
+        inserted++;
+    }
+    ext_fail_in = -1;
+    printf("Items: %d, runs after the merge: %d\n", inserted, (int)ext_prio_queue_runs(hnd));
+    if(!merge_failed){
+        printf("Merge never failed, fail\n");
+        goto exit;
+    }
+
+    // Reading a run breaks once while draining, nothing may be lost and the order has to hold.
+    int removed = 0;
+    int last = -1;
+    int remove_failed = 0;
+    ext_fail_in = 0;
+    while(removed < inserted){
+        void* item = NULL;
+        cst_err e = ext_prio_queue_remove(hnd, &item);
+        if(e != CST_OK){
+            if(remove_failed || ext_prio_queue_size(hnd) != (size_t)(inserted - removed)){
+                printf("Remove fail\n");
+                goto exit;
+            }
+            remove_failed = 1;
+            continue;
+        }
+        if(*(int*)item < last){
+            printf("Order fail\n");
+            free(item);
+            goto exit;
+        }
+        last = *(int*)item;
+        free(item);
+        removed++;
+    }
+    printf("Removed %d items after a broken read\n", removed);
+    if(!remove_failed || ext_prio_queue_size(hnd) != 0){
+        printf("Remove fail\n");
+    }
+
+exit:
+    ext_fail_in = -1;
+    if(hnd) {
+        ext_prio_queue_free(hnd);
+    }
+}
@@ -0,0 +1,9 @@
+
+#ifndef COMPLETEBINARYTREE_EXT_PRIO_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_EXT_PRIO_QUEUE_TEST_H
+
+void ext_prio_queue_test(void);
+
+void ext_prio_queue_recovery_test(void);
+
+#endif //COMPLETEBINARYTREE_EXT_PRIO_QUEUE_TEST_H
@@ -0,0 +1,95 @@
+
+#include "kway_merge_test.h"
+#include "../include/kway_merge.h"
+#include "stdio.h"
+
+struct kway_test_source{
+    int* items;
+    size_t count;
+    size_t next;
+};
+
+static int kway_compare(void* c1, void* c2){
+    int i1 = *(int*)c1;
+    int i2 = *(int*)c2;
+    return (i1 > i2) - (i1 < i2);
+}
+
+// Hands out at most 3 items per call to exercise refilling.
+static size_t kway_pull(void* ctx, void** items, size_t cap){
+    struct kway_test_source* source = ctx;
+    size_t count = 0;
+    while(count < cap && count < 3 && source->next < source->count){
+        items[count++] = &source->items[source->next++];
+    }
+    return count;
+}
+
+static int kway_source_of(struct kway_test_source* sources, int count, int* item){
+    for(int s = 0; s < count; s++){
+        for(size_t i = 0; i < sources[s].count; i++){
+            if(&sources[s].items[i] == item){
+                return s;
+            }
+        }
+    }
+    return -1;
+}
+
+void kway_merge_test(void){
+    printf("\nStarting kway_merge_test\n\n");
+    struct kway_merge_handle *hnd = NULL;
+
+    int a[] = {1, 4, 4, 9, 12, 20, 21};
+    int b[1] = {0};
+    int c[] = {0, 4, 5, 30};
+    int d[] = {4, 4, 6, 7, 8, 10, 11, 13};
+    int e[] = {2};
+    struct kway_test_source sources[] = {
+        {a, sizeof(a) / sizeof(int), 0},
+        {b, 0, 0},
+        {c, sizeof(c) / sizeof(int), 0},
+        {d, sizeof(d) / sizeof(int), 0},
+        {e, sizeof(e) / sizeof(int), 0},
+    };
+    void* contexts[] = {&sources[0], &sources[1], &sources[2], &sources[3], &sources[4]};
+
+    cst_err err = kway_merge_init(&hnd, 5, contexts, &kway_pull, &kway_compare);
+    if(err != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+    printf("Active sources (should be 4): %d\n", (int)kway_merge_active(hnd));
+
+    void* data = NULL;
+    kway_merge_remove(hnd, &data);
+    printf("First (should be 0): %d\n", *(int*)data);
+
+    // Equal items come out in source order, a before c before d.
+    void* out[8];
+    int* last = data;
+    int total = 1;
+    size_t count = 0;
+    while((count = kway_merge_next(hnd, out, 8)) > 0){
+        for(size_t i = 0; i < count; i++){
+            int* item = out[i];
+            printf("%d ", *item);
+            if(*item < *last || (*item == *last && kway_source_of(sources, 5, item) < kway_source_of(sources, 5, last))){
+                printf("\nOrder fail\n");
+                goto exit;
+            }
+            last = item;
+            total++;
+        }
+    }
+    printf("\nTotal (should be 20): %d\n", total);
+
+    if(kway_merge_remove(hnd, &data) != CST_EMPTY || kway_merge_active(hnd) != 0){
+        printf("Something went wrong, should be empty\n");
+    }
+
+exit:
+    if(hnd) {
+        kway_merge_free(hnd);
+    }
+}
@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_KWAY_MERGE_TEST_H
+#define COMPLETEBINARYTREE_KWAY_MERGE_TEST_H
+
+void kway_merge_test(void);
+
+#endif //COMPLETEBINARYTREE_KWAY_MERGE_TEST_H
@@ -1,9 +1,48 @@
 #include <stdio.h>
 #include "cbt_test.h"
 #include "prio_queue_test.h"
+#include "timer_wheel_test.h"
+#include "bucket_queue_test.h"
+#include "ext_prio_queue_test.h"
+#include "mmap_prio_queue_test.h"
+#include "kway_merge_test.h"
+#include "async_prio_queue_test.h"
+#include "aging_prio_queue_test.h"
+#include "sharded_prio_queue_test.h"
+#include "differential_test.h"
+#if CSTRUCTURES_TEST_CXX
+#include "prio_queue_cpp_test.h"
+#endif
+#if CSTRUCTURES_TEST_CXX_CORO
+#include "async_prio_queue_cpp_test.h"
+#endif
 
 int main() {
     test_cbt();
+    test_cbt_allocator();
     prio_queue_test();
+    prio_queue_snapshot_test();
+    prio_queue_stats_test();
+    prio_queue_trace_test();
+    prio_queue_parallel_test();
+    prio_queue_erase_test();
+    prio_queue_ingress_test();
+    timer_wheel_test();
+    bucket_queue_test();
+    ext_prio_queue_test();
+    ext_prio_queue_recovery_test();
+    mmap_prio_queue_test();
+    mmap_prio_queue_reopen_test();
+    kway_merge_test();
+    async_prio_queue_test();
+    aging_prio_queue_test();
+    sharded_prio_queue_test();
+    differential_test();
+#if CSTRUCTURES_TEST_CXX
+    prio_queue_cpp_test();
+#endif
+#if CSTRUCTURES_TEST_CXX_CORO
+    async_prio_queue_cpp_test();
+#endif
     return 0;
 }
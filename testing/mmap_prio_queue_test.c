@@ -0,0 +1,163 @@
+
+#include "mmap_prio_queue_test.h"
+#include "../include/mmap_prio_queue.h"
+#include "stdio.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MMAP_TEST_PATH P_tmpdir "/cstructures_mmap_test.pq"
+
+void mmap_prio_queue_test(void){
+    printf("\nStarting mmap_prio_queue_test\n\n");
+    remove(MMAP_TEST_PATH);
+
+    struct mmap_prio_queue_handle *hnd = NULL;
+    cst_err e = mmap_prio_queue_open(&hnd, MMAP_TEST_PATH, sizeof(int), 4, 2);
+    if(e != CST_OK){
+        printf("Open Fail\n");
+        goto exit;
+    }
+
+    uint64_t keys[] = {23,267,5,7,1,1000,10};
+
+    for(int i = 0; i < 4; i++){
+        int payload = (int)keys[i] * 2;
+        mmap_prio_queue_insert(hnd, keys[i], &payload);
+    }
+
+    cst_err insert_err = mmap_prio_queue_insert(hnd, keys[4], NULL);
+    if(insert_err == CST_OK){
+        printf("Something went wrong, should have failed\n");
+        goto exit;
+    }
+
+    cst_err insert_err2 = mmap_prio_queue_resize(hnd, 20);
+    if(insert_err2 != CST_OK){
+        printf("Resize Failed\n");
+        goto exit;
+    }
+    for(int i = 4; i < 7; i++){
+        int payload = (int)keys[i] * 2;
+        mmap_prio_queue_insert(hnd, keys[i], &payload);
+    }
+
+    // Shrinking maps the smaller file before the old mapping goes, the records have to survive it.
+    if(mmap_prio_queue_resize(hnd, 7) != CST_OK || mmap_prio_queue_insert(hnd, 2, NULL) != CST_OVERFLOW
+       || mmap_prio_queue_size(hnd) != 7){
+        printf("Shrink went wrong\n");
+        goto exit;
+    }
+
+    // Close and reopen, the queue has to come back as it was.
+    mmap_prio_queue_close(hnd);
+    hnd = NULL;
+
+    if(mmap_prio_queue_open(&hnd, MMAP_TEST_PATH, sizeof(long long), 4, 0) != CST_FAIL){
+        printf("Something went wrong, payload size should not match\n");
+        goto exit;
+    }
+    if(mmap_prio_queue_open(&hnd, MMAP_TEST_PATH, sizeof(int), 4, 0) != CST_OK){
+        printf("Reopen Fail\n");
+        goto exit;
+    }
+
+    printf("Queue Size Reopened: %d\n", (int)mmap_prio_queue_size(hnd));
+
+    uint64_t out[7];
+    int payloads[7];
+    for(int i = 0; i < 7; i++){
+        mmap_prio_queue_remove(hnd, &out[i], &payloads[i]);
+        if(payloads[i] != (int)out[i] * 2){
+            printf("fail\n");
+            goto exit;
+        }
+    }
+
+    printf("Printing values:\n");
+    printf("[ %d , %d , %d , %d , %d , %d , %d ]\n", (int)out[0], (int)out[1], (int)out[2], (int)out[3], (int)out[4],
+           (int)out[5], (int)out[6]);
+
+    printf("Queue size final: %d\n", (int)mmap_prio_queue_size(hnd));
+
+exit:
+    if(hnd) {
+        mmap_prio_queue_close(hnd);
+    }
+    remove(MMAP_TEST_PATH);
+}
+
+// Offsets into the file, the header is 64 bytes and its clean flag follows the count.
+#define MMAP_TEST_CLEAN_OFFSET 32
+#define MMAP_TEST_RECORDS_OFFSET 64
+
+void mmap_prio_queue_reopen_test(void){
+    printf("\nStarting mmap_prio_queue_reopen_test\n\n");
+    remove(MMAP_TEST_PATH);
+    struct mmap_prio_queue_handle *hnd = NULL;
+
+    // A child checkpoints, inserts once more and exits without closing, like a crash after the insert.
+    pid_t pid = fork();
+    if(pid == 0){
+        if(mmap_prio_queue_open(&hnd, MMAP_TEST_PATH, sizeof(int), 8, 0) != CST_OK){
+            _exit(1);
+        }
+        uint64_t keys[] = {30, 10, 20, 40};
+        for(int i = 0; i < 3; i++){
+            mmap_prio_queue_insert(hnd, keys[i], NULL);
+        }
+        if(mmap_prio_queue_checkpoint(hnd) != CST_OK || mmap_prio_queue_insert(hnd, keys[3], NULL) != CST_OK){
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        printf("Child went wrong\n");
+        goto exit;
+    }
+
+    // The insert after the checkpoint has to have marked the header dirty in the file itself.
+    FILE* file = fopen(MMAP_TEST_PATH, "r+b");
+    if(file == NULL){
+        printf("Open Fail\n");
+        goto exit;
+    }
+    uint32_t clean = 1;
+    fseek(file, MMAP_TEST_CLEAN_OFFSET, SEEK_SET);
+    size_t got = fread(&clean, sizeof(clean), 1, file);
+    // Break the heap order like a half written sift would, the root gets the largest key.
+    uint64_t broken = 1000;
+    fseek(file, MMAP_TEST_RECORDS_OFFSET, SEEK_SET);
+    fwrite(&broken, sizeof(broken), 1, file);
+    fclose(file);
+    printf("Clean flag after an unsynced insert (should be 0): %u\n", (unsigned int)clean);
+    if(got != 1 || clean != 0){
+        printf("Dirty header fail\n");
+        goto exit;
+    }
+
+    if(mmap_prio_queue_open(&hnd, MMAP_TEST_PATH, sizeof(int), 8, 0) != CST_OK){
+        printf("Reopen Fail\n");
+        goto exit;
+    }
+    uint64_t last = 0;
+    size_t count = mmap_prio_queue_size(hnd);
+    for(size_t i = 0; i < count; i++){
+        uint64_t key = 0;
+        if(mmap_prio_queue_remove(hnd, &key, NULL) != CST_OK || key < last){
+            printf("Rebuild fail\n");
+            goto exit;
+        }
+        last = key;
+    }
+    printf("Removed %d records in order after reopening (should be 4)\n", (int)count);
+    if(count != 4 || last != broken){
+        printf("Rebuild fail\n");
+    }
+
+exit:
+    if(hnd) {
+        mmap_prio_queue_close(hnd);
+    }
+    remove(MMAP_TEST_PATH);
+}
@@ -0,0 +1,9 @@
+
+#ifndef COMPLETEBINARYTREE_MMAP_PRIO_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_MMAP_PRIO_QUEUE_TEST_H
+
+void mmap_prio_queue_test(void);
+
+void mmap_prio_queue_reopen_test(void);
+
+#endif //COMPLETEBINARYTREE_MMAP_PRIO_QUEUE_TEST_H
@@ -0,0 +1,69 @@
+
+#include "prio_queue_cpp_test.h"
+#include "../include/prio_queue.hpp"
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct job{
+    int priority;
+    std::unique_ptr<std::string> name;
+
+    job(int priority, const char* name) : priority(priority), name(new std::string(name)) {}
+};
+
+struct job_order{
+    bool operator()(const job& a, const job& b) const { return a.priority < b.priority; }
+};
+
+void prio_queue_cpp_test(void){
+    printf("\nStarting prio_queue_cpp_test\n\n");
+
+    // Min heap of ints, arity 3 so the last level is partially filled.
+    cstructures::priority_queue<int, std::greater<int>, 3> ints;
+    int dat[] = {1999,27,5,1000,23,1234,70,5000,5,-4};
+    for(int value : dat){
+        ints.push(value);
+    }
+    printf("Size (should be 10): %d\n", (int)ints.size());
+    printf("Top (should be -4): %d\n", ints.top());
+    int last = -100;
+    while(!ints.empty()){
+        int value = ints.pop();
+        printf("%d ", value);
+        if(value < last){
+            printf("\nOrder fail\n");
+            return;
+        }
+        last = value;
+    }
+    printf("\n");
+
+    // Move only items are emplaced and moved out.
+    cstructures::priority_queue<job, job_order> jobs;
+    jobs.emplace(2, "two");
+    jobs.emplace(7, "seven");
+    jobs.emplace(4, "four");
+    cstructures::priority_queue<job, job_order> moved(std::move(jobs));
+    if(!jobs.empty() || moved.size() != 3){
+        printf("Move fail\n");
+        return;
+    }
+    job first = moved.pop();
+    printf("First job (should be seven): %s\n", first.name->c_str());
+    if(first.priority != 7 || moved.top().priority != 4){
+        printf("Job order fail\n");
+    }
+
+    // Copies are independent.
+    cstructures::priority_queue<int> a;
+    for(int i = 0; i < 100; i++){
+        a.push((i * 37) % 100);
+    }
+    cstructures::priority_queue<int> b(a);
+    b.pop();
+    if(a.size() != 100 || b.size() != 99 || a.top() != 99 || b.top() != 98){
+        printf("Copy fail\n");
+    }
+}
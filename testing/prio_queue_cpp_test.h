@@ -0,0 +1,15 @@
+
+#ifndef COMPLETEBINARYTREE_PRIO_QUEUE_CPP_TEST_H
+#define COMPLETEBINARYTREE_PRIO_QUEUE_CPP_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void prio_queue_cpp_test(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //COMPLETEBINARYTREE_PRIO_QUEUE_CPP_TEST_H
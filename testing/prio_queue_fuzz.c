@@ -0,0 +1,72 @@
+
+/*
+ * Differential fuzz target, every queue variant runs the input against a sorted reference model.
+ *
+ * Built as a libFuzzer target with -DCSTRUCTURES_FUZZ=LIBFUZZER (clang). With -DCSTRUCTURES_FUZZ=STANDALONE it has its
+ * own main which runs every file given on the command line, or stdin without arguments, which suits AFL and replaying
+ * crashes. A mismatch is printed and aborts.
+ *
+ * Usage: prio_queue_fuzz [corpus directory or files]    (libFuzzer)
+ *        prio_queue_fuzz [files]                        (standalone, AFL: afl-fuzz -i in -o out -- prio_queue_fuzz @@)
+ */
+
+#include "differential_test.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size){
+    if(differential_run(data, size) != 0){
+        abort();
+    }
+    return 0;
+}
+
+#if !CSTRUCTURES_LIBFUZZER
+
+static int __fuzz_run_file(FILE* file){
+    size_t size = 0, cap = 4096;
+    uint8_t* data = malloc(cap);
+    while(data != NULL){
+        size += fread(data + size, 1, cap - size, file);
+        if(size < cap){
+            break;
+        }
+        uint8_t* grown = realloc(data, cap * 2);
+        if(grown == NULL){
+            free(data);
+        }
+        data = grown;
+        cap *= 2;
+    }
+    if(data == NULL){
+        printf("Out of memory\n");
+        return -1;
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        return __fuzz_run_file(stdin) == 0 ? 0 : 1;
+    }
+    for(int i = 1; i < argc; i++){
+        FILE* file = fopen(argv[i], "rb");
+        if(file == NULL){
+            printf("Could not open %s\n", argv[i]);
+            return 1;
+        }
+        int r = __fuzz_run_file(file);
+        fclose(file);
+        if(r != 0){
+            return 1;
+        }
+    }
+    printf("%d inputs matched the model\n", argc - 1);
+    return 0;
+}
+
+#endif
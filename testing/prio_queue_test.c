@@ -2,6 +2,13 @@
 #include "prio_queue_test.h"
 #include "../include/prio_queue.h"
 #include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#if PRIO_QUEUE_PARALLEL_ENABLED
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 int compare(void* c1, void* c2){
     int i1 = *(int*)c1;
@@ -63,10 +70,543 @@ void prio_queue_test(void){
 
     printf("[ %d , %d , %d , %d , %d , %d , %d ]\n", *(int*)out[0], *(int*)out[1], *(int*)out[2], *(int*)out[3], *(int*)out[4], *(int*)out[5], *(int*)out[6]);
 
+    int expected[] = {1,5,7,10,23,267,1000};
+    for(int i = 0; i < 7; i++){
+        if(*(int*)out[i] != expected[i]){
+            printf("Order Fail at %d\n", i);
+            goto exit;
+        }
+    }
+
     printf("Queue size final: %d\n", prio_queue_size(hnd));
 
 exit:
     if(hnd) {
         prio_queue_free(hnd);
     }
-}
\ No newline at end of file
+}
+static size_t serialize_int(void* data, void* buf, size_t cap){
+    if(cap >= sizeof(int)){
+        memcpy(buf, data, sizeof(int));
+    }
+    return sizeof(int);
+}
+
+static void* deserialize_int(const void* buf, size_t len){
+    int* data = malloc(sizeof(int));
+    if(data != NULL && len == sizeof(int)){
+        memcpy(data, buf, sizeof(int));
+    }
+    return data;
+}
+
+static void release_int(void* data){
+    free(data);
+}
+
+void prio_queue_snapshot_test(void){
+    printf("\nStarting prio_queue_snapshot_test\n\n");
+    struct prio_queue_handle *hnd = NULL;
+    struct prio_queue_handle *restored = NULL;
+    FILE* file = tmpfile();
+    if(file == NULL){
+        printf("No temp file\n");
+        return;
+    }
+
+    cst_err e = prio_queue_init(&hnd, 8, &compare);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    int dat[] = {23,267,5,7,1,1000,10};
+    for(int i = 0; i < 7; i++){
+        prio_queue_insert(hnd, &dat[i]);
+    }
+
+    if(prio_queue_snapshot(hnd, file, &serialize_int) != CST_OK){
+        printf("Snapshot Failed\n");
+        goto exit;
+    }
+    long snapshot_len = ftell(file);
+
+    rewind(file);
+    if(prio_queue_restore(&restored, file, &compare, &deserialize_int, &release_int) != CST_OK){
+        printf("Restore Failed\n");
+        goto exit;
+    }
+
+    printf("Queue Size Restored: %d\n", prio_queue_size(restored));
+
+    int out[7];
+    for(int i = 0; i < 7; i++){
+        void* item = NULL;
+        prio_queue_remove(restored, &item);
+        out[i] = *(int*)item;
+        free(item);
+    }
+
+    printf("Printing values:\n");
+    printf("[ %d , %d , %d , %d , %d , %d , %d ]\n", out[0], out[1], out[2], out[3], out[4], out[5], out[6]);
+
+    prio_queue_free(restored);
+    restored = NULL;
+
+    // Flip a byte of the last item, the checksum has to catch it.
+    fseek(file, snapshot_len - 5, SEEK_SET);
+    fputc(0x7F, file);
+    rewind(file);
+    if(prio_queue_restore(&restored, file, &compare, &deserialize_int, &release_int) != CST_FAIL){
+        printf("Something went wrong, corrupt snapshot should fail\n");
+        goto exit;
+    }
+    printf("Corrupt snapshot rejected\n");
+
+    // A huge count in the header is only believed as far as items are actually read.
+    uint64_t huge = INT32_MAX;
+    fseek(file, 16, SEEK_SET);
+    fwrite(&huge, sizeof(huge), 1, file);
+    rewind(file);
+    if(prio_queue_restore(&restored, file, &compare, &deserialize_int, &release_int) == CST_OK){
+        printf("Something went wrong, truncated snapshot should not restore\n");
+        goto exit;
+    }
+    printf("Truncated snapshot rejected\n");
+
+exit:
+    if(restored) {
+        prio_queue_free(restored);
+    }
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+    fclose(file);
+}
+
+void prio_queue_stats_test(void){
+    printf("\nStarting prio_queue_stats_test\n\n");
+#if PRIO_QUEUE_STATS_ENABLED
+    struct prio_queue_handle *hnd = NULL;
+    cst_err e = prio_queue_init(&hnd, 4, &compare);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Descending values, every insert bubbles all the way up.
+    int dat[] = {40,30,20,10,0};
+    for(int i = 0; i < 5; i++){
+        prio_queue_insert(hnd, &dat[i]);
+    }
+    prio_queue_resize(hnd, 8);
+    prio_queue_insert(hnd, &dat[4]);
+
+    void* out = NULL;
+    prio_queue_remove(hnd, &out);
+
+    struct prio_queue_stats stats;
+    prio_queue_get_stats(hnd, &stats);
+    printf("inserts (should be 5): %d\n", (int)stats.inserts);
+    printf("removes (should be 1): %d\n", (int)stats.removes);
+    printf("overflows (should be 1): %d\n", (int)stats.overflows);
+    printf("resizes (should be 1): %d\n", (int)stats.resizes);
+    printf("high water (should be 5): %d\n", (int)stats.size_high_water);
+    printf("comparisons: %d, swaps: %d\n", (int)stats.comparisons, (int)stats.swaps);
+    printf("sift depths 0/1/2: %d/%d/%d\n", (int)stats.sift_depth[0], (int)stats.sift_depth[1],
+           (int)stats.sift_depth[2]);
+
+    prio_queue_reset_stats(hnd);
+    prio_queue_get_stats(hnd, &stats);
+    if(stats.inserts != 0 || stats.size_high_water != 4){
+        printf("fail\n");
+    }
+
+exit:
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+#else
+    printf("Stats disabled\n");
+#endif
+}
+
+#if PRIO_QUEUE_TRACE_ENABLED
+static int trace_counts[PRIO_QUEUE_EVENT_COUNT];
+
+static void trace_callback(enum prio_queue_event event, void* data, uint64_t latency_ns, void* ctx){
+    (void)data;
+    (void)latency_ns;
+    (void)ctx;
+    trace_counts[event]++;
+}
+#endif
+
+void prio_queue_trace_test(void){
+    printf("\nStarting prio_queue_trace_test\n\n");
+#if PRIO_QUEUE_TRACE_ENABLED
+    struct prio_queue_handle *hnd = NULL;
+    cst_err e = prio_queue_init(&hnd, 4, &compare);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Untraced operations are not recorded.
+    int dat[] = {40,30,20,10,0};
+    prio_queue_insert(hnd, &dat[0]);
+
+    prio_queue_set_trace(hnd, &trace_callback, NULL, 2);
+    for(int i = 1; i < 5; i++){
+        prio_queue_insert(hnd, &dat[i]);
+    }
+    prio_queue_resize(hnd, 8);
+    void* out = NULL;
+    for(int i = 0; i < 4; i++){
+        prio_queue_remove(hnd, &out);
+    }
+
+    struct prio_queue_latency latency;
+    prio_queue_get_latency(hnd, PRIO_QUEUE_EVENT_INSERT, &latency);
+    printf("sampled inserts (should be 1): %d\n", (int)latency.count);
+    prio_queue_get_latency(hnd, PRIO_QUEUE_EVENT_REMOVE, &latency);
+    printf("sampled removes (should be 2): %d\n", (int)latency.count);
+    printf("remove p50 %d ns, max %d ns\n", (int)prio_queue_latency_percentile(&latency, 50.0), (int)latency.max);
+    printf("callbacks insert/remove/resize/overflow (should be 1/2/1/1): %d/%d/%d/%d\n",
+           trace_counts[PRIO_QUEUE_EVENT_INSERT], trace_counts[PRIO_QUEUE_EVENT_REMOVE],
+           trace_counts[PRIO_QUEUE_EVENT_RESIZE], trace_counts[PRIO_QUEUE_EVENT_OVERFLOW]);
+    if(trace_counts[PRIO_QUEUE_EVENT_INSERT] != 1 || trace_counts[PRIO_QUEUE_EVENT_REMOVE] != 2 ||
+       trace_counts[PRIO_QUEUE_EVENT_RESIZE] != 1 || trace_counts[PRIO_QUEUE_EVENT_OVERFLOW] != 1){
+        printf("fail\n");
+    }
+    if(prio_queue_latency_percentile(&latency, 100.0) > latency.max ||
+       prio_queue_latency_percentile(&latency, 0.0) < latency.min){
+        printf("Percentile fail\n");
+    }
+
+    if(prio_queue_get_latency(hnd, PRIO_QUEUE_EVENT_OVERFLOW, &latency) != CST_PARAM_ERR){
+        printf("Overflow latency fail\n");
+    }
+    prio_queue_reset_latency(hnd);
+    prio_queue_get_latency(hnd, PRIO_QUEUE_EVENT_REMOVE, &latency);
+    if(latency.count != 0){
+        printf("Reset fail\n");
+    }
+
+exit:
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+#else
+    printf("Trace disabled\n");
+#endif
+}
+
+void prio_queue_parallel_test(void){
+    printf("\nStarting prio_queue_parallel_test\n\n");
+#if PRIO_QUEUE_PARALLEL_ENABLED
+    // Large enough to be split between threads, with many duplicates.
+    int count = 100000;
+    struct prio_queue_handle *hnd = NULL;
+    int* dat = malloc(sizeof(int) * count);
+    void** items = malloc(sizeof(void*) * count);
+    void** out = malloc(sizeof(void*) * count);
+    if(dat == NULL || items == NULL || out == NULL){
+        printf("Alloc Fail\n");
+        goto exit;
+    }
+    unsigned int seed = 12345;
+    for(int i = 0; i < count; i++){
+        seed = seed * 1103515245u + 12345u;
+        dat[i] = (int)((seed >> 8) % 50000);
+        items[i] = &dat[i];
+    }
+
+    cst_err e = prio_queue_build_parallel(&hnd, items, count, count + 10, &compare, 4);
+    if(e != CST_OK){
+        printf("Build Fail\n");
+        goto exit;
+    }
+    printf("Queue Size (should be %d): %d\n", count, prio_queue_size(hnd));
+
+    // The queue works as usual after building.
+    int extra = -1;
+    prio_queue_insert(hnd, &extra);
+    void* first = NULL;
+    prio_queue_remove(hnd, &first);
+    printf("First (should be -1): %d\n", *(int*)first);
+    int last = -1;
+    for(int i = 0; i < 1000; i++){
+        void* item = NULL;
+        prio_queue_remove(hnd, &item);
+        if(*(int*)item < last){
+            printf("Build order fail\n");
+            goto exit;
+        }
+        last = *(int*)item;
+    }
+
+    int left = prio_queue_size(hnd);
+    e = prio_queue_drain_sorted_parallel(hnd, out, 3);
+    if(e != CST_OK || prio_queue_size(hnd) != 0){
+        printf("Drain Fail\n");
+        goto exit;
+    }
+    for(int i = 0; i < left; i++){
+        if(*(int*)out[i] < last){
+            printf("Drain order fail at %d\n", i);
+            goto exit;
+        }
+        last = *(int*)out[i];
+    }
+    printf("Drained %d items in order, last %d\n", left, last);
+
+    // Every item comes out exactly once, items are marked by negating them.
+    for(int i = 0; i < left; i++){
+        int* item = out[i];
+        if(item < dat || item >= dat + count || *item < 0){
+            printf("Something went wrong, item %d lost or duplicated\n", i);
+            goto exit;
+        }
+        *item = -*item - 1;
+    }
+
+exit:
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+    free(dat);
+    free(items);
+    free(out);
+#else
+    printf("Parallel disabled\n");
+#endif
+}
+
+struct erase_item{
+    int priority;
+    uint64_t id;
+};
+
+static int compare_erase_item(void* c1, void* c2){
+    int p1 = ((struct erase_item*)c1)->priority;
+    int p2 = ((struct erase_item*)c2)->priority;
+    return (p1 > p2) - (p1 < p2);
+}
+
+static uint64_t erase_item_key(void* data){
+    return ((struct erase_item*)data)->id;
+}
+
+void prio_queue_erase_test(void){
+    printf("\nStarting prio_queue_erase_test\n\n");
+    struct prio_queue_handle *hnd = NULL;
+    cst_err e = prio_queue_init(&hnd, 100, &compare);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Erasing every even value passes the default fraction, so the heap is compacted on the way.
+    int dat[100];
+    for(int i = 0; i < 100; i++){
+        dat[i] = (i * 37) % 100;
+        prio_queue_insert(hnd, &dat[i]);
+    }
+    for(int i = 0; i < 100; i++){
+        if(dat[i] % 2 == 0 && prio_queue_erase_lazy(hnd, &dat[i]) != CST_OK){
+            printf("Erase Fail\n");
+            goto exit;
+        }
+    }
+    printf("Size (should be 50): %d\n", prio_queue_size(hnd));
+
+    void* out = NULL;
+    prio_queue_peek(hnd, &out);
+    printf("Peek (should be 1): %d\n", *(int*)out);
+    int expected = 1;
+    while(prio_queue_remove(hnd, &out) == CST_OK){
+        if(*(int*)out != expected){
+            printf("Erase order fail, got %d expected %d\n", *(int*)out, expected);
+            goto exit;
+        }
+        expected += 2;
+    }
+    if(expected != 101 || prio_queue_size(hnd) != 0 || prio_queue_erase_lazy(hnd, &dat[0]) != CST_EMPTY){
+        printf("Something went wrong, should be empty\n");
+        goto exit;
+    }
+    prio_queue_free(hnd);
+    hnd = NULL;
+
+    // With a key function any data carrying the id erases the queued item, the fraction 1 never compacts here.
+    e = prio_queue_init(&hnd, 8, &compare_erase_item);
+    if(e != CST_OK || prio_queue_set_erase(hnd, &erase_item_key, 1.0) != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+    struct erase_item items[] = {{5, 100}, {1, 101}, {3, 102}, {1, 103}};
+    for(int i = 0; i < 4; i++){
+        prio_queue_insert(hnd, &items[i]);
+    }
+    struct erase_item cancel = {0, 101};
+    prio_queue_erase_lazy(hnd, &cancel);
+    if(prio_queue_set_erase(hnd, NULL, 0.5) != CST_FAIL){
+        printf("Key change with pending tombstones fail\n");
+    }
+    prio_queue_remove(hnd, &out);
+    printf("First id (should be 103): %d\n", (int)((struct erase_item*)out)->id);
+    prio_queue_remove(hnd, &out);
+    printf("Second id (should be 102): %d\n", (int)((struct erase_item*)out)->id);
+    if(prio_queue_size(hnd) != 1){
+        printf("Size fail\n");
+    }
+
+    // Erasing an item which is not queued, or one already erased, is refused and leaves no tombstone behind.
+    struct erase_item late = {2, 200};
+    if(prio_queue_erase_lazy(hnd, &late) != CST_PARAM_ERR || prio_queue_erase_lazy(hnd, &cancel) != CST_PARAM_ERR
+       || prio_queue_erase_lazy(hnd, &items[2]) != CST_PARAM_ERR || prio_queue_size(hnd) != 1){
+        printf("Erase of a missing item went wrong\n");
+        goto exit;
+    }
+    prio_queue_insert(hnd, &late);
+    if(prio_queue_erase_lazy(hnd, &items[0]) != CST_OK || prio_queue_erase_lazy(hnd, &items[0]) != CST_PARAM_ERR){
+        printf("Double erase went wrong\n");
+        goto exit;
+    }
+    out = NULL;
+    prio_queue_remove(hnd, &out);
+    printf("Late id (should be 200): %d\n", out != NULL ? (int)((struct erase_item*)out)->id : -1);
+    if(out != &late || prio_queue_size(hnd) != 0 || prio_queue_remove(hnd, &out) != CST_EMPTY){
+        printf("Erase of a missing item went wrong\n");
+        goto exit;
+    }
+
+    // Rescheduling inserts the key again, the erased copy has to be gone before the new one can reach the top.
+    struct erase_item first = {5, 300}, again = {0, 300}, other = {3, 301};
+    prio_queue_insert(hnd, &first);
+    prio_queue_insert(hnd, &other);
+    prio_queue_erase_lazy(hnd, &first);
+    prio_queue_insert(hnd, &again);
+    void* rescheduled[2] = {NULL, NULL};
+    prio_queue_remove(hnd, &rescheduled[0]);
+    prio_queue_remove(hnd, &rescheduled[1]);
+    if(rescheduled[0] != &again || rescheduled[1] != &other || prio_queue_remove(hnd, &out) != CST_EMPTY){
+        printf("Reschedule went wrong\n");
+    }
+
+exit:
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+}
+
+#if PRIO_QUEUE_INGRESS_ENABLED && PRIO_QUEUE_PARALLEL_ENABLED
+
+#define INGRESS_PRODUCERS 4
+#define INGRESS_ITEMS 20000
+
+struct ingress_producer{
+    struct prio_queue_handle* hnd;
+    int* items;
+};
+
+static void* ingress_produce(void* arg){
+    struct ingress_producer* producer = arg;
+    for(int i = 0; i < INGRESS_ITEMS; i++){
+        while(prio_queue_push_ingress(producer->hnd, &producer->items[i]) == CST_OVERFLOW){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+#endif
+
+void prio_queue_ingress_test(void){
+    printf("\nStarting prio_queue_ingress_test\n\n");
+#if PRIO_QUEUE_INGRESS_ENABLED
+    struct prio_queue_handle *hnd = NULL;
+    int* items = NULL;
+    cst_err e = prio_queue_init(&hnd, 16, &compare);
+    if(e != CST_OK || prio_queue_attach_ingress(hnd, 3) != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // The capacity is rounded up to 4, the fifth push overflows until the owner drains.
+    int dat[] = {8, 3, 5, 1, 9};
+    for(int i = 0; i < 4; i++){
+        prio_queue_push_ingress(hnd, &dat[i]);
+    }
+    if(prio_queue_push_ingress(hnd, &dat[4]) != CST_OVERFLOW || prio_queue_size(hnd) != 0){
+        printf("Ring overflow fail\n");
+        goto exit;
+    }
+    printf("Drained (should be 4): %d\n", (int)prio_queue_drain_ingress(hnd));
+    prio_queue_push_ingress(hnd, &dat[4]);
+    prio_queue_insert(hnd, &dat[4]);
+
+    void* out = NULL;
+    int last = -1;
+    int count = 0;
+    while(prio_queue_remove(hnd, &out) == CST_OK){
+        printf("%d ", *(int*)out);
+        if(*(int*)out < last){
+            printf("\nOrder fail\n");
+            goto exit;
+        }
+        last = *(int*)out;
+        count++;
+    }
+    printf("\nRemoved (should be 6): %d\n", count);
+
+#if PRIO_QUEUE_PARALLEL_ENABLED
+    // Producers on other threads while the owner keeps removing.
+    prio_queue_free(hnd);
+    hnd = NULL;
+    items = malloc(sizeof(int) * INGRESS_PRODUCERS * INGRESS_ITEMS);
+    if(items == NULL || prio_queue_init(&hnd, INGRESS_PRODUCERS * INGRESS_ITEMS, &compare) != CST_OK ||
+       prio_queue_attach_ingress(hnd, 256) != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+    for(int i = 0; i < INGRESS_PRODUCERS * INGRESS_ITEMS; i++){
+        items[i] = i;
+    }
+    struct ingress_producer producers[INGRESS_PRODUCERS];
+    pthread_t threads[INGRESS_PRODUCERS];
+    for(int i = 0; i < INGRESS_PRODUCERS; i++){
+        producers[i].hnd = hnd;
+        producers[i].items = items + i * INGRESS_ITEMS;
+        pthread_create(&threads[i], NULL, &ingress_produce, &producers[i]);
+    }
+    int64_t sum = 0;
+    count = 0;
+    while(count < INGRESS_PRODUCERS * INGRESS_ITEMS){
+        if(prio_queue_remove(hnd, &out) == CST_OK){
+            sum += *(int*)out;
+            count++;
+        } else {
+            sched_yield();
+        }
+    }
+    for(int i = 0; i < INGRESS_PRODUCERS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    int64_t n = INGRESS_PRODUCERS * INGRESS_ITEMS;
+    printf("Threaded items (should be %d): %d\n", (int)n, count);
+    if(sum != n * (n - 1) / 2 || prio_queue_remove(hnd, &out) != CST_EMPTY){
+        printf("Something went wrong, items lost or duplicated\n");
+    }
+#endif
+
+exit:
+    free(items);
+    if(hnd) {
+        prio_queue_free(hnd);
+    }
+#else
+    printf("Ingress disabled\n");
+#endif
+}
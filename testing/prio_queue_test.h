@@ -4,4 +4,16 @@
 
 void prio_queue_test(void);
 
+void prio_queue_snapshot_test(void);
+
+void prio_queue_stats_test(void);
+
+void prio_queue_trace_test(void);
+
+void prio_queue_parallel_test(void);
+
+void prio_queue_erase_test(void);
+
+void prio_queue_ingress_test(void);
+
 #endif //COMPLETEBINARYTREE_PRIO_QUEUE_TEST_H
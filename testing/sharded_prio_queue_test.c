@@ -0,0 +1,131 @@
+
+#include "sharded_prio_queue_test.h"
+#include "../include/sharded_prio_queue.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+#if SHARDED_PRIO_QUEUE_ENABLED
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define SHARDED_TEST_THREADS 4
+#define SHARDED_TEST_ITEMS 5000
+
+static int spq_compare(void* c1, void* c2){
+    int i1 = *(int*)c1;
+    int i2 = *(int*)c2;
+    return (i1 > i2) - (i1 < i2);
+}
+
+struct spq_worker{
+    struct sharded_prio_queue_handle* hnd;
+    int* items;
+    int64_t sum;
+    int removed;
+};
+
+// Inserts its items locally and removes as many, whichever shard they come from.
+static void* spq_work(void* arg){
+    struct spq_worker* worker = arg;
+    void* data = NULL;
+    for(int i = 0; i < SHARDED_TEST_ITEMS; i++){
+        sharded_prio_queue_insert(worker->hnd, &worker->items[i]);
+        if(i % 2 == 1){
+            for(int r = 0; r < 2 && sharded_prio_queue_remove(worker->hnd, &data) == CST_OK; r++){
+                worker->sum += *(int*)data;
+                worker->removed++;
+            }
+        }
+    }
+    return NULL;
+}
+
+#endif
+
+void sharded_prio_queue_test(void){
+    printf("\nStarting sharded_prio_queue_test\n\n");
+#if SHARDED_PRIO_QUEUE_ENABLED
+    struct sharded_prio_queue_handle *hnd = NULL;
+    int* items = NULL;
+    cst_err err = sharded_prio_queue_init(&hnd, 4, 2, &spq_compare);
+    if(err != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+    printf("Shards (should be 4): %d\n", (int)sharded_prio_queue_shards(hnd));
+
+    // Shards start at 2 items and grow, the best item sits in shard 3.
+    int dat[] = {40, 12, 33, 7, 25, 19, 3, 50, 8, 31, 14, 22};
+    for(int i = 0; i < 12; i++){
+        if(sharded_prio_queue_insert_shard(hnd, (size_t)(i % 4), &dat[i]) != CST_OK){
+            printf("Insert Fail\n");
+            goto exit;
+        }
+    }
+    if(sharded_prio_queue_insert_shard(hnd, 4, &dat[0]) != CST_PARAM_ERR){
+        printf("Shard range fail\n");
+        goto exit;
+    }
+    printf("Size (should be 12): %d\n", (int)sharded_prio_queue_size(hnd));
+
+    // The first remove refreshes the cached best shard.
+    void* data = NULL;
+    sharded_prio_queue_remove(hnd, &data);
+    printf("First (should be 3): %d\n", *(int*)data);
+    int seen = 1;
+    int sum = *(int*)data;
+    while(sharded_prio_queue_remove(hnd, &data) == CST_OK){
+        sum += *(int*)data;
+        seen++;
+    }
+    printf("Removed (should be 12): %d\n", seen);
+    if(sum != 264 || sharded_prio_queue_size(hnd) != 0){
+        printf("Something went wrong, items lost or duplicated\n");
+        goto exit;
+    }
+
+    // Threads inserting locally and removing from any shard.
+    items = malloc(sizeof(int) * SHARDED_TEST_THREADS * SHARDED_TEST_ITEMS);
+    if(items == NULL){
+        printf("Alloc Fail\n");
+        goto exit;
+    }
+    struct spq_worker workers[SHARDED_TEST_THREADS];
+    pthread_t threads[SHARDED_TEST_THREADS];
+    for(int t = 0; t < SHARDED_TEST_THREADS; t++){
+        workers[t].hnd = hnd;
+        workers[t].items = items + t * SHARDED_TEST_ITEMS;
+        workers[t].sum = 0;
+        workers[t].removed = 0;
+        for(int i = 0; i < SHARDED_TEST_ITEMS; i++){
+            workers[t].items[i] = t * SHARDED_TEST_ITEMS + i;
+        }
+        pthread_create(&threads[t], NULL, &spq_work, &workers[t]);
+    }
+    int64_t total = 0;
+    int removed = 0;
+    for(int t = 0; t < SHARDED_TEST_THREADS; t++){
+        pthread_join(threads[t], NULL);
+        total += workers[t].sum;
+        removed += workers[t].removed;
+    }
+    while(sharded_prio_queue_remove(hnd, &data) == CST_OK){
+        total += *(int*)data;
+        removed++;
+    }
+    int64_t n = SHARDED_TEST_THREADS * SHARDED_TEST_ITEMS;
+    printf("Threaded items (should be %d): %d\n", (int)n, removed);
+    if(removed != n || total != n * (n - 1) / 2){
+        printf("Something went wrong, items lost or duplicated\n");
+    }
+
+exit:
+    free(items);
+    if(hnd) {
+        sharded_prio_queue_free(hnd);
+    }
+#else
+    printf("Sharded queue disabled, built without pthreads\n");
+#endif
+}
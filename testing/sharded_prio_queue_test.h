@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_SHARDED_PRIO_QUEUE_TEST_H
+#define COMPLETEBINARYTREE_SHARDED_PRIO_QUEUE_TEST_H
+
+void sharded_prio_queue_test(void);
+
+#endif //COMPLETEBINARYTREE_SHARDED_PRIO_QUEUE_TEST_H
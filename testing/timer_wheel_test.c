@@ -0,0 +1,70 @@
+
+#include "timer_wheel_test.h"
+#include "../include/timer_wheel.h"
+#include "stdio.h"
+
+struct fired_log{
+    unsigned long long out[16];
+    int count;
+};
+
+static void on_fire(void* data, void* ctx){
+    struct fired_log* log = ctx;
+    if(log->count < 16){
+        log->out[log->count] = *(unsigned long long*)data;
+    }
+    log->count++;
+}
+
+void timer_wheel_test(void){
+    printf("\nStarting timer_wheel_test\n\n");
+    struct timer_wheel_handle *hnd = NULL;
+    cst_err e = timer_wheel_init(&hnd, 1000);
+    if(e != CST_OK){
+        printf("Init Fail\n");
+        goto exit;
+    }
+
+    // Deadlines on every wheel, one already due and two beyond the range of the wheels.
+    unsigned long long dat[] = {1005, 1064, 5000, 300000, 999, 20000000, 40000000, 90000000};
+    struct timer_wheel_timer* timers[8];
+    for(int i = 0; i < 8; i++){
+        if(timer_wheel_schedule(hnd, dat[i], &dat[i], &timers[i]) != CST_OK){
+            printf("Schedule Failed\n");
+            goto exit;
+        }
+    }
+
+    printf("Timers Scheduled: %d\n", (int)timer_wheel_size(hnd));
+
+    // Cancel one timer in a wheel and one in the far future heap.
+    void* cancelled = NULL;
+    timer_wheel_cancel(hnd, timers[2], &cancelled);
+    printf("Cancelled (should be 5000): %llu\n", *(unsigned long long*)cancelled);
+    timer_wheel_cancel(hnd, timers[6], &cancelled);
+    printf("Cancelled (should be 40000000): %llu\n", *(unsigned long long*)cancelled);
+
+    struct fired_log log = { {0}, 0 };
+    size_t fired = timer_wheel_advance(hnd, 1004, &on_fire, &log);
+    printf("Fired at 1004 (should be 1, 999): %d, %llu\n", (int)fired, log.out[0]);
+
+    fired = timer_wheel_advance(hnd, 1005, &on_fire, &log);
+    if(fired != 1 || log.out[1] != 1005){
+        printf("fail\n");
+        goto exit;
+    }
+
+    fired = timer_wheel_advance(hnd, 100000000, &on_fire, &log);
+    printf("Fired at 100000000 (should be 4): %d\n", (int)fired);
+
+    printf("Printing values:\n");
+    printf("[ %llu , %llu , %llu , %llu , %llu , %llu ]\n", log.out[0], log.out[1], log.out[2], log.out[3],
+           log.out[4], log.out[5]);
+
+    printf("Timers final: %d\n", (int)timer_wheel_size(hnd));
+
+exit:
+    if(hnd) {
+        timer_wheel_free(hnd);
+    }
+}
@@ -0,0 +1,7 @@
+
+#ifndef COMPLETEBINARYTREE_TIMER_WHEEL_TEST_H
+#define COMPLETEBINARYTREE_TIMER_WHEEL_TEST_H
+
+void timer_wheel_test(void);
+
+#endif //COMPLETEBINARYTREE_TIMER_WHEEL_TEST_H